@@ -70,6 +70,25 @@
 ///     kraken_run( runtime, 0 );
 /// }
 /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+///
+/// ## Pool mode
+/// ***
+/// A pool creates one runtime per core and drives each of them from its own os thread.
+/// Idle runtimes steal READY threads from busy ones, so threads can move between cores
+/// whenever they yield.
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~C
+/// #define  KRAKEN_ENABLE_POOL  0x01
+/// #include "kraken.h"
+///
+/// int main ( void )
+/// {
+///     // 0 creates one runtime per online core
+///     struct kraken_pool* pool = kraken_initialize_pool( 0 );
+///     kraken_pool_start_thread( pool, first_thread );
+///     kraken_pool_start_thread( pool, second_thread );
+///     kraken_pool_run( pool, 0 );
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 /// ## Internals
 /// ***
@@ -123,6 +142,32 @@
 #define KRAKEN_SCHEDULER_ROUND_ROBIN    0x01
 #define KRAKEN_SCHEDULER_FIFO           0x02
 #define KRAKEN_SCHEDULER_FAIR           0x04
+#define KRAKEN_SCHEDULER_PRIORITY       0x08
+
+#ifndef KRAKEN_SCHEDULER
+    #define KRAKEN_SCHEDULER                KRAKEN_SCHEDULER_ROUND_ROBIN
+#endif // KRAKEN_SCHEDULER
+
+// Number of priority levels of the priority scheduler, at most 64
+#ifndef KRAKEN_PRIORITY_LEVELS
+    #define KRAKEN_PRIORITY_LEVELS          0x20
+#endif // KRAKEN_PRIORITY_LEVELS
+
+// Priority of threads started without options. The main thread always gets level 0.
+#ifndef KRAKEN_PRIORITY_DEFAULT
+    #define KRAKEN_PRIORITY_DEFAULT         ( KRAKEN_PRIORITY_LEVELS / 2 )
+#endif // KRAKEN_PRIORITY_DEFAULT
+
+// Pool mode: one runtime per core, each driven by its own pinned os thread.
+// Needs pthreads, so it is opt in.
+#ifndef KRAKEN_ENABLE_POOL
+    #define KRAKEN_ENABLE_POOL              0x0
+#endif // KRAKEN_ENABLE_POOL
+
+// Maximum number of threads moved by a single steal
+#ifndef KRAKEN_STEAL_BATCH
+    #define KRAKEN_STEAL_BATCH              0x20
+#endif // KRAKEN_STEAL_BATCH
 
 // Architecture codes
 #define KRAKEN_ARCH_AVR                 0x11
@@ -130,23 +175,30 @@
 #define KRAKEN_ARCH_X86                 0x13
 #define KRAKEN_ARCH_ARM                 0x14
 
-// Maximum number of threads
+// Maximum number of threads per runtime, 0 for no limit. The thread table grows on demand.
 #if !defined(KRAKEN_MAX_THREADS)
-    #define KRAKEN_MAX_THREADS              0x04
+    #define KRAKEN_MAX_THREADS              0x00
 #endif // KRAKEN_MAX_THREADS
 
+// Number of thread slots the thread table grows by
+#if !defined( KRAKEN_THREAD_CHUNK )
+    #define KRAKEN_THREAD_CHUNK             0x40
+#endif // !defined( KRAKEN_THREAD_CHUNK )
 
-// Maxium stack size
-#if !defined( KRAKEN_STACK_SIZE )
-    #if KRAKEN_ARCH == KRAKEN_ARCH_X86
-        // use 2mb stacks for 64bit architectures
-        #define KRAKEN_STACK_SIZE               1024 * 1024 * 2
-    #elif KRAKEN_ARCH == KRAKEN_ARCH_AVR
-        // use 2mb stacks for 64bit architectures
-        #define KRAKEN_STACK_SIZE               512
-    #endif // KRAKEN_ARCH == KRAKEN_ARCH_X86
-    #define KRAKEN_STACK_SIZE               512
-#endif // !defined( KRAKEN_STACK_SIZE )
+// Number of released stacks a runtime keeps for reuse. Beyond that stacks are unmapped.
+#if !defined( KRAKEN_STACK_CACHE )
+    #define KRAKEN_STACK_CACHE              0x40
+#endif // !defined( KRAKEN_STACK_CACHE )
+
+// Number of different stack sizes the stack cache of a runtime holds at a time
+#if !defined( KRAKEN_STACK_SIZES )
+    #define KRAKEN_STACK_SIZES              0x04
+#endif // !defined( KRAKEN_STACK_SIZES )
+
+// Size of the stack threads started with `shared_stack` run on, one per runtime
+#if !defined( KRAKEN_SHARED_STACK_SIZE )
+    #define KRAKEN_SHARED_STACK_SIZE        KRAKEN_STACK_SIZE
+#endif // !defined( KRAKEN_SHARED_STACK_SIZE )
 
 
 // architecture selection
@@ -164,23 +216,216 @@
     #endif
 #endif // KRAKEN_ARCH
 
+
+// Default stack size, threads can ask for a different one in kraken_thread_options
+#if !defined( KRAKEN_STACK_SIZE )
+    #if KRAKEN_ARCH == KRAKEN_ARCH_X86_64 || KRAKEN_ARCH == KRAKEN_ARCH_X86
+        // use 2mb stacks on x86, pages are only committed once touched
+        #define KRAKEN_STACK_SIZE               ( 1024 * 1024 * 2 )
+    #else
+        #define KRAKEN_STACK_SIZE               512
+    #endif // KRAKEN_ARCH == KRAKEN_ARCH_X86_64 || KRAKEN_ARCH == KRAKEN_ARCH_X86
+#endif // !defined( KRAKEN_STACK_SIZE )
+
+// Fill new stacks with KRAKEN_STACK_PATTERN so kraken_stack_usage can find the deepest
+// byte a thread ever wrote. Painting commits every page of the stack, so it is opt in.
+#if !defined( KRAKEN_ENABLE_STACK_WATERMARK )
+    #define KRAKEN_ENABLE_STACK_WATERMARK   0x0
+#endif // !defined( KRAKEN_ENABLE_STACK_WATERMARK )
+
+#define KRAKEN_STACK_PATTERN            0xA5A5A5A5A5A5A5A5ULL
+
+// Keep switch counts and run/ready/idle times per thread and per runtime (see
+// kraken_read_thread_stats). Reads the clock on every switch, so it is opt in.
+#if !defined( KRAKEN_ENABLE_STATS )
+    #define KRAKEN_ENABLE_STATS             0x0
+#endif // !defined( KRAKEN_ENABLE_STATS )
+
+// Record scheduler events into a ring buffer per runtime (see kraken_trace_dump).
+// Costs a timestamp and a 24 byte store per event, so it is opt in.
+#if !defined( KRAKEN_ENABLE_TRACE )
+    #define KRAKEN_ENABLE_TRACE             0x0
+#endif // !defined( KRAKEN_ENABLE_TRACE )
+
+// Number of records a trace ring holds before the oldest are overwritten, a power of two
+#if !defined( KRAKEN_TRACE_SIZE )
+    #define KRAKEN_TRACE_SIZE               0x10000
+#endif // !defined( KRAKEN_TRACE_SIZE )
+
+#if 0 != ( KRAKEN_TRACE_SIZE & ( KRAKEN_TRACE_SIZE - 1 ) )
+    #error "KRAKEN_TRACE_SIZE has to be a power of two."
+#endif // 0 != ( KRAKEN_TRACE_SIZE & ( KRAKEN_TRACE_SIZE - 1 ) )
+
+// Sample the thread holding each runtime from a SIGPROF timer (see kraken_profile_start).
+// Needs Linux timers that signal a single os thread, so it is opt in.
+#if !defined( KRAKEN_ENABLE_PROFILER )
+    #define KRAKEN_ENABLE_PROFILER          0x0
+#endif // !defined( KRAKEN_ENABLE_PROFILER )
+
+#if KRAKEN_ENABLE_PROFILER && !defined( __linux__ )
+    #error "KRAKEN_ENABLE_PROFILER needs Linux."
+#endif // KRAKEN_ENABLE_PROFILER && !defined( __linux__ )
+
+// Number of samples a runtime keeps per profile, later samples are dropped
+#if !defined( KRAKEN_PROFILE_SIZE )
+    #define KRAKEN_PROFILE_SIZE             0x10000
+#endif // !defined( KRAKEN_PROFILE_SIZE )
+
+// Watch runtimes from a helper os thread and report threads that keep the processor
+// longer than a budget without yielding (see kraken_watchdog_start). Linux only, opt in.
+#if !defined( KRAKEN_ENABLE_WATCHDOG )
+    #define KRAKEN_ENABLE_WATCHDOG          0x0
+#endif // !defined( KRAKEN_ENABLE_WATCHDOG )
+
+#if KRAKEN_ENABLE_WATCHDOG && !defined( __linux__ )
+    #error "KRAKEN_ENABLE_WATCHDOG needs Linux."
+#endif // KRAKEN_ENABLE_WATCHDOG && !defined( __linux__ )
+
+// Signal the watchdog interrupts an overrunning runtime with to capture where it is.
+// Ignored by default, so a stray one does no harm.
+#if !defined( KRAKEN_WATCHDOG_SIGNAL )
+    #define KRAKEN_WATCHDOG_SIGNAL          SIGURG
+#endif // !defined( KRAKEN_WATCHDOG_SIGNAL )
+
+// Take the processor away from threads that run for a time slice without yielding (see
+// kraken_preempt_start). Threads are switched from a timer signal handler, only while
+// they run code of the program itself, never inside libc or other shared libraries.
+// Linux x86_64 only, opt in.
+#if !defined( KRAKEN_ENABLE_PREEMPTION )
+    #define KRAKEN_ENABLE_PREEMPTION        0x0
+#endif // !defined( KRAKEN_ENABLE_PREEMPTION )
+
+#if KRAKEN_ENABLE_PREEMPTION && ( !defined( __linux__ ) || !defined( __x86_64__ ) )
+    #error "KRAKEN_ENABLE_PREEMPTION needs Linux on x86_64."
+#endif // KRAKEN_ENABLE_PREEMPTION && ( !defined( __linux__ ) || !defined( __x86_64__ ) )
+
+// Signal of the preemption timers
+#if !defined( KRAKEN_PREEMPT_SIGNAL )
+    #define KRAKEN_PREEMPT_SIGNAL           SIGVTALRM
+#endif // !defined( KRAKEN_PREEMPT_SIGNAL )
+
+// Park threads waiting for file descriptors on an epoll instance of their runtime (see
+// kraken_wait_readable and kraken_read). Linux only, opt in.
+#if !defined( KRAKEN_ENABLE_REACTOR )
+    #define KRAKEN_ENABLE_REACTOR           0x0
+#endif // !defined( KRAKEN_ENABLE_REACTOR )
+
+#if KRAKEN_ENABLE_REACTOR && !defined( __linux__ )
+    #error "KRAKEN_ENABLE_REACTOR needs Linux."
+#endif // KRAKEN_ENABLE_REACTOR && !defined( __linux__ )
+
+// Most epoll events a runtime handles per poll
+#if !defined( KRAKEN_REACTOR_EVENTS )
+    #define KRAKEN_REACTOR_EVENTS           64
+#endif // !defined( KRAKEN_REACTOR_EVENTS )
+
+// Run calls that block the os thread on helper os threads (see kraken_blocking). Needs
+// pthreads, so it is opt in.
+#if !defined( KRAKEN_ENABLE_OFFLOAD )
+    #define KRAKEN_ENABLE_OFFLOAD           0x0
+#endif // !defined( KRAKEN_ENABLE_OFFLOAD )
+
+// Number of helper os threads of the offload pool
+#if !defined( KRAKEN_OFFLOAD_THREADS )
+    #define KRAKEN_OFFLOAD_THREADS          4
+#endif // !defined( KRAKEN_OFFLOAD_THREADS )
+
+// Make kraken_spinlock a real lock. Needed once os threads other than the one driving a
+// runtime touch its run queue: the workers of a pool and the helpers of the offload pool
+// do. Set it to call kraken_unpark from os threads of your own.
+#if !defined( KRAKEN_ENABLE_LOCKING )
+    #if KRAKEN_ENABLE_POOL || KRAKEN_ENABLE_OFFLOAD
+        #define KRAKEN_ENABLE_LOCKING           0x1
+    #else
+        #define KRAKEN_ENABLE_LOCKING           0x0
+    #endif // KRAKEN_ENABLE_POOL || KRAKEN_ENABLE_OFFLOAD
+#endif // !defined( KRAKEN_ENABLE_LOCKING )
+
+// Capture states of a runtime (see kraken_watchdog_signal)
+#define KRAKEN_CAPTURE_IDLE             0x00
+#define KRAKEN_CAPTURE_PENDING          0x01
+#define KRAKEN_CAPTURE_DONE             0x02
+
+// Trace event codes (see kraken_trace_record)
+#define KRAKEN_TRACE_SPAWN              0x01
+#define KRAKEN_TRACE_YIELD              0x02
+#define KRAKEN_TRACE_SWITCH             0x03
+#define KRAKEN_TRACE_BLOCK              0x04
+#define KRAKEN_TRACE_WAKE               0x05
+#define KRAKEN_TRACE_EXIT               0x06
+
+// Nanoseconds a thread has to stay BLOCKED before the unused part of its stack is
+// returned to the os. Can be changed per runtime through `reclaim_after`.
+#if !defined( KRAKEN_RECLAIM_AFTER )
+    #define KRAKEN_RECLAIM_AFTER            1000000000ULL
+#endif // !defined( KRAKEN_RECLAIM_AFTER )
+
+// Nanoseconds per tick of the timer wheel, the resolution of kraken_sleep
+#if !defined( KRAKEN_TIMER_TICK )
+    #define KRAKEN_TIMER_TICK               100000ULL
+#endif // !defined( KRAKEN_TIMER_TICK )
+
+// Timer wheel geometry: KRAKEN_TIMER_LEVELS wheels of 2^KRAKEN_TIMER_BITS slots, each
+// slot of a level spanning a whole turn of the level below
+#define KRAKEN_TIMER_BITS               6
+#define KRAKEN_TIMER_SLOTS              ( 1 << KRAKEN_TIMER_BITS )
+#define KRAKEN_TIMER_LEVELS             4
+
+// Longest os thread sleep of an idle pool worker before it looks for threads to steal
+#if !defined( KRAKEN_POOL_IDLE_SLEEP )
+    #define KRAKEN_POOL_IDLE_SLEEP          1000000ULL
+#endif // !defined( KRAKEN_POOL_IDLE_SLEEP )
+
+// Park states of a thread (see kraken_park)
+#define KRAKEN_PARK_EMPTY               0x00
+#define KRAKEN_PARK_NOTIFIED            0x01
+#define KRAKEN_PARK_PARKED              0x02
+
+// What the os thread driving a runtime is doing (see kraken_idle)
+#define KRAKEN_IDLE_NONE                0x00
+#define KRAKEN_IDLE_SLEEPING            0x01
+#define KRAKEN_IDLE_POLLING             0x02
+#define KRAKEN_IDLE_WOKEN               0x03
+
+// Results of channel operations (see kraken_channel_send)
+#define KRAKEN_CHANNEL_OK               0x00
+#define KRAKEN_CHANNEL_TIMEOUT          0x01
+#define KRAKEN_CHANNEL_CLOSED           0x02
+
+// Capacity of a channel that buffers any number of messages
+#define KRAKEN_CHANNEL_UNBOUNDED        UINT32_MAX
+
+// States of a thread waiting in kraken_select
+#define KRAKEN_SELECT_WAITING           0x00
+#define KRAKEN_SELECT_CLAIMED           0x01
+#define KRAKEN_SELECT_DONE              0x02
+#define KRAKEN_SELECT_TIMEOUT           0x03
+
+// States of a thread on the wait list of a mutex, condition variable, semaphore or wait
+// group
+#define KRAKEN_WAITER_WAITING           0x00
+#define KRAKEN_WAITER_CLAIMED           0x01
+#define KRAKEN_WAITER_GRANTED           0x02
+
+// Most cases of a kraken_select
+#if !defined( KRAKEN_SELECT_CASES )
+    #define KRAKEN_SELECT_CASES             16
+#endif // !defined( KRAKEN_SELECT_CASES )
+
 #define KRAKEN_SCHEDULE_THREAD( runtime, function_name )\
 {\
     int success = kraken_start_thread( runtime, function_name );\
     assert( -1 < success );\
 }\
 
+// Thread functions are called by kraken_guard with the runtime as their only argument,
+// so they are plain functions on every architecture.
 #define KRAKEN_X86_64_THREAD_FUNCTION( name, code )\
-/*__attribute__( ( regparm( 1 ), noinline ) )*/\
 void name\
 (\
     struct kraken_runtime* runtime\
 )\
 {\
-    __asm__\
-    (\
-    "movq   %rax, -8(%rbp)  \n\t"\
-    );\
     code\
 }\
 
@@ -203,23 +448,74 @@ void name\
     struct kraken_runtime* runtime\
 )\
 {\
-    __asm__\
-    (\
-    "mov    %eax, -8(ebp)    \n\t"\
-    );\
     code\
 }\
 
-// if in debug build
-#ifdef KRAKEN_DEBUG
-    #include <stdio.h>
-#endif
+#define KRAKEN_THREAD_FUNCTION( name, code )\
+    KRAKEN_X86_64_THREAD_FUNCTION( name, code )\
+
+// Linux extensions (cpu affinity etc.) need _GNU_SOURCE defined before the first system
+// header, so include kraken.h before anything else.
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+    #define _GNU_SOURCE
+#endif // defined( __linux__ ) && !defined( _GNU_SOURCE )
+
+// kraken_print_state and friends
+#include <stdio.h>
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
 #include <stdbool.h>
 
+#if defined( __unix__ ) || defined( __APPLE__ )
+    #include <time.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+
+#if defined( __linux__ )
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif // defined( __linux__ )
+
+#if KRAKEN_ENABLE_POOL || KRAKEN_ENABLE_LOCKING
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+#endif // KRAKEN_ENABLE_POOL || KRAKEN_ENABLE_LOCKING
+
+#if KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+    #include <errno.h>
+    #include <signal.h>
+    #include <ucontext.h>
+    #include <sys/syscall.h>
+#endif // KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+
+#if KRAKEN_ENABLE_WATCHDOG
+    #include <pthread.h>
+#endif // KRAKEN_ENABLE_WATCHDOG
+
+#if KRAKEN_ENABLE_PREEMPTION
+    #include <link.h>
+    #include <pthread.h>
+#endif // KRAKEN_ENABLE_PREEMPTION
+
+#if KRAKEN_ENABLE_OFFLOAD
+    #include <pthread.h>
+#endif // KRAKEN_ENABLE_OFFLOAD
+
+#if KRAKEN_ENABLE_REACTOR
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+#endif // KRAKEN_ENABLE_REACTOR
+
 
 //===========================================================================================
 //
@@ -323,7 +619,8 @@ struct kraken_context
 /// {
 ///     STOPPED,
 ///     RUNNING,
-///     READY
+///     READY,
+///     BLOCKED
 /// };
 /// ```
 /// Member  | Description  
@@ -331,492 +628,9035 @@ struct kraken_context
 /// STOPPED | Indicates a thread has been stopped
 /// RUNNING | Indicates a thread currently being executed on the processor
 /// READY   | Indicates a thread that is ready to run on a processor core
+/// BLOCKED | Indicates a thread parked until another thread unparks it
 enum kraken_status
 {
     STOPPED,
     RUNNING,
-    READY
+    READY,
+    BLOCKED
 }; // kraken_status
 
 
-/// ### kraken_thread
-/// Represents a thread running on a processor core.
+struct kraken_runtime;
+struct kraken_pool;
+
+
+typedef void (*function_type)( struct kraken_runtime* );
+
+
+typedef void* (*kraken_routine_type)( struct kraken_runtime*, void* );
+
+
+typedef void (*kraken_task_type)( struct kraken_runtime*, void* );
+
+
+struct kraken_thread;
+
+
+typedef void (*kraken_stack_report_type)( struct kraken_thread*, uint32_t );
+
+
+typedef void (*kraken_watchdog_report_type)( struct kraken_runtime*, struct kraken_thread*,
+                                             uintptr_t, uint64_t );
+
+
+/// ### kraken_thread_stats
+/// Counters of a single thread, filled in by kraken_read_thread_stats. Times are in
+/// nanoseconds and only kept with `KRAKEN_ENABLE_STATS`.
 /// ```
-/// struct kraken_status
+/// struct kraken_thread_stats
 /// {
-///     struct kraken_context   context,
-///     enum   kraken_status    status,
-///     char*                   stack_ptr,
-///     uint16_t                id
+///     uint64_t switches,
+///     uint64_t run_time,
+///     uint64_t longest_run,
+///     uint64_t ready_time
 /// };
 /// ```
-/// Member       | Description  
-/// -------------|---------------------------------------------------------------------------
-/// context      | The state of the processor during the thread's execution
-/// status       | The status of the thread during program execution.
-/// stack_ptr    | A pointer to the first byte of the thread's stack
-struct kraken_thread
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// switches    | Number of times the thread was switched to
+/// run_time    | Time spent on the processor, not counting the current run
+/// longest_run | Longest time the thread kept the processor without switching away
+/// ready_time  | Time spent READY on a run queue waiting for the processor
+struct kraken_thread_stats
 {
-    struct kraken_context context;
-    enum kraken_status    status;
-    char*                 stack;
-    uint16_t              id;
+    uint64_t switches;
+    uint64_t run_time;
+    uint64_t longest_run;
+    uint64_t ready_time;
 };
 
 
-/// ### kraken_runtime
-/// Represents a thread running on a processor core.
+/// ### kraken_runtime_stats
+/// Counters of a runtime, filled in by kraken_read_runtime_stats. Times are in
+/// nanoseconds and only kept with `KRAKEN_ENABLE_STATS`.
 /// ```
-/// struct kraken_runtime
+/// struct kraken_runtime_stats
 /// {
-///     struct   kraken_thread    threads[KRAKEN_MAX_THREADS],
-///     struct   kraken_thread    current_thread,
+///     uint64_t switches,
+///     uint64_t idle_time,
+///     uint64_t queue_samples,
+///     uint64_t queue_total,
+///     uint32_t queue_max
 /// };
 /// ```
-/// Member       | Description  
-/// -------------|---------------------------------------------------------------------------
-/// context      | The state of the processor during the thread's execution
-/// status       | The status of the thread during program execution.
-/// stack_ptr    | A pointer to the first byte of the thread's stack
-struct kraken_runtime
+/// Member        | Description
+/// --------------|--------------------------------------------------------------------------
+/// switches      | Number of switches between threads of the runtime
+/// idle_time     | Time the os thread driving the runtime slept for lack of threads to run
+/// queue_samples | Number of run queue lengths sampled, one per switch
+/// queue_total   | Sum of the sampled lengths. `queue_total / queue_samples` is the average.
+/// queue_max     | Longest run queue seen
+struct kraken_runtime_stats
 {
-    struct kraken_thread threads[KRAKEN_MAX_THREADS];
-    struct kraken_thread *current_thread;
+    uint64_t switches;
+    uint64_t idle_time;
+    uint64_t queue_samples;
+    uint64_t queue_total;
+    uint32_t queue_max;
 };
 
 
-typedef void (*function_type)( struct kraken_runtime* );
+/// ### kraken_trace_record
+/// A scheduler event in the trace ring of a runtime (see kraken_trace_dump).
+/// ```
+/// struct kraken_trace_record
+/// {
+///     uint64_t time,
+///     uint32_t thread,
+///     uint32_t other,
+///     uint16_t owner,
+///     uint16_t other_owner,
+///     uint8_t  event
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// time        | Timestamp counter when the event happened (see kraken_ticks)
+/// thread      | Id of the thread the event is about
+/// other       | Id of the thread switched to by `KRAKEN_TRACE_SWITCH`, otherwise unused
+/// owner       | Pool index of the runtime owning `thread`, thread ids are per owner
+/// other_owner | Pool index of the runtime owning `other`
+/// event       | One of the `KRAKEN_TRACE_` event codes
+struct kraken_trace_record
+{
+    uint64_t time;
+    uint32_t thread;
+    uint32_t other;
+    uint16_t owner;
+    uint16_t other_owner;
+    uint8_t  event;
+};
 
 
-//===========================================================================================
-//
-//                           FUNCTION PROTOTYPES
-//
-//===========================================================================================
-struct kraken_runtime* kraken_initialize_runtime( void );
+/// ### kraken_profile_sample
+/// Where a runtime was when the profiling timer fired (see kraken_profile_start).
+/// ```
+/// struct kraken_profile_sample
+/// {
+///     function_type       function,
+///     kraken_routine_type routine,
+///     uintptr_t           ip,
+///     uint32_t            thread,
+///     uint16_t            owner
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// function    | Function of the thread holding the runtime, NULL for the main thread and
+///             | threads started with kraken_spawn
+/// routine     | Routine of the thread holding the runtime if it was started with
+///             | kraken_spawn, NULL otherwise
+/// ip          | The interrupted instruction pointer, 0 where it can't be read
+/// thread      | Id of the thread holding the runtime
+/// owner       | Pool index of the runtime owning `thread`, thread ids are per owner
+struct kraken_profile_sample
+{
+    function_type       function;
+    kraken_routine_type routine;
+    uintptr_t           ip;
+    uint32_t            thread;
+    uint16_t            owner;
+};
 
 
-void kraken_run (
-    struct kraken_runtime*, // runtime
-    int                     // return_code
-);
+/// ### kraken_profile_entry
+/// Samples of a thread function, filled in by kraken_profile_report.
+/// ```
+/// struct kraken_profile_entry
+/// {
+///     function_type       function,
+///     kraken_routine_type routine,
+///     uint32_t            samples
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// function    | The thread function, NULL for time spent in the main thread and in
+///             | threads started with kraken_spawn
+/// routine     | The routine of threads started with kraken_spawn, NULL otherwise
+/// samples     | Number of samples taken while a thread running `function` or `routine`
+///             | held the runtime
+struct kraken_profile_entry
+{
+    function_type       function;
+    kraken_routine_type routine;
+    uint32_t            samples;
+};
 
 
-int kraken_start_thread (
-    struct kraken_runtime*, // runtime
-    function_type           // thread_function
-);
+/// ### kraken_timer
+/// Entry of a runtime's timer wheel, embedded in the thread it wakes up.
+/// ```
+/// struct kraken_timer
+/// {
+///     struct kraken_timer**  slot,
+///     struct kraken_timer*   next,
+///     struct kraken_timer*   prev,
+///     uint64_t               tick,
+///     struct kraken_runtime* runtime
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// slot        | Head of the wheel slot the timer is on, NULL unless it is pending
+/// next        | Next timer of the slot
+/// prev        | Previous timer of the slot
+/// tick        | Wheel tick the timer expires at
+/// runtime     | The runtime whose wheel the timer is on
+struct kraken_timer
+{
+    struct kraken_timer**  slot;
+    struct kraken_timer*   next;
+    struct kraken_timer*   prev;
+    uint64_t               tick;
+    struct kraken_runtime* runtime;
+};
 
 
-static void kraken_guard (
-    struct kraken_runtime*  // runtime
-);
+/// ### kraken_blocking_type
+/// A call run on the offload pool (see kraken_blocking).
+/// ```C
+/// typedef void* ( *kraken_blocking_type )( void* argument );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// argument    | The argument handed to kraken_blocking
+/// > Returns the value kraken_blocking returns
+typedef void* ( *kraken_blocking_type )( void* );
 
 
-bool kraken_yield (
-    struct kraken_runtime*  // runtime
-);
+/// ### kraken_offload_job
+/// A call waiting for or running on the offload pool, embedded in the thread that made it.
+/// ```
+/// struct kraken_offload_job
+/// {
+///     kraken_blocking_type       function,
+///     void*                      argument,
+///     void*                      result,
+///     struct kraken_offload_job* next,
+///     struct kraken_thread*      thread,
+///     uint64_t                   queued_at,
+///     uint32_t                   done
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// function    | The call
+/// argument    | Argument of the call
+/// result      | What the call returned
+/// next        | Next call on the queue of the offload pool
+/// thread      | Thread waiting for the call
+/// queued_at   | When the call was queued
+/// done        | 1 once the call returned, 2 once the thread was woken up
+struct kraken_offload_job
+{
+    kraken_blocking_type       function;
+    void*                      argument;
+    void*                      result;
+    struct kraken_offload_job* next;
+    struct kraken_thread*      thread;
+    uint64_t                   queued_at;
+    uint32_t                   done;
+};
 
 
-void kraken_print_state (
-    struct kraken_runtime*, // runtime
-    bool                    // only_current_thread
-);
+/// ### kraken_offload_stats
+/// Counters of the offload pool, filled in by kraken_read_offload_stats. Times are in
+/// nanoseconds.
+/// ```
+/// struct kraken_offload_stats
+/// {
+///     uint64_t calls,
+///     uint64_t wait_time,
+///     uint64_t longest_wait,
+///     uint64_t run_time,
+///     uint32_t queue_depth,
+///     uint32_t queue_max,
+///     uint32_t busy
+/// };
+/// ```
+/// Member       | Description
+/// -------------|---------------------------------------------------------------------------
+/// calls        | Number of calls that returned
+/// wait_time    | Time calls spent queued before a helper picked them up
+/// longest_wait | Longest time a call spent queued
+/// run_time     | Time from a helper picking a call up to its thread being woken up
+/// queue_depth  | Number of calls queued now
+/// queue_max    | Most calls queued at once
+/// busy         | Number of helpers running a call now
+struct kraken_offload_stats
+{
+    uint64_t calls;
+    uint64_t wait_time;
+    uint64_t longest_wait;
+    uint64_t run_time;
+    uint32_t queue_depth;
+    uint32_t queue_max;
+    uint32_t busy;
+};
 
 
-static void kraken_switch (
-    struct kraken_context*, // old_context
-    struct kraken_context*, // new_context
-    struct kraken_runtime*  // runtime
-);
+/// ### kraken_io_state
+/// Threads of a runtime waiting for a file descriptor.
+/// ```
+/// struct kraken_io_state
+/// {
+///     struct kraken_thread*  reader,
+///     struct kraken_thread*  writer,
+///     bool                   registered
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// reader      | Thread waiting for the descriptor to become readable or NULL
+/// writer      | Thread waiting for the descriptor to become writable or NULL
+/// registered  | The descriptor was added to the runtime's epoll instance
+struct kraken_io_state
+{
+    struct kraken_thread*  reader;
+    struct kraken_thread*  writer;
+    bool                   registered;
+};
 
 
-//===========================================================================================
-//
-//                           FUNCTION IMPLEMENTATIONS
-//
-//===========================================================================================
+/// ### kraken_spinlock
+/// Guards state shared between os threads (run queues, thread tables).
+/// Locking compiles to nothing unless `KRAKEN_ENABLE_LOCKING` is set.
+typedef volatile int kraken_spinlock;
 
 
-/// ## Functions
-/// ***
-/// ### kraken_print_thread_state
-/// Prints the contents of a kraken_thread (see struct kraken_thread)
-/// ```C
-/// void kraken_print_thread_state ( struct kraken_thread* thread );
+/// ### kraken_select_wait
+/// Shared by the cases of a thread waiting in kraken_select. The first channel operation
+/// that moves `state` from `KRAKEN_SELECT_WAITING` to `KRAKEN_SELECT_CLAIMED` completes
+/// the select.
 /// ```
-/// Parameter | Description
-/// ----------|------------------------------------------------------------------------------
-/// thread    | A pointer to a thread whose state you want to print.
-/// Does not return.
-static void kraken_print_thread_state
-(
-    struct kraken_thread*  current_thread
-)
+/// struct kraken_select_wait
+/// {
+///     uint32_t              state,
+///     uint32_t              released,
+///     uint32_t              index,
+///     struct kraken_thread* thread
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// state       | `KRAKEN_SELECT_` state of the wait
+/// released    | Set once the thread was woken up, the wait may go away from then on
+/// index       | Case that completed the select
+/// thread      | The waiting thread
+struct kraken_select_wait
 {
-    printf(
-#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64 
-            "Thread %d address: %p.\n\
-            context addr %p\n\
-            \trsp: %p\n\
-            \tr15: %d\n\
-            \tr14: %d\n\
-            \tr13: %d\n\
-            \tr12: %d\n\
-            \trbx: %d\n\
-            \trbp: %p\n\
-            status addr %p\n\
-            status addr %p\n\
-            \tstatus %d\n\
-            stack addr %p\n\n",
-            current_thread->id,
-            current_thread,
-            &current_thread->context,
-            current_thread->context.rsp,
-            current_thread->context.r15,
-            current_thread->context.r14,
-            current_thread->context.r13,
-            current_thread->context.r12,
-            current_thread->context.rbx,
-            current_thread->context.rbp,
-            &current_thread->status,
-            current_thread->status,
-            current_thread->stack 
-#elif KRAKEN_ARCH == KRAKEN_ARCH_AVR 
-            "Thread %d address: %p.\n",0,NULL
-#endif
-         );
-} // kraken_print_thread_state
+    uint32_t              state;
+    uint32_t              released;
+    uint32_t              index;
+    struct kraken_thread* thread;
+};
 
 
-/// ### kraken_print_state
-/// Prints the contents of a kraken_runtime (see struct kraken_runtme)
-/// ```C
-/// void kraken_print_thread_state ( struct kraken_thread*  thread 
-///                                  bool                   only_current_thread );
+/// ### kraken_select_case
+/// A send or receive for kraken_select. The members after `result` are kept by the
+/// channel while the case waits.
 /// ```
-/// Parameter | Description
-/// ----------|------------------------------------------------------------------------------
-/// thread    | A pointer to a thread whose state you want to print.
-/// Does not return.
-void kraken_print_state
-(
-    struct kraken_runtime*  runtime,
-    bool                    only_current
-)
+/// struct kraken_select_case
+/// {
+///     struct kraken_channel*     channel,
+///     void*                      message,
+///     bool                       send,
+///     int                        result,
+///     struct kraken_select_case* next,
+///     struct kraken_select_case* prev,
+///     struct kraken_select_wait* wait,
+///     uint32_t                   index,
+///     bool                       linked
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel to send to or receive from
+/// message     | `element_size` bytes to send, or room for them to receive into
+/// send        | Send `message` instead of receiving into it
+/// result      | `KRAKEN_CHANNEL_OK` or `KRAKEN_CHANNEL_CLOSED` once the case completed
+/// next        | Next case waiting on the channel
+/// prev        | Previous case waiting on the channel
+/// wait        | Wait of the thread the case belongs to
+/// index       | Position of the case in its select
+/// linked      | The case is on one of the channel's waiter lists
+struct kraken_select_case
 {
-#ifdef KRAKEN_DEBUG
-    uint8_t thread_idx;
-
-    assert( runtime->current_thread != NULL );
+    struct kraken_channel*     channel;
+    void*                      message;
+    bool                       send;
+    int                        result;
+    struct kraken_select_case* next;
+    struct kraken_select_case* prev;
+    struct kraken_select_wait* wait;
+    uint32_t                   index;
+    bool                       linked;
+};
 
-    kraken_print_thread_state( runtime->current_thread );
 
-    if ( only_current != true )
-    {
-        for ( thread_idx = 0; thread_idx < KRAKEN_MAX_THREADS; thread_idx++ )
-        {
-            kraken_print_thread_state( &runtime->threads[ thread_idx ] );
-        }
-    }
-#endif
-} // kraken_print_state
+/// ### kraken_channel
+/// Passes fixed size messages between threads in order. Messages are copied into a ring
+/// buffer of `capacity` slots, or straight to a waiting receiver.
+/// ```
+/// struct kraken_channel
+/// {
+///     kraken_spinlock            lock,
+///     char*                      buffer,
+///     size_t                     element_size,
+///     uint32_t                   capacity,
+///     uint32_t                   slots,
+///     uint32_t                   head,
+///     uint32_t                   count,
+///     bool                       closed,
+///     struct kraken_select_case* senders,
+///     struct kraken_select_case* senders_tail,
+///     struct kraken_select_case* receivers,
+///     struct kraken_select_case* receivers_tail
+/// };
+/// ```
+/// Member         | Description
+/// ---------------|-------------------------------------------------------------------------
+/// lock           | Guards the channel against other runtimes of a pool
+/// buffer         | Ring of `slots` messages
+/// element_size   | Size of a message in bytes
+/// capacity       | Most messages buffered, 0 to hand every message over directly and
+///                | `KRAKEN_CHANNEL_UNBOUNDED` to never make senders wait
+/// slots          | Number of messages `buffer` has room for
+/// head           | Slot of the oldest message
+/// count          | Number of buffered messages
+/// closed         | kraken_channel_close was called
+/// senders        | Longest waiting send
+/// senders_tail   | Send that waits since last
+/// receivers      | Longest waiting receive
+/// receivers_tail | Receive that waits since last
+struct kraken_channel
+{
+    kraken_spinlock            lock;
+    char*                      buffer;
+    size_t                     element_size;
+    uint32_t                   capacity;
+    uint32_t                   slots;
+    uint32_t                   head;
+    uint32_t                   count;
+    bool                       closed;
+    struct kraken_select_case* senders;
+    struct kraken_select_case* senders_tail;
+    struct kraken_select_case* receivers;
+    struct kraken_select_case* receivers_tail;
+};
+
+
+/// ### kraken_request
+/// Something another os thread asked a runtime to do (see kraken_submit_thread).
+/// ```
+/// struct kraken_request
+/// {
+///     struct kraken_request* next,
+///     function_type          function,
+///     struct kraken_thread*  thread,
+///     int*                   status
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// next        | Request pushed before this one
+/// function    | Function of a thread to start
+/// thread      | Thread to unpark, NULL to start a thread instead
+/// status      | Where to report whether the thread could be started, or NULL
+struct kraken_request
+{
+    struct kraken_request* next;
+    function_type          function;
+    struct kraken_thread*  thread;
+    int*                   status;
+};
+
+
+/// ### kraken_task
+/// A function the main thread of a runtime runs to completion on its own stack (see
+/// kraken_post_task).
+/// ```
+/// struct kraken_task
+/// {
+///     struct kraken_task* next,
+///     kraken_task_type    function,
+///     void*               argument
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// next        | Task posted after this one, or the next record on the free list
+/// function    | The function
+/// argument    | Passed to `function`
+struct kraken_task
+{
+    struct kraken_task* next;
+    kraken_task_type    function;
+    void*               argument;
+};
+
+
+/// ### kraken_wait_list
+/// Threads waiting for a synchronization primitive in the order they started waiting,
+/// linked through `waiter_next`.
+/// ```
+/// struct kraken_wait_list
+/// {
+///     struct kraken_thread* head,
+///     struct kraken_thread* tail
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// head        | Longest waiting thread
+/// tail        | Thread waiting since last
+struct kraken_wait_list
+{
+    struct kraken_thread* head;
+    struct kraken_thread* tail;
+};
+
+
+/// ### kraken_mutex
+/// Lock whose waiters park until it is handed to them. Zero initialized means unlocked.
+/// ```
+/// struct kraken_mutex
+/// {
+///     kraken_spinlock         lock,
+///     struct kraken_thread*   owner,
+///     struct kraken_wait_list waiters
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | Guards the mutex against other runtimes of a pool
+/// owner       | Thread holding the mutex or NULL
+/// waiters     | Threads waiting for the mutex
+struct kraken_mutex
+{
+    kraken_spinlock         lock;
+    struct kraken_thread*   owner;
+    struct kraken_wait_list waiters;
+};
+
+
+/// ### kraken_cond
+/// Condition variable used with a `kraken_mutex`. Zero initialized means no waiters.
+/// ```
+/// struct kraken_cond
+/// {
+///     kraken_spinlock         lock,
+///     struct kraken_wait_list waiters
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | Guards the waiters against other runtimes of a pool
+/// waiters     | Threads waiting for a signal
+struct kraken_cond
+{
+    kraken_spinlock         lock;
+    struct kraken_wait_list waiters;
+};
+
+
+/// ### kraken_semaphore
+/// Counting semaphore. Set up with kraken_semaphore_init.
+/// ```
+/// struct kraken_semaphore
+/// {
+///     kraken_spinlock         lock,
+///     uint32_t                count,
+///     struct kraken_wait_list waiters
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | Guards the semaphore against other runtimes of a pool
+/// count       | Units left
+/// waiters     | Threads waiting for a unit
+struct kraken_semaphore
+{
+    kraken_spinlock         lock;
+    uint32_t                count;
+    struct kraken_wait_list waiters;
+};
+
+
+/// ### kraken_wait_group
+/// Counts outstanding work and lets threads wait for it to finish. Zero initialized means
+/// nothing outstanding.
+/// ```
+/// struct kraken_wait_group
+/// {
+///     kraken_spinlock         lock,
+///     int64_t                 count,
+///     struct kraken_wait_list waiters
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | Guards the group against other runtimes of a pool
+/// count       | Outstanding work
+/// waiters     | Threads waiting for `count` to drop to 0
+struct kraken_wait_group
+{
+    kraken_spinlock         lock;
+    int64_t                 count;
+    struct kraken_wait_list waiters;
+};
+
+
+/// ### kraken_generator
+/// A function running on its own stack that hands values to its consumer one at a time.
+/// Control goes back and forth with kraken_switch, the scheduler is not involved.
+/// ```
+/// struct kraken_generator
+/// {
+///     struct kraken_context    context,
+///     struct kraken_context    caller,
+///     char*                    stack,
+///     uint32_t                 stack_size,
+///     kraken_routine_type      routine,
+///     void*                    argument,
+///     void*                    value,
+///     void*                    result,
+///     bool                     running,
+///     bool                     finished,
+///     struct kraken_generator* outer
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// context     | Where the generator continues on the next kraken_generator_next
+/// caller      | Where the consumer continues on the next kraken_generator_yield
+/// stack       | Lowest usable byte of the generator's stack, NULL once it finished
+/// stack_size  | Size of the stack in bytes
+/// routine     | The function the generator runs
+/// argument    | Passed to `routine`
+/// value       | Last value handed to kraken_generator_yield
+/// result      | What `routine` returned
+/// running     | A consumer is inside kraken_generator_next
+/// finished    | `routine` returned
+/// outer       | Generator the consumer was running in when it called kraken_generator_next
+struct kraken_generator
+{
+    struct kraken_context    context;
+    struct kraken_context    caller;
+    char*                    stack;
+    uint32_t                 stack_size;
+    kraken_routine_type      routine;
+    void*                    argument;
+    void*                    value;
+    void*                    result;
+    bool                     running;
+    bool                     finished;
+    struct kraken_generator* outer;
+};
+
+
+/// ### kraken_thread
+/// Represents a thread running on a processor core.
+/// ```
+/// struct kraken_status
+/// {
+///     struct kraken_context   context,
+///     enum   kraken_status    status,
+///     char*                   stack_ptr,
+///     uint32_t                id,
+///     function_type           function,
+///     struct kraken_runtime*  runtime,
+///     struct kraken_runtime*  owner
+/// };
+/// ```
+/// Member       | Description
+/// -------------|---------------------------------------------------------------------------
+/// context      | The state of the processor during the thread's execution
+/// status       | The status of the thread during program execution.
+/// stack_ptr    | A pointer to the first byte of the thread's stack
+/// function     | The function the thread runs, NULL for threads started with kraken_spawn
+/// runtime      | The runtime the thread last ran on. Changes when a thread is stolen.
+/// owner        | The runtime whose thread table holds the thread
+/// next         | Next thread on the run queue, or on the owner's free list once STOPPED
+/// prev         | Previous thread on the run queue
+/// vruntime     | Nanoseconds the thread has spent on the processor (fair scheduler)
+/// heap_index   | Position of the thread in the fair scheduler's heap
+/// priority     | Priority level, higher runs first (priority scheduler)
+/// shared_stack | The thread runs on the shared stack of its runtime
+/// saved_stack  | Live part of the shared stack while another thread occupies it
+/// saved_size   | Number of bytes in `saved_stack`
+/// saved_capacity| Number of bytes `saved_stack` has room for
+/// stack_size   | Size of the private stack in bytes
+/// stack_peak   | Most stack bytes the thread was seen using (see kraken_stack_usage)
+/// park_state   | `KRAKEN_PARK_EMPTY`, `KRAKEN_PARK_NOTIFIED` or `KRAKEN_PARK_PARKED`
+/// blocked_since| When the thread was parked
+/// reclaim_end  | End of the stack range last returned to the os, NULL if none
+/// stats        | Counters of the thread (see kraken_read_thread_stats)
+/// ready_since  | When the thread last became READY
+/// timer        | Wakes the thread from kraken_park_until
+/// io_waiting   | Set while the thread waits for a file descriptor (see kraken_wait_readable)
+/// offload      | Call of the thread on the offload pool (see kraken_blocking)
+/// waiter_next  | Next thread on the wait list the thread is on
+/// waiter_prev  | Previous thread on the wait list the thread is on
+/// waiter_state | `KRAKEN_WAITER_` state of the thread's last wait on a wait list
+/// unpark_request| Pushed onto the owner's inbox by kraken_submit_unpark
+/// unpark_queued| `unpark_request` is on the inbox
+/// routine      | The function a thread started with kraken_spawn runs, NULL otherwise
+/// argument     | Passed to `routine`
+/// result       | What `routine` returned
+/// joinable     | The slot is kept after the thread stops until kraken_join or kraken_detach
+/// finished     | The thread stopped and waits to be joined
+/// joiners      | Threads waiting in kraken_join, guarded by the owner's `lock`
+/// generator    | Innermost generator the thread is running in, NULL if none
+struct kraken_thread
+{
+    struct kraken_context  context;
+    enum kraken_status     status;
+    char*                  stack;
+    uint32_t               id;
+    function_type          function;
+    struct kraken_runtime* runtime;
+    struct kraken_runtime* owner;
+    struct kraken_thread*  next;
+    struct kraken_thread*  prev;
+    uint64_t               vruntime;
+    uint32_t               heap_index;
+    uint8_t                priority;
+    bool                   shared_stack;
+    char*                  saved_stack;
+    uint32_t               saved_size;
+    uint32_t               saved_capacity;
+    uint32_t               stack_size;
+    uint32_t               stack_peak;
+    uint32_t               park_state;
+    uint64_t               blocked_since;
+    char*                  reclaim_end;
+    struct kraken_thread_stats stats;
+    uint64_t               ready_since;
+    struct kraken_timer    timer;
+    uint32_t               io_waiting;
+#if KRAKEN_ENABLE_OFFLOAD
+    struct kraken_offload_job offload;
+#endif // KRAKEN_ENABLE_OFFLOAD
+    struct kraken_thread*  waiter_next;
+    struct kraken_thread*  waiter_prev;
+    uint32_t               waiter_state;
+    struct kraken_request  unpark_request;
+    uint32_t               unpark_queued;
+    kraken_routine_type    routine;
+    void*                  argument;
+    void*                  result;
+    bool                   joinable;
+    bool                   finished;
+    struct kraken_wait_list joiners;
+    struct kraken_generator* generator;
+};
+
+
+/// ### kraken_runtime
+/// Represents a thread running on a processor core.
+/// ```
+/// struct kraken_runtime
+/// {
+///     struct   kraken_thread**  thread_chunks,
+///     struct   kraken_thread    current_thread,
+///     ...
+/// };
+/// ```
+/// Member          | Description
+/// ----------------|------------------------------------------------------------------------
+/// thread_chunks   | Thread table. Grows by `KRAKEN_THREAD_CHUNK` slots, slots never move.
+/// chunk_count     | Number of chunks in `thread_chunks`
+/// chunk_capacity  | Number of chunk pointers `thread_chunks` has room for
+/// used_threads    | Slots not on the free list
+/// zombie_threads  | Joinable threads that stopped and were not joined yet
+/// free_threads    | STOPPED slots ready for reuse
+/// main_thread     | The os thread that drives the runtime. It runs on its own stack.
+/// current_thread  | The thread being executed
+/// previous_thread | The thread switched away from. Handed back to the scheduler once its
+///                 | context has been saved (see kraken_finish_switch).
+/// previous_status | The status `previous_thread` takes once it is off the processor
+/// queue_head      | First READY thread waiting for this runtime, linked through `next`
+/// queue_tail      | Last READY thread waiting for this runtime
+/// queue_count     | Number of threads on the run queue
+/// heap            | READY threads ordered by `vruntime` (fair scheduler)
+/// heap_capacity   | Number of threads `heap` has room for
+/// min_vruntime    | Virtual runtime of the least served thread picked so far (fair scheduler)
+/// switch_time     | When the current thread was switched to (fair scheduler)
+/// free_stacks     | Stacks of STOPPED threads kept for reuse, one list per size, linked
+///                 | through their top word
+/// free_stack_sizes| Size of the stacks on each list of `free_stacks`
+/// free_stack_count| Number of stacks on all lists of `free_stacks`
+/// shared_stack    | Stack shared by the threads started with `shared_stack`, mapped lazily
+/// stack_occupant  | Shared stack thread whose frames are live on `shared_stack`
+/// copy_context    | Context that swaps the contents of `shared_stack` between two threads
+/// copy_stack      | Stack `copy_context` runs on
+/// copy_target     | Shared stack thread `copy_context` switches to next
+/// stack_report    | Called with the peak stack usage of every thread started on this
+///                 | runtime when it stops. Needs `KRAKEN_ENABLE_STACK_WATERMARK`.
+/// parked_head     | Longest parked thread whose stack has not been reclaimed yet, linked
+///                 | through `next` in the order the threads parked
+/// parked_tail     | Thread parked last
+/// reclaim_after   | Nanoseconds a thread stays parked before its stack is reclaimed
+/// reclaimed_bytes | Stack bytes returned to the os so far
+/// stats           | Counters of the runtime (see kraken_read_runtime_stats)
+/// run_start       | When the current thread was switched to
+/// trace           | Ring of `KRAKEN_TRACE_SIZE` trace records, NULL unless
+///                 | `KRAKEN_ENABLE_TRACE` is set
+/// trace_head      | Number of records ever written to `trace`
+/// trace_ticks     | Timestamp counter when the runtime was created
+/// trace_time      | Monotonic clock when the runtime was created
+/// profile_samples | Samples of the current or last profile, `KRAKEN_PROFILE_SIZE` of them
+/// profile_count   | Number of samples taken
+/// profile_dropped | Number of samples lost because `profile_samples` was full
+/// profile_timer   | Timer signalling the os thread driving the runtime while profiling
+/// profiling       | `profile_timer` is armed
+/// os_thread       | The os thread driving the runtime
+/// schedule_count  | Number of times a thread of the runtime yielded, parked or stopped
+/// preempt_timer   | Timer signalling the os thread driving the runtime once per slice
+/// preempt_seen    | `schedule_count` when the preemption timer last fired
+/// preempting      | `preempt_timer` is armed
+/// preemptions     | Number of threads taken off the processor by the preemption timer
+/// capture_state   | `KRAKEN_CAPTURE_` state of the watchdog asking where the runtime is
+/// capture_thread  | Thread that held the runtime when the watchdog signal arrived
+/// capture_ip      | Instruction pointer the watchdog signal interrupted
+/// timer_wheel     | Pending timers. Level 0 has a slot per tick, level n a slot per
+///                 | `KRAKEN_TIMER_SLOTS`^n ticks.
+/// timer_tick      | Last wheel tick expired, in `KRAKEN_TIMER_TICK`s of the monotonic clock
+/// timer_count     | Number of pending timers
+/// idle            | `KRAKEN_IDLE_` state of the os thread driving the runtime. A wake while
+///                 | it is awake makes its next kraken_idle return right away.
+/// reactor_fd      | Epoll instance of the threads waiting for file descriptors, -1 until
+///                 | one does
+/// wake_fd         | Eventfd waking the os thread while it waits on `reactor_fd`
+/// io_table        | Waiting threads by file descriptor
+/// io_capacity     | Number of descriptors `io_table` has room for
+/// io_waiters      | Number of threads waiting for file descriptors
+/// inbox           | Requests of other os threads, the last one pushed first
+/// task_head       | Oldest task waiting to run
+/// task_tail       | Task posted last
+/// task_count      | Number of tasks waiting to run
+/// free_tasks      | Records of tasks that ran, ready for reuse
+/// task_running    | The main thread is running tasks
+/// level_heads     | First READY thread of each priority level (priority scheduler)
+/// level_tails     | Last READY thread of each priority level (priority scheduler)
+/// level_bitmap    | Bit n is set while level n has READY threads (priority scheduler)
+/// lock            | Guards the run queue and the thread table against other runtimes of a pool
+/// pool            | The pool this runtime belongs to or NULL
+/// index           | Position of the runtime in its pool
+struct kraken_runtime
+{
+    struct kraken_thread** thread_chunks;
+    uint32_t               chunk_count;
+    uint32_t               chunk_capacity;
+    uint32_t               used_threads;
+    uint32_t               zombie_threads;
+    struct kraken_thread*  free_threads;
+    struct kraken_thread*  main_thread;
+    struct kraken_thread*  current_thread;
+    struct kraken_thread*  previous_thread;
+    enum kraken_status     previous_status;
+    struct kraken_thread*  queue_head;
+    struct kraken_thread*  queue_tail;
+    uint32_t               queue_count;
+    struct kraken_thread** heap;
+    uint32_t               heap_capacity;
+    uint64_t               min_vruntime;
+    uint64_t               switch_time;
+    char*                  free_stacks[ KRAKEN_STACK_SIZES ];
+    uint32_t               free_stack_sizes[ KRAKEN_STACK_SIZES ];
+    uint32_t               free_stack_count;
+    char*                  shared_stack;
+    struct kraken_thread*  stack_occupant;
+    struct kraken_context  copy_context;
+    char*                  copy_stack;
+    struct kraken_thread*  copy_target;
+    kraken_stack_report_type stack_report;
+    struct kraken_thread*  parked_head;
+    struct kraken_thread*  parked_tail;
+    uint64_t               reclaim_after;
+    uint64_t               reclaimed_bytes;
+    struct kraken_runtime_stats stats;
+    uint64_t               run_start;
+    struct kraken_trace_record* trace;
+    uint64_t               trace_head;
+    uint64_t               trace_ticks;
+    uint64_t               trace_time;
+#if KRAKEN_ENABLE_PROFILER
+    struct kraken_profile_sample* profile_samples;
+    uint32_t               profile_count;
+    uint32_t               profile_dropped;
+    timer_t                profile_timer;
+    bool                   profiling;
+#endif // KRAKEN_ENABLE_PROFILER
+#if KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+    uint64_t               schedule_count;
+#endif // KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+#if KRAKEN_ENABLE_WATCHDOG
+    pthread_t              os_thread;
+    uint32_t               capture_state;
+    struct kraken_thread*  capture_thread;
+    uintptr_t              capture_ip;
+#endif // KRAKEN_ENABLE_WATCHDOG
+#if KRAKEN_ENABLE_PREEMPTION
+    timer_t                preempt_timer;
+    uint64_t               preempt_seen;
+    bool                   preempting;
+    uint64_t               preemptions;
+#endif // KRAKEN_ENABLE_PREEMPTION
+    struct kraken_timer*   timer_wheel[ KRAKEN_TIMER_LEVELS ][ KRAKEN_TIMER_SLOTS ];
+    uint64_t               timer_tick;
+    uint32_t               timer_count;
+    uint32_t               idle;
+#if KRAKEN_ENABLE_REACTOR
+    int                    reactor_fd;
+    int                    wake_fd;
+    struct kraken_io_state* io_table;
+    uint32_t               io_capacity;
+    uint32_t               io_waiters;
+#endif // KRAKEN_ENABLE_REACTOR
+    struct kraken_request* inbox;
+    struct kraken_task*    task_head;
+    struct kraken_task*    task_tail;
+    uint32_t               task_count;
+    struct kraken_task*    free_tasks;
+    bool                   task_running;
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+    struct kraken_thread*  level_heads[ KRAKEN_PRIORITY_LEVELS ];
+    struct kraken_thread*  level_tails[ KRAKEN_PRIORITY_LEVELS ];
+    uint64_t               level_bitmap;
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+    kraken_spinlock        lock;
+    struct kraken_pool*    pool;
+    uint16_t               index;
+};
+
+
+/// ### kraken_pool
+/// A group of runtimes, one per processor core. Each runtime is driven by an os thread
+/// pinned to its core and idle runtimes steal READY threads from busy ones.
+/// ```
+/// struct kraken_pool
+/// {
+///     struct kraken_runtime** runtimes,
+///     uint16_t                runtime_count,
+///     ...
+/// };
+/// ```
+/// Member        | Description
+/// --------------|--------------------------------------------------------------------------
+/// runtimes      | One runtime per worker
+/// runtime_count | Number of runtimes/workers
+/// next_runtime  | Runtime the next kraken_pool_start_thread lands on
+/// live_threads  | Threads started in the pool that have not stopped yet, and tasks posted
+///               | or threads submitted to its runtimes that have not run yet
+/// profile_hz    | Samples per second of processor time each worker profiles its runtime
+///               | with while the pool runs, 0 for none. Needs `KRAKEN_ENABLE_PROFILER`.
+/// preempt_slice | Time slice in nanoseconds each worker preempts the threads of its runtime
+///               | after while the pool runs, 0 for none. Needs `KRAKEN_ENABLE_PREEMPTION`.
+struct kraken_pool
+{
+    struct kraken_runtime** runtimes;
+    uint16_t                runtime_count;
+    uint16_t                next_runtime;
+    uint32_t                live_threads;
+    uint32_t                profile_hz;
+    uint64_t                preempt_slice;
+};
+
+
+/// ### kraken_watchdog
+/// Helper os thread watching a set of runtimes (see kraken_watchdog_start).
+/// ```
+/// struct kraken_watchdog
+/// {
+///     struct kraken_runtime**     runtimes,
+///     uint16_t                    runtime_count,
+///     uint64_t                    budget,
+///     kraken_watchdog_report_type report,
+///     ...
+/// };
+/// ```
+/// Member        | Description
+/// --------------|--------------------------------------------------------------------------
+/// runtimes      | The watched runtimes
+/// runtime_count | Number of runtimes in `runtimes`
+/// budget        | Nanoseconds a thread may keep a runtime without yielding
+/// report        | Called on the watchdog's os thread for every overrun
+/// seen_counts   | `schedule_count` of each runtime when the watchdog last looked
+/// seen_since    | When `seen_counts` last changed
+/// reported      | The overrun of each runtime since `seen_since` has been reported
+/// thread        | The watchdog's os thread
+/// running       | Cleared to stop the watchdog
+struct kraken_watchdog
+{
+    struct kraken_runtime**     runtimes;
+    uint16_t                    runtime_count;
+    uint64_t                    budget;
+    kraken_watchdog_report_type report;
+#if KRAKEN_ENABLE_WATCHDOG
+    uint64_t*                   seen_counts;
+    uint64_t*                   seen_since;
+    bool*                       reported;
+    pthread_t                   thread;
+#endif // KRAKEN_ENABLE_WATCHDOG
+    volatile bool               running;
+};
+
+
+#if KRAKEN_ENABLE_OFFLOAD
+/// ### kraken_offload_pool
+/// Helper os threads running the blocking calls of every runtime of the process.
+/// ```
+/// struct kraken_offload_pool
+/// {
+///     pthread_once_t              once,
+///     pthread_mutex_t             mutex,
+///     pthread_cond_t              ready,
+///     struct kraken_offload_job*  head,
+///     struct kraken_offload_job*  tail,
+///     uint32_t                    threads,
+///     struct kraken_offload_stats stats
+/// };
+/// ```
+/// Member      | Description
+/// ------------|----------------------------------------------------------------------------
+/// once        | Starts the helpers on the first call
+/// mutex       | Guards the queue and the counters
+/// ready       | Signalled when a call is queued
+/// head        | Call queued first
+/// tail        | Call queued last
+/// threads     | Number of helpers started
+/// stats       | Counters of the pool (see kraken_read_offload_stats)
+struct kraken_offload_pool
+{
+    pthread_once_t              once;
+    pthread_mutex_t             mutex;
+    pthread_cond_t              ready;
+    struct kraken_offload_job*  head;
+    struct kraken_offload_job*  tail;
+    uint32_t                    threads;
+    struct kraken_offload_stats stats;
+};
+
+
+static struct kraken_offload_pool kraken_offload =
+{
+    PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL, 0,
+    { 0, 0, 0, 0, 0, 0, 0 }
+};
+#endif // KRAKEN_ENABLE_OFFLOAD
+
+
+/// ### kraken_thread_options
+/// Optional settings for kraken_start_thread_ex. Pass NULL for the defaults.
+/// ```
+/// struct kraken_thread_options
+/// {
+///     uint8_t  priority,
+///     bool     shared_stack,
+///     uint32_t stack_size
+/// };
+/// ```
+/// Member       | Description
+/// -------------|---------------------------------------------------------------------------
+/// priority     | Priority level below `KRAKEN_PRIORITY_LEVELS`, higher runs first.
+///              | Only used by the priority scheduler.
+/// shared_stack | Run on the runtime's shared stack instead of a private one. Only the live
+///              | part of the stack is kept per thread, copied out whenever another shared
+///              | stack thread runs. Such threads are never stolen. x86_64 only.
+/// stack_size   | Size of the private stack in bytes, 0 for `KRAKEN_STACK_SIZE`. Stacks are
+///              | cached per size, up to `KRAKEN_STACK_SIZES` different sizes (see
+///              | kraken_stack_release).
+struct kraken_thread_options
+{
+    uint8_t  priority;
+    bool     shared_stack;
+    uint32_t stack_size;
+};
+
+
+//===========================================================================================
+//
+//                           FUNCTION PROTOTYPES
+//
+//===========================================================================================
+struct kraken_runtime* kraken_initialize_runtime( void );
+
+
+void kraken_run (
+    struct kraken_runtime*, // runtime
+    int                     // return_code
+);
+
+
+void kraken_wait (
+    struct kraken_runtime*  // runtime
+);
+
+
+int kraken_start_thread (
+    struct kraken_runtime*, // runtime
+    function_type           // thread_function
+);
+
+
+int kraken_start_thread_ex (
+    struct kraken_runtime*,                 // runtime
+    function_type,                          // thread_function
+    const struct kraken_thread_options*     // options
+);
+
+
+int kraken_start_threads (
+    struct kraken_runtime*,                 // runtime
+    function_type,                          // thread_function
+    uint32_t,                               // count
+    const struct kraken_thread_options*     // options
+);
+
+
+struct kraken_thread* kraken_spawn (
+    struct kraken_runtime*,                 // runtime
+    kraken_routine_type,                    // routine
+    void*,                                  // argument
+    const struct kraken_thread_options*     // options
+);
+
+
+void* kraken_join (
+    struct kraken_runtime*, // runtime
+    struct kraken_thread*   // thread
+);
+
+
+void kraken_detach (
+    struct kraken_thread*   // thread
+);
+
+
+struct kraken_generator* kraken_generator_create (
+    struct kraken_runtime*, // runtime
+    kraken_routine_type,    // routine
+    void*,                  // argument
+    uint32_t                // stack_size
+);
+
+
+bool kraken_generator_next (
+    struct kraken_runtime*,     // runtime
+    struct kraken_generator*,   // generator
+    void**                      // value
+);
+
+
+void kraken_generator_yield (
+    struct kraken_runtime*, // runtime
+    void*                   // value
+);
+
+
+void kraken_generator_destroy (
+    struct kraken_runtime*,     // runtime
+    struct kraken_generator*    // generator
+);
+
+
+uint32_t kraken_stack_usage (
+    struct kraken_thread*   // thread
+);
+
+
+void kraken_read_thread_stats (
+    struct kraken_thread*,      // thread
+    struct kraken_thread_stats* // stats
+);
+
+
+void kraken_read_runtime_stats (
+    struct kraken_runtime*,     // runtime
+    struct kraken_runtime_stats*// stats
+);
+
+
+static void kraken_guard (
+    struct kraken_runtime*  // runtime
+);
+
+
+bool kraken_yield (
+    struct kraken_runtime*  // runtime
+);
+
+
+void kraken_park (
+    struct kraken_runtime*  // runtime
+);
+
+
+void kraken_unpark (
+    struct kraken_thread*   // thread
+);
+
+
+bool kraken_park_until (
+    struct kraken_runtime*, // runtime
+    uint64_t                // deadline
+);
+
+
+void kraken_sleep (
+    struct kraken_runtime*, // runtime
+    uint64_t                // nanoseconds
+);
+
+
+void kraken_sleep_until (
+    struct kraken_runtime*, // runtime
+    uint64_t                // deadline
+);
+
+
+static void kraken_timers_advance (
+    struct kraken_runtime*  // runtime
+);
+
+
+static uint64_t kraken_timers_next (
+    struct kraken_runtime*  // runtime
+);
+
+
+static void kraken_idle (
+    struct kraken_runtime*, // runtime
+    uint64_t                // deadline
+);
+
+
+static void kraken_wake (
+    struct kraken_runtime*  // runtime
+);
+
+
+int kraken_submit_thread (
+    struct kraken_runtime*, // runtime
+    function_type           // thread_function
+);
+
+
+int kraken_submit_thread_ex (
+    struct kraken_runtime*, // runtime
+    function_type,          // thread_function
+    int*                    // status
+);
+
+
+void kraken_submit_unpark (
+    struct kraken_thread*   // thread
+);
+
+
+static void kraken_inbox_drain (
+    struct kraken_runtime*  // runtime
+);
+
+
+int kraken_post_task (
+    struct kraken_runtime*, // runtime
+    kraken_task_type,       // function
+    void*                   // argument
+);
+
+
+static void kraken_tasks_run (
+    struct kraken_runtime*  // runtime
+);
+
+
+#if KRAKEN_ENABLE_REACTOR
+int kraken_wait_readable (
+    struct kraken_runtime*, // runtime
+    int                     // fd
+);
+
+
+int kraken_wait_writable (
+    struct kraken_runtime*, // runtime
+    int                     // fd
+);
+
+
+ssize_t kraken_read (
+    struct kraken_runtime*, // runtime
+    int,                    // fd
+    void*,                  // buffer
+    size_t                  // count
+);
+
+
+ssize_t kraken_write (
+    struct kraken_runtime*, // runtime
+    int,                    // fd
+    const void*,            // buffer
+    size_t                  // count
+);
+
+
+int kraken_accept (
+    struct kraken_runtime*, // runtime
+    int,                    // fd
+    struct sockaddr*,       // address
+    socklen_t*              // address_length
+);
+
+
+int kraken_connect (
+    struct kraken_runtime*, // runtime
+    int,                    // fd
+    const struct sockaddr*, // address
+    socklen_t               // address_length
+);
+
+
+static void kraken_reactor_poll (
+    struct kraken_runtime*, // runtime
+    int                     // timeout
+);
+#endif // KRAKEN_ENABLE_REACTOR
+
+
+#if KRAKEN_ENABLE_OFFLOAD
+void* kraken_blocking (
+    struct kraken_runtime*, // runtime
+    kraken_blocking_type,   // function
+    void*                   // argument
+);
+
+
+void kraken_read_offload_stats (
+    struct kraken_offload_stats* // stats
+);
+#endif // KRAKEN_ENABLE_OFFLOAD
+
+
+struct kraken_channel* kraken_channel_create (
+    size_t,                 // element_size
+    uint32_t                // capacity
+);
+
+
+void kraken_channel_destroy (
+    struct kraken_channel*  // channel
+);
+
+
+void kraken_channel_close (
+    struct kraken_channel*  // channel
+);
+
+
+int kraken_channel_send (
+    struct kraken_runtime*, // runtime
+    struct kraken_channel*, // channel
+    const void*             // message
+);
+
+
+int kraken_channel_recv (
+    struct kraken_runtime*, // runtime
+    struct kraken_channel*, // channel
+    void*                   // message
+);
+
+
+int kraken_channel_send_until (
+    struct kraken_runtime*, // runtime
+    struct kraken_channel*, // channel
+    const void*,            // message
+    uint64_t                // deadline
+);
+
+
+int kraken_channel_recv_until (
+    struct kraken_runtime*, // runtime
+    struct kraken_channel*, // channel
+    void*,                  // message
+    uint64_t                // deadline
+);
+
+
+int kraken_channel_try_send (
+    struct kraken_channel*, // channel
+    const void*             // message
+);
+
+
+int kraken_channel_try_recv (
+    struct kraken_channel*, // channel
+    void*                   // message
+);
+
+
+int kraken_select (
+    struct kraken_runtime*,     // runtime
+    struct kraken_select_case*, // cases
+    uint32_t,                   // count
+    uint64_t                    // deadline
+);
+
+
+void kraken_mutex_lock (
+    struct kraken_runtime*, // runtime
+    struct kraken_mutex*    // mutex
+);
+
+
+bool kraken_mutex_lock_until (
+    struct kraken_runtime*, // runtime
+    struct kraken_mutex*,   // mutex
+    uint64_t                // deadline
+);
+
+
+bool kraken_mutex_try_lock (
+    struct kraken_runtime*, // runtime
+    struct kraken_mutex*    // mutex
+);
+
+
+void kraken_mutex_unlock (
+    struct kraken_runtime*, // runtime
+    struct kraken_mutex*    // mutex
+);
+
+
+void kraken_cond_wait (
+    struct kraken_runtime*, // runtime
+    struct kraken_cond*,    // cond
+    struct kraken_mutex*    // mutex
+);
+
+
+bool kraken_cond_wait_until (
+    struct kraken_runtime*, // runtime
+    struct kraken_cond*,    // cond
+    struct kraken_mutex*,   // mutex
+    uint64_t                // deadline
+);
+
+
+void kraken_cond_signal (
+    struct kraken_cond*     // cond
+);
+
+
+void kraken_cond_broadcast (
+    struct kraken_cond*     // cond
+);
+
+
+void kraken_semaphore_init (
+    struct kraken_semaphore*,   // semaphore
+    uint32_t                    // count
+);
+
+
+void kraken_semaphore_acquire (
+    struct kraken_runtime*,     // runtime
+    struct kraken_semaphore*    // semaphore
+);
+
+
+bool kraken_semaphore_acquire_until (
+    struct kraken_runtime*,     // runtime
+    struct kraken_semaphore*,   // semaphore
+    uint64_t                    // deadline
+);
+
+
+void kraken_semaphore_release (
+    struct kraken_semaphore*    // semaphore
+);
+
+
+void kraken_wait_group_add (
+    struct kraken_wait_group*,  // group
+    int64_t                     // delta
+);
+
+
+void kraken_wait_group_done (
+    struct kraken_wait_group*   // group
+);
+
+
+void kraken_wait_group_wait (
+    struct kraken_runtime*,     // runtime
+    struct kraken_wait_group*   // group
+);
+
+
+static struct kraken_thread* kraken_waiters_pop (
+    struct kraken_wait_list*    // list
+);
+
+
+static void kraken_waiters_grant (
+    struct kraken_thread*       // thread
+);
+
+
+static bool kraken_reschedule (
+    struct kraken_runtime*, // runtime
+    enum kraken_status      // status
+);
+
+
+static void kraken_finish_switch (
+    struct kraken_runtime*  // runtime
+);
+
+
+#if KRAKEN_ENABLE_POOL
+struct kraken_pool* kraken_initialize_pool (
+    uint16_t                // runtime_count
+);
+
+
+int kraken_pool_start_thread (
+    struct kraken_pool*,    // pool
+    function_type           // thread_function
+);
+
+
+void kraken_pool_wait (
+    struct kraken_pool*     // pool
+);
+
+
+void kraken_pool_run (
+    struct kraken_pool*,    // pool
+    int                     // return_code
+);
+
+
+int kraken_pool_trace_dump (
+    struct kraken_pool*,    // pool
+    FILE*                   // file
+);
+#endif // KRAKEN_ENABLE_POOL
+
+
+void kraken_print_state (
+    struct kraken_runtime*, // runtime
+    bool                    // only_current_thread
+);
+
+
+int kraken_trace_dump (
+    struct kraken_runtime*, // runtime
+    FILE*                   // file
+);
+
+
+#if KRAKEN_ENABLE_WATCHDOG
+struct kraken_watchdog* kraken_watchdog_start (
+    struct kraken_runtime**,        // runtimes
+    uint16_t,                       // runtime_count
+    uint64_t,                       // budget
+    kraken_watchdog_report_type     // report
+);
+
+
+void kraken_watchdog_stop (
+    struct kraken_watchdog*         // watchdog
+);
+#endif // KRAKEN_ENABLE_WATCHDOG
+
+
+#if KRAKEN_ENABLE_PREEMPTION
+int kraken_preempt_start (
+    struct kraken_runtime*, // runtime
+    uint64_t                // slice
+);
+
+
+void kraken_preempt_stop (
+    struct kraken_runtime*  // runtime
+);
+#endif // KRAKEN_ENABLE_PREEMPTION
+
+
+void kraken_preempt_disable (
+    void
+);
+
+
+void kraken_preempt_enable (
+    void
+);
+
+
+#if KRAKEN_ENABLE_PROFILER
+int kraken_profile_start (
+    struct kraken_runtime*, // runtime
+    uint32_t                // hz
+);
+
+
+void kraken_profile_stop (
+    struct kraken_runtime*  // runtime
+);
+
+
+uint32_t kraken_profile_report (
+    struct kraken_runtime*,         // runtime
+    struct kraken_profile_entry*,   // entries
+    uint32_t                        // capacity
+);
+#endif // KRAKEN_ENABLE_PROFILER
+
+
+static void kraken_switch (
+    struct kraken_context*, // old_context
+    struct kraken_context*, // new_context
+    struct kraken_runtime*  // runtime
+);
+
+
+//===========================================================================================
+//
+//                           FUNCTION IMPLEMENTATIONS
+//
+//===========================================================================================
+
+
+/// ## Functions
+/// ***
+/// ### kraken_print_thread_state
+/// Prints the contents of a kraken_thread (see struct kraken_thread)
+/// ```C
+/// void kraken_print_thread_state ( struct kraken_thread* thread );
+/// ```
+/// Parameter | Description
+/// ----------|------------------------------------------------------------------------------
+/// thread    | A pointer to a thread whose state you want to print.
+/// Does not return.
+static void kraken_print_thread_state
+(
+    struct kraken_thread*  current_thread
+)
+{
+    printf( "Thread %u address: %p\n"
+            "\tstatus: %d\n"
+            "\tstack: %p\n"
+            "\tswitches: %llu\n"
+            "\trun time: %llu ns\n"
+            "\tlongest run: %llu ns\n"
+            "\tready time: %llu ns\n",
+            ( unsigned )current_thread->id,
+            ( void* )current_thread,
+            ( int )current_thread->status,
+            ( void* )current_thread->stack,
+            ( unsigned long long )current_thread->stats.switches,
+            ( unsigned long long )current_thread->stats.run_time,
+            ( unsigned long long )current_thread->stats.longest_run,
+            ( unsigned long long )current_thread->stats.ready_time );
+
+#ifdef KRAKEN_DEBUG
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    printf( "\tcontext: %p\n"
+            "\trsp: 0x%016llx\n"
+            "\tr15: 0x%016llx\n"
+            "\tr14: 0x%016llx\n"
+            "\tr13: 0x%016llx\n"
+            "\tr12: 0x%016llx\n"
+            "\trbx: 0x%016llx\n"
+            "\trbp: 0x%016llx\n",
+            ( void* )&current_thread->context,
+            ( unsigned long long )current_thread->context.rsp,
+            ( unsigned long long )current_thread->context.r15,
+            ( unsigned long long )current_thread->context.r14,
+            ( unsigned long long )current_thread->context.r13,
+            ( unsigned long long )current_thread->context.r12,
+            ( unsigned long long )current_thread->context.rbx,
+            ( unsigned long long )current_thread->context.rbp );
+#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
+    printf( "\tcontext: %p\n"
+            "\tesp: 0x%08lx\n"
+            "\tebx: 0x%08lx\n"
+            "\tebp: 0x%08lx\n",
+            ( void* )&current_thread->context,
+            ( unsigned long )current_thread->context.esp,
+            ( unsigned long )current_thread->context.ebx,
+            ( unsigned long )current_thread->context.ebp );
+#endif // KRAKEN_ARCH
+#endif // KRAKEN_DEBUG
+
+    printf( "\n" );
+} // kraken_print_thread_state
+
+
+/// ### kraken_print_state
+/// Prints the counters of a runtime and the state of its threads (see
+/// struct kraken_runtime). Registers are only printed in `KRAKEN_DEBUG` builds.
+/// ```C
+/// void kraken_print_state ( struct kraken_runtime* runtime,
+///                           bool                   only_current );
+/// ```
+/// Parameter    | Description
+/// -------------|---------------------------------------------------------------------------
+/// runtime      | A pointer to the runtime whose state you want to print.
+/// only_current | Print the current thread only, skipping the thread table
+/// Does not return.
+void kraken_print_state
+(
+    struct kraken_runtime*  runtime,
+    bool                    only_current
+)
+{
+    struct kraken_runtime_stats stats;
+    uint32_t                    chunk_idx;
+    uint32_t                    thread_idx;
+
+    assert( runtime->current_thread != NULL );
+
+    kraken_read_runtime_stats( runtime, &stats );
+
+    printf( "Runtime %p\n"
+            "\tswitches: %llu\n"
+            "\tidle time: %llu ns\n"
+            "\tqueue length: %u now, %llu average, %u max\n\n",
+            ( void* )runtime,
+            ( unsigned long long )stats.switches,
+            ( unsigned long long )stats.idle_time,
+            ( unsigned )runtime->queue_count,
+            ( unsigned long long )( 0 == stats.queue_samples ?
+                                    0 : stats.queue_total / stats.queue_samples ),
+            ( unsigned )stats.queue_max );
+
+    kraken_print_thread_state( runtime->current_thread );
+
+    if ( only_current != true )
+    {
+        for ( chunk_idx = 0; chunk_idx < runtime->chunk_count; chunk_idx++ )
+        {
+            for ( thread_idx = 0; thread_idx < KRAKEN_THREAD_CHUNK; thread_idx++ )
+            {
+                struct kraken_thread* thread = &runtime->thread_chunks[ chunk_idx ][ thread_idx ];
+
+                if ( STOPPED != thread->status && thread != runtime->current_thread )
+                {
+                    kraken_print_thread_state( thread );
+                }
+            }
+        }
+    }
+} // kraken_print_state
+
+
+#if KRAKEN_ENABLE_POOL
+// Runtime driven by the calling os thread. Set by the workers of a pool.
+static __thread struct kraken_runtime* kraken_local_runtime = NULL;
+#endif // KRAKEN_ENABLE_POOL
+
+
+/// ### kraken_now
+/// Reads the monotonic clock.
+/// ```C
+/// uint64_t kraken_now ( void );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// > Returns nanoseconds since an arbitrary point in the past, 0 without a clock
+static inline uint64_t kraken_now
+(
+    void
+)
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( uint64_t )now.tv_sec * 1000000000ull + ( uint64_t )now.tv_nsec;
+#else
+    return 0;
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+} // kraken_now
+
+
+/// ### kraken_local
+/// Returns the runtime driven by the calling os thread. Threads of a pool move between
+/// runtimes, so the runtime a thread function was started with may be stale.
+/// ```C
+/// struct kraken_runtime* kraken_local ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime the caller was handed
+/// > Returns the runtime the caller is running on
+static inline struct kraken_runtime* kraken_local
+(
+    struct kraken_runtime*  runtime
+)
+{
+#if KRAKEN_ENABLE_POOL
+    if ( NULL != kraken_local_runtime )
+    {
+        return kraken_local_runtime;
+    }
+#endif // KRAKEN_ENABLE_POOL
+    return runtime;
+} // kraken_local
+
+
+/// ### kraken_ticks
+/// Reads the processor's timestamp counter, or the monotonic clock where there is none.
+/// ```C
+/// uint64_t kraken_ticks ( void );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// > Returns a timestamp in an architecture specific unit
+static inline uint64_t kraken_ticks
+(
+    void
+)
+{
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64 || KRAKEN_ARCH == KRAKEN_ARCH_X86
+    uint32_t low;
+    uint32_t high;
+
+    __asm__ __volatile__ ( "rdtsc" : "=a" ( low ), "=d" ( high ) );
+
+    return ( ( uint64_t )high << 32 ) | low;
+#else
+    return kraken_now();
+#endif // KRAKEN_ARCH == KRAKEN_ARCH_X86_64 || KRAKEN_ARCH == KRAKEN_ARCH_X86
+} // kraken_ticks
+
+
+/// ### kraken_trace
+/// Appends an event to the trace ring of a runtime, overwriting the oldest record once
+/// the ring is full. Any os thread may record into any runtime. Does nothing unless
+/// `KRAKEN_ENABLE_TRACE` is set.
+/// ```C
+/// void kraken_trace ( struct kraken_runtime* runtime,
+///                     uint8_t                event,
+///                     struct kraken_thread*  thread,
+///                     struct kraken_thread*  other )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime whose ring the record goes into
+/// event       | One of the `KRAKEN_TRACE_` event codes
+/// thread      | The thread the event is about
+/// other       | The thread switched to or NULL
+/// Does not return.
+static inline void kraken_trace
+(
+    struct kraken_runtime*  runtime,
+    uint8_t                 event,
+    struct kraken_thread*   thread,
+    struct kraken_thread*   other
+)
+{
+#if KRAKEN_ENABLE_TRACE
+    uint64_t                    slot   = __atomic_fetch_add( &runtime->trace_head, 1,
+                                                             __ATOMIC_RELAXED );
+    struct kraken_trace_record* record = &runtime->trace[ slot & ( KRAKEN_TRACE_SIZE - 1 ) ];
+
+    record->time        = kraken_ticks();
+    record->thread      = thread->id;
+    record->owner       = thread->owner->index;
+    record->other       = NULL == other ? 0 : other->id;
+    record->other_owner = NULL == other ? 0 : other->owner->index;
+    record->event       = event;
+#else
+    ( void )runtime;
+    ( void )event;
+    ( void )thread;
+    ( void )other;
+#endif // KRAKEN_ENABLE_TRACE
+} // kraken_trace
+
+
+/// ### kraken_trace_write
+/// Writes the records in the trace ring of a runtime as Chrome trace events. Each runtime
+/// becomes a track showing which thread held it, spawns, yields, blocks, wakes and exits
+/// show up as instant events.
+/// ```C
+/// void kraken_trace_write ( struct kraken_runtime* runtime,
+///                           FILE*                  file,
+///                           bool*                  first )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime whose ring is written
+/// file        | Where the events go
+/// first       | True until the first event of the array was written
+/// Does not return.
+static void kraken_trace_write
+(
+    struct kraken_runtime*  runtime,
+    FILE*                   file,
+    bool*                   first
+)
+{
+    static const char* const event_names[] =
+    {
+        "", "spawn", "yield", "switch", "block", "wake", "exit"
+    };
+
+    uint64_t                    head   = __atomic_load_n( &runtime->trace_head,
+                                                          __ATOMIC_ACQUIRE );
+    uint64_t                    oldest = KRAKEN_TRACE_SIZE < head ? head - KRAKEN_TRACE_SIZE : 0;
+    uint64_t                    ticks  = kraken_ticks() - runtime->trace_ticks;
+    uint64_t                    time   = kraken_now() - runtime->trace_time;
+    // nanoseconds per tick, measured over the lifetime of the runtime
+    double                      scale  = 0 == ticks ? 0.0 : ( double )time / ticks;
+    double                      since  = 0.0;
+    double                      now;
+    bool                        held   = false;
+    uint16_t                    owner  = 0;
+    uint32_t                    thread = 0;
+    uint64_t                    slot;
+
+    if ( NULL == runtime->trace )
+    {
+        return;
+    }
+
+    fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+                   "\"args\":{\"name\":\"runtime %u\"}}",
+             *first ? "\n" : ",\n", ( unsigned )runtime->index, ( unsigned )runtime->index );
+    *first = false;
+
+    for ( slot = oldest; slot < head; slot++ )
+    {
+        struct kraken_trace_record* record = &runtime->trace[ slot & ( KRAKEN_TRACE_SIZE - 1 ) ];
+
+        // microseconds on the monotonic clock, so the tracks of a pool line up
+        now = ( runtime->trace_time +
+                ( double )( int64_t )( record->time - runtime->trace_ticks ) * scale ) / 1000.0;
+
+        if ( slot == oldest )
+        {
+            since = now;
+        }
+
+        if ( KRAKEN_TRACE_SWITCH != record->event )
+        {
+            fprintf( file, ",\n{\"name\":\"%s\",\"cat\":\"kraken\",\"ph\":\"i\",\"s\":\"t\","
+                           "\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                           "\"args\":{\"thread\":\"%u.%u\"}}",
+                     event_names[ record->event ], ( unsigned )runtime->index, now,
+                     ( unsigned )record->owner, ( unsigned )record->thread );
+            continue;
+        }
+
+        // the first switch in the ring tells who ran before it, from the oldest record on
+        if ( !held )
+        {
+            owner  = record->owner;
+            thread = record->thread;
+        }
+
+        fprintf( file, ",\n{\"name\":\"thread %u.%u\",\"cat\":\"kraken\",\"ph\":\"X\","
+                       "\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                 ( unsigned )owner, ( unsigned )thread, ( unsigned )runtime->index,
+                 since, now - since );
+
+        held   = true;
+        since  = now;
+        owner  = record->other_owner;
+        thread = record->other;
+    }
+} // kraken_trace_write
+
+
+/// ### kraken_trace_dump
+/// Writes the trace ring of a runtime as Chrome trace JSON, which chrome://tracing and
+/// Perfetto can open. Needs `KRAKEN_ENABLE_TRACE`. Records written while dumping may
+/// come out garbled, so dump from the runtime's own os thread or once it is idle.
+/// ```C
+/// int kraken_trace_dump ( struct kraken_runtime* runtime,
+///                         FILE*                  file )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// file        | Where the JSON goes
+/// > Returns 0 on success and -1 if writing failed
+int kraken_trace_dump
+(
+    struct kraken_runtime*  runtime,
+    FILE*                   file
+)
+{
+    bool first = true;
+
+    fprintf( file, "{\"traceEvents\":[" );
+    kraken_trace_write( runtime, file, &first );
+    fprintf( file, "\n]}\n" );
+
+    return 0 == fflush( file ) && 0 == ferror( file ) ? 0 : -1;
+} // kraken_trace_dump
+
+
+#if KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+/// ### kraken_signal_ip
+/// Reads the instruction pointer a signal interrupted.
+/// ```C
+/// uintptr_t kraken_signal_ip ( void* context )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// context     | The `ucontext_t` handed to an `SA_SIGINFO` handler
+/// > Returns the instruction pointer, 0 where it can't be read
+static inline uintptr_t kraken_signal_ip
+(
+    void*   context
+)
+{
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    return ( uintptr_t )( ( ucontext_t* )context )->uc_mcontext.gregs[ REG_RIP ];
+#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
+    return ( uintptr_t )( ( ucontext_t* )context )->uc_mcontext.gregs[ REG_EIP ];
+#else
+    ( void )context;
+
+    return 0;
+#endif // KRAKEN_ARCH
+} // kraken_signal_ip
+#endif // KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+
+
+#if KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_PREEMPTION
+/// ### kraken_timer_start
+/// Creates and arms a timer that counts the processor time of the calling os thread and
+/// signals only that os thread, handing the runtime to the signal handler.
+/// ```C
+/// int kraken_timer_start ( struct kraken_runtime* runtime,
+///                          int                    signal_number,
+///                          uint64_t               interval,
+///                          timer_t*               timer )
+/// ```
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// runtime       | Passed to the handler in `si_value`
+/// signal_number | The signal to send
+/// interval      | Nanoseconds of processor time between signals
+/// timer         | Receives the timer
+/// > Returns 0 on success and -1 if the timer can't be created
+static int kraken_timer_start
+(
+    struct kraken_runtime*  runtime,
+    int                     signal_number,
+    uint64_t                interval,
+    timer_t*                timer
+)
+{
+    struct sigevent   event;
+    struct itimerspec period;
+
+    memset( &event, 0, sizeof( event ) );
+    event.sigev_notify          = SIGEV_THREAD_ID;
+    event.sigev_signo           = signal_number;
+    event.sigev_value.sival_ptr = runtime;
+#if defined( sigev_notify_thread_id )
+    event.sigev_notify_thread_id = ( pid_t )syscall( SYS_gettid );
+#else
+    event._sigev_un._tid         = ( pid_t )syscall( SYS_gettid );
+#endif // defined( sigev_notify_thread_id )
+
+    if ( 0 != timer_create( CLOCK_THREAD_CPUTIME_ID, &event, timer ) )
+    {
+        return -1;
+    }
+
+    period.it_interval.tv_sec  = ( time_t )( interval / 1000000000ULL );
+    period.it_interval.tv_nsec = ( long )( interval % 1000000000ULL );
+    period.it_value            = period.it_interval;
+
+    if ( 0 != timer_settime( *timer, 0, &period, NULL ) )
+    {
+        timer_delete( *timer );
+
+        return -1;
+    }
+
+    return 0;
+} // kraken_timer_start
+#endif // KRAKEN_ENABLE_PROFILER || KRAKEN_ENABLE_PREEMPTION
+
+
+#if KRAKEN_ENABLE_PROFILER
+// SIGPROF handler that was installed before the profiler's, e.g. the one of gprof
+static struct sigaction kraken_profile_previous;
+
+
+/// ### kraken_profile_signal
+/// SIGPROF handler. Records the thread holding the runtime the timer belongs to. Signals
+/// that don't come from a profiling timer are passed on to the previous handler.
+/// ```C
+/// void kraken_profile_signal ( int        signal_number,
+///                              siginfo_t* info,
+///                              void*      context )
+/// ```
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// signal_number | SIGPROF
+/// info          | Carries the profiled runtime for signals of kraken_profile_start's timers
+/// context       | The interrupted `ucontext_t`
+/// Does not return.
+static void kraken_profile_signal
+(
+    int         signal_number,
+    siginfo_t*  info,
+    void*       context
+)
+{
+    struct kraken_runtime*        runtime;
+    struct kraken_thread*         thread;
+    struct kraken_profile_sample* sample;
+
+    if ( SI_TIMER != info->si_code )
+    {
+        if ( kraken_profile_previous.sa_flags & SA_SIGINFO )
+        {
+            kraken_profile_previous.sa_sigaction( signal_number, info, context );
+        }
+        else if ( SIG_DFL != kraken_profile_previous.sa_handler &&
+                  SIG_IGN != kraken_profile_previous.sa_handler )
+        {
+            kraken_profile_previous.sa_handler( signal_number );
+        }
+
+        return;
+    }
+
+    runtime = ( struct kraken_runtime* )info->si_value.sival_ptr;
+
+    if ( !runtime->profiling )
+    {
+        return;
+    }
+
+    if ( KRAKEN_PROFILE_SIZE <= runtime->profile_count )
+    {
+        runtime->profile_dropped++;
+
+        return;
+    }
+
+    // only the os thread driving the runtime is signalled, it can't be mid update here
+    thread         = runtime->current_thread;
+    sample         = &runtime->profile_samples[ runtime->profile_count++ ];
+    sample->thread = thread->id;
+    sample->owner  = thread->owner->index;
+    // the main thread has no function of its own, it runs the scheduler
+    sample->function = thread == runtime->main_thread ? NULL : thread->function;
+    sample->routine  = thread->routine;
+    sample->ip       = kraken_signal_ip( context );
+} // kraken_profile_signal
+
+
+/// ### kraken_profile_start
+/// Starts sampling which thread holds a runtime, `hz` times per second of processor time
+/// used by the calling os thread. Has to be called from the os thread driving the runtime.
+/// Samples of an earlier profile are discarded.
+/// ```C
+/// int kraken_profile_start ( struct kraken_runtime* runtime,
+///                            uint32_t               hz )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// hz          | Samples per second, at most 1000000000
+/// > Returns 0 on success and -1 if the timer or the sample buffer can't be set up
+int kraken_profile_start
+(
+    struct kraken_runtime*  runtime,
+    uint32_t                hz
+)
+{
+    struct sigaction action;
+    struct sigaction previous;
+
+    assert( 0 < hz && 1000000000 >= hz && "KRAKEN: Invalid profiling rate." );
+
+    if ( runtime->profiling )
+    {
+        kraken_profile_stop( runtime );
+    }
+
+    if ( NULL == runtime->profile_samples )
+    {
+        runtime->profile_samples = ( struct kraken_profile_sample* )
+            calloc( KRAKEN_PROFILE_SIZE, sizeof( struct kraken_profile_sample ) );
+
+        if ( NULL == runtime->profile_samples )
+        {
+            return -1;
+        }
+    }
+
+    runtime->profile_count   = 0;
+    runtime->profile_dropped = 0;
+
+    // install the handler once, keeping whatever handled SIGPROF before
+    sigaction( SIGPROF, NULL, &previous );
+
+    if ( !( previous.sa_flags & SA_SIGINFO ) || kraken_profile_signal != previous.sa_sigaction )
+    {
+        memset( &action, 0, sizeof( action ) );
+        sigemptyset( &action.sa_mask );
+        action.sa_sigaction = kraken_profile_signal;
+        action.sa_flags     = SA_SIGINFO | SA_RESTART;
+
+        if ( 0 != sigaction( SIGPROF, &action, &kraken_profile_previous ) )
+        {
+            return -1;
+        }
+    }
+
+    runtime->profiling = true;
+
+    if ( 0 != kraken_timer_start( runtime, SIGPROF, 1000000000ULL / hz,
+                                  &runtime->profile_timer ) )
+    {
+        runtime->profiling = false;
+
+        return -1;
+    }
+
+    return 0;
+} // kraken_profile_start
+
+
+/// ### kraken_profile_stop
+/// Stops sampling a runtime. The samples stay around for kraken_profile_report.
+/// ```C
+/// void kraken_profile_stop ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+void kraken_profile_stop
+(
+    struct kraken_runtime*  runtime
+)
+{
+    if ( !runtime->profiling )
+    {
+        return;
+    }
+
+    runtime->profiling = false;
+    timer_delete( runtime->profile_timer );
+} // kraken_profile_stop
+
+
+/// ### kraken_profile_compare
+/// Orders profile entries by descending sample count for qsort.
+/// ```C
+/// int kraken_profile_compare ( const void* left,
+///                              const void* right )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// left        | A pointer to `struct kraken_profile_entry`
+/// right       | A pointer to `struct kraken_profile_entry`
+/// > Returns a negative number if `left` has more samples, positive if it has fewer
+static int kraken_profile_compare
+(
+    const void* left,
+    const void* right
+)
+{
+    uint32_t left_samples  = ( ( const struct kraken_profile_entry* )left )->samples;
+    uint32_t right_samples = ( ( const struct kraken_profile_entry* )right )->samples;
+
+    return ( left_samples < right_samples ) - ( left_samples > right_samples );
+} // kraken_profile_compare
+
+
+/// ### kraken_profile_report
+/// Adds up the samples of a runtime per thread function or routine, busiest first. Stop
+/// the profile first or samples may be added while counting.
+/// ```C
+/// uint32_t kraken_profile_report ( struct kraken_runtime*       runtime,
+///                                  struct kraken_profile_entry* entries,
+///                                  uint32_t                     capacity )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// entries     | Receives one entry per thread function
+/// capacity    | Number of entries `entries` has room for. Samples of functions that don't
+///             | fit are not counted.
+/// > Returns the number of entries filled in
+uint32_t kraken_profile_report
+(
+    struct kraken_runtime*       runtime,
+    struct kraken_profile_entry* entries,
+    uint32_t                     capacity
+)
+{
+    uint32_t entry_count = 0;
+    uint32_t sample_idx;
+    uint32_t entry_idx;
+
+    for ( sample_idx = 0; sample_idx < runtime->profile_count; sample_idx++ )
+    {
+        function_type       function = runtime->profile_samples[ sample_idx ].function;
+        kraken_routine_type routine  = runtime->profile_samples[ sample_idx ].routine;
+
+        for ( entry_idx = 0; entry_idx < entry_count; entry_idx++ )
+        {
+            if ( function == entries[ entry_idx ].function &&
+                 routine == entries[ entry_idx ].routine )
+            {
+                break;
+            }
+        }
+
+        if ( entry_idx == entry_count )
+        {
+            if ( entry_count == capacity )
+            {
+                continue;
+            }
+
+            entries[ entry_count ].function = function;
+            entries[ entry_count ].routine  = routine;
+            entries[ entry_count ].samples  = 0;
+            entry_count++;
+        }
+
+        entries[ entry_idx ].samples++;
+    }
+
+    qsort( entries, entry_count, sizeof( struct kraken_profile_entry ), kraken_profile_compare );
+
+    return entry_count;
+} // kraken_profile_report
+#endif // KRAKEN_ENABLE_PROFILER
+
+
+#if KRAKEN_ENABLE_WATCHDOG
+/// ### kraken_watchdog_signal
+/// Handler of `KRAKEN_WATCHDOG_SIGNAL`. Runs on the os thread driving the runtime the
+/// watchdog asked about and records which thread holds it and where it is.
+/// ```C
+/// void kraken_watchdog_signal ( int        signal_number,
+///                               siginfo_t* info,
+///                               void*      context )
+/// ```
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// signal_number | `KRAKEN_WATCHDOG_SIGNAL`
+/// info          | Carries the runtime the watchdog asked about
+/// context       | The interrupted `ucontext_t`
+/// Does not return.
+static void kraken_watchdog_signal
+(
+    int         signal_number,
+    siginfo_t*  info,
+    void*       context
+)
+{
+    struct kraken_runtime* runtime = ( struct kraken_runtime* )info->si_value.sival_ptr;
+
+    ( void )signal_number;
+
+    if ( SI_QUEUE != info->si_code || NULL == runtime ||
+         KRAKEN_CAPTURE_PENDING != __atomic_load_n( &runtime->capture_state, __ATOMIC_ACQUIRE ) )
+    {
+        return;
+    }
+
+    runtime->capture_thread = runtime->current_thread;
+    runtime->capture_ip     = kraken_signal_ip( context );
+
+    __atomic_store_n( &runtime->capture_state, KRAKEN_CAPTURE_DONE, __ATOMIC_RELEASE );
+} // kraken_watchdog_signal
+
+
+/// ### kraken_watchdog_check
+/// Reports the thread holding a runtime if it has not yielded within the budget. The
+/// runtime is interrupted to find out where the thread is, the report is only made if
+/// the thread is still running by then.
+/// ```C
+/// void kraken_watchdog_check ( struct kraken_watchdog* watchdog,
+///                              uint16_t                runtime_idx,
+///                              uint64_t                now )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// watchdog    | A pointer to `struct kraken_watchdog`
+/// runtime_idx | Position of the runtime in `watchdog->runtimes`
+/// now         | The monotonic clock
+/// Does not return.
+static void kraken_watchdog_check
+(
+    struct kraken_watchdog* watchdog,
+    uint16_t                runtime_idx,
+    uint64_t                now
+)
+{
+    struct kraken_runtime* runtime = watchdog->runtimes[ runtime_idx ];
+    uint64_t               count   = __atomic_load_n( &runtime->schedule_count, __ATOMIC_ACQUIRE );
+    union sigval           value;
+    uint32_t               spins;
+
+    if ( count != watchdog->seen_counts[ runtime_idx ] )
+    {
+        watchdog->seen_counts[ runtime_idx ] = count;
+        watchdog->seen_since[ runtime_idx ]  = now;
+        watchdog->reported[ runtime_idx ]    = false;
+
+        return;
+    }
+
+    // the main thread waiting on its own is not holding up any thread
+    if ( watchdog->reported[ runtime_idx ] ||
+         now - watchdog->seen_since[ runtime_idx ] < watchdog->budget ||
+         runtime->main_thread == __atomic_load_n( &runtime->current_thread, __ATOMIC_ACQUIRE ) )
+    {
+        return;
+    }
+
+    watchdog->reported[ runtime_idx ] = true;
+
+    __atomic_store_n( &runtime->capture_state, KRAKEN_CAPTURE_PENDING, __ATOMIC_RELEASE );
+
+    value.sival_ptr = runtime;
+
+    if ( 0 != pthread_sigqueue( runtime->os_thread, KRAKEN_WATCHDOG_SIGNAL, value ) )
+    {
+        __atomic_store_n( &runtime->capture_state, KRAKEN_CAPTURE_IDLE, __ATOMIC_RELEASE );
+
+        return;
+    }
+
+    // the signal is handled as soon as the os thread is back on a core
+    for ( spins = 0; spins < 1000; spins++ )
+    {
+        if ( KRAKEN_CAPTURE_DONE == __atomic_load_n( &runtime->capture_state, __ATOMIC_ACQUIRE ) )
+        {
+            break;
+        }
+
+        sched_yield();
+    }
+
+    if ( KRAKEN_CAPTURE_DONE == __atomic_exchange_n( &runtime->capture_state, KRAKEN_CAPTURE_IDLE,
+                                                     __ATOMIC_ACQ_REL ) &&
+         count == __atomic_load_n( &runtime->schedule_count, __ATOMIC_ACQUIRE ) &&
+         runtime->main_thread != runtime->capture_thread )
+    {
+        watchdog->report( runtime, runtime->capture_thread, runtime->capture_ip,
+                          kraken_now() - watchdog->seen_since[ runtime_idx ] );
+    }
+} // kraken_watchdog_check
+
+
+/// ### kraken_watchdog_loop
+/// Body of the watchdog's os thread. Looks at every runtime four times per budget.
+/// ```C
+/// void* kraken_watchdog_loop ( void* watchdog )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// watchdog    | A pointer to `struct kraken_watchdog`
+/// > Returns NULL once kraken_watchdog_stop was called
+static void* kraken_watchdog_loop
+(
+    void*   watchdog_pointer
+)
+{
+    struct kraken_watchdog* watchdog = ( struct kraken_watchdog* )watchdog_pointer;
+    struct timespec         period;
+    uint16_t                runtime_idx;
+
+    period.tv_sec  = ( time_t )( watchdog->budget / 4 / 1000000000ULL );
+    period.tv_nsec = ( long )( watchdog->budget / 4 % 1000000000ULL );
+
+    while ( watchdog->running )
+    {
+        nanosleep( &period, NULL );
+
+        for ( runtime_idx = 0; runtime_idx < watchdog->runtime_count; runtime_idx++ )
+        {
+            kraken_watchdog_check( watchdog, runtime_idx, kraken_now() );
+        }
+    }
+
+    return NULL;
+} // kraken_watchdog_loop
+
+
+/// ### kraken_watchdog_start
+/// Starts an os thread that reports threads keeping one of the given runtimes for more
+/// than `budget` nanoseconds without yielding, parking or stopping. Each overrun is
+/// reported once, from the watchdog's os thread, with the instruction pointer the thread
+/// was interrupted at. The thread may have moved on by the time the report runs.
+/// ```C
+/// struct kraken_watchdog* kraken_watchdog_start ( struct kraken_runtime**     runtimes,
+///                                                 uint16_t                    runtime_count,
+///                                                 uint64_t                    budget,
+///                                                 kraken_watchdog_report_type report )
+/// ```
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// runtimes      | The runtimes to watch, e.g. `pool->runtimes`. The array has to outlive
+///               | the watchdog.
+/// runtime_count | Number of runtimes in `runtimes`
+/// budget        | Nanoseconds a thread may keep a runtime without yielding
+/// report        | Called with the runtime, the thread, its instruction pointer and the
+///               | nanoseconds it has run for
+/// > Returns a pointer to `struct kraken_watchdog` or NULL if it can't be started
+struct kraken_watchdog* kraken_watchdog_start
+(
+    struct kraken_runtime**     runtimes,
+    uint16_t                    runtime_count,
+    uint64_t                    budget,
+    kraken_watchdog_report_type report
+)
+{
+    struct sigaction        action;
+    struct kraken_watchdog* watchdog;
+    uint64_t                now = kraken_now();
+    uint16_t                runtime_idx;
+
+    assert( NULL != runtimes && NULL != report && 0 < budget &&
+            "KRAKEN: Invalid watchdog settings." );
+
+    watchdog = ( struct kraken_watchdog* )calloc( 1, sizeof( struct kraken_watchdog ) );
+
+    if ( NULL == watchdog )
+    {
+        return NULL;
+    }
+
+    watchdog->runtimes      = runtimes;
+    watchdog->runtime_count = runtime_count;
+    watchdog->budget        = budget;
+    watchdog->report        = report;
+    watchdog->seen_counts   = ( uint64_t* )calloc( runtime_count, sizeof( uint64_t ) );
+    watchdog->seen_since    = ( uint64_t* )calloc( runtime_count, sizeof( uint64_t ) );
+    watchdog->reported      = ( bool* )calloc( runtime_count, sizeof( bool ) );
+
+    if ( NULL == watchdog->seen_counts || NULL == watchdog->seen_since ||
+         NULL == watchdog->reported )
+    {
+        kraken_watchdog_stop( watchdog );
+
+        return NULL;
+    }
+
+    for ( runtime_idx = 0; runtime_idx < runtime_count; runtime_idx++ )
+    {
+        watchdog->seen_counts[ runtime_idx ] = runtimes[ runtime_idx ]->schedule_count;
+        watchdog->seen_since[ runtime_idx ]  = now;
+    }
+
+    memset( &action, 0, sizeof( action ) );
+    sigemptyset( &action.sa_mask );
+    action.sa_sigaction = kraken_watchdog_signal;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART;
+
+    if ( 0 != sigaction( KRAKEN_WATCHDOG_SIGNAL, &action, NULL ) )
+    {
+        kraken_watchdog_stop( watchdog );
+
+        return NULL;
+    }
+
+    watchdog->running = true;
+
+    if ( 0 != pthread_create( &watchdog->thread, NULL, kraken_watchdog_loop, watchdog ) )
+    {
+        watchdog->running = false;
+
+        kraken_watchdog_stop( watchdog );
+
+        return NULL;
+    }
+
+    return watchdog;
+} // kraken_watchdog_start
+
+
+/// ### kraken_watchdog_stop
+/// Stops a watchdog and frees it. Waits for a report that is running to return.
+/// ```C
+/// void kraken_watchdog_stop ( struct kraken_watchdog* watchdog )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// watchdog    | A pointer to `struct kraken_watchdog`
+/// Does not return.
+void kraken_watchdog_stop
+(
+    struct kraken_watchdog* watchdog
+)
+{
+    // a watchdog that failed to start has no os thread to join
+    if ( watchdog->running )
+    {
+        watchdog->running = false;
+        pthread_join( watchdog->thread, NULL );
+    }
+
+    free( watchdog->seen_counts );
+    free( watchdog->seen_since );
+    free( watchdog->reported );
+    free( watchdog );
+} // kraken_watchdog_stop
+#endif // KRAKEN_ENABLE_WATCHDOG
+
+
+#if KRAKEN_ENABLE_PREEMPTION
+// Number of kraken_preempt_disable calls of the calling os thread not yet undone
+static __thread uint32_t kraken_preempt_depth = 0;
+
+// Most executable segments of the program image kraken_preempt_image records
+#define KRAKEN_PREEMPT_RANGES           8
+
+// Executable segments of the image kraken is linked into, start and end address each
+static uintptr_t      kraken_preempt_ranges[ KRAKEN_PREEMPT_RANGES ][ 2 ];
+static uint32_t       kraken_preempt_range_count = 0;
+static pthread_once_t kraken_preempt_once        = PTHREAD_ONCE_INIT;
+#endif // KRAKEN_ENABLE_PREEMPTION
+
+
+/// ### kraken_preempt_disable
+/// Keeps the preemption timer from switching away from the calling thread until the
+/// matching kraken_preempt_enable. Wrap code of the program that takes locks other threads
+/// of the runtime may need. Library code, like `malloc`, is never preempted. Calls nest.
+/// Does nothing unless `KRAKEN_ENABLE_PREEMPTION` is set.
+/// ```C
+/// void kraken_preempt_disable ( void )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// Does not return.
+void kraken_preempt_disable
+(
+    void
+)
+{
+#if KRAKEN_ENABLE_PREEMPTION
+    kraken_preempt_depth++;
+    __atomic_signal_fence( __ATOMIC_SEQ_CST );
+#endif // KRAKEN_ENABLE_PREEMPTION
+} // kraken_preempt_disable
+
+
+/// ### kraken_preempt_enable
+/// Undoes a kraken_preempt_disable.
+/// ```C
+/// void kraken_preempt_enable ( void )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// Does not return.
+void kraken_preempt_enable
+(
+    void
+)
+{
+#if KRAKEN_ENABLE_PREEMPTION
+    __atomic_signal_fence( __ATOMIC_SEQ_CST );
+    kraken_preempt_depth--;
+#endif // KRAKEN_ENABLE_PREEMPTION
+} // kraken_preempt_enable
+
+
+#if KRAKEN_ENABLE_PREEMPTION
+static void kraken_preempt_signal (
+    int,                    // signal_number
+    siginfo_t*,             // info
+    void*                   // context
+);
+
+
+static struct kraken_thread* kraken_queue_first (
+    struct kraken_runtime*  // runtime
+);
+
+
+static inline void kraken_lock (
+    kraken_spinlock*        // lock
+);
+
+
+static inline void kraken_unlock (
+    kraken_spinlock*        // lock
+);
+
+
+/// ### kraken_preempt_segments
+/// Callback of dl_iterate_phdr. Records the executable segments of the loaded object that
+/// holds kraken's own code.
+/// ```C
+/// int kraken_preempt_segments ( struct dl_phdr_info* info,
+///                               size_t               size,
+///                               void*                data )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// info        | A loaded object
+/// size        | Size of `info`
+/// data        | Unused
+/// > Returns 1 once the object was found, which ends the iteration
+static int kraken_preempt_segments
+(
+    struct dl_phdr_info*    info,
+    size_t                  size,
+    void*                   data
+)
+{
+    uintptr_t own_code = ( uintptr_t )kraken_preempt_signal;
+    bool      found    = false;
+    uintptr_t start;
+    uintptr_t end;
+    uint16_t  header_idx;
+
+    ( void )size;
+    ( void )data;
+
+    for ( header_idx = 0; header_idx < info->dlpi_phnum; header_idx++ )
+    {
+        start = info->dlpi_addr + info->dlpi_phdr[ header_idx ].p_vaddr;
+        end   = start + info->dlpi_phdr[ header_idx ].p_memsz;
+
+        found = found || ( PT_LOAD == info->dlpi_phdr[ header_idx ].p_type &&
+                           start <= own_code && own_code < end );
+    }
+
+    if ( !found )
+    {
+        return 0;
+    }
+
+    for ( header_idx = 0; header_idx < info->dlpi_phnum &&
+                          KRAKEN_PREEMPT_RANGES > kraken_preempt_range_count; header_idx++ )
+    {
+        if ( PT_LOAD == info->dlpi_phdr[ header_idx ].p_type &&
+             0 != ( PF_X & info->dlpi_phdr[ header_idx ].p_flags ) )
+        {
+            start = info->dlpi_addr + info->dlpi_phdr[ header_idx ].p_vaddr;
+
+            kraken_preempt_ranges[ kraken_preempt_range_count ][ 0 ] = start;
+            kraken_preempt_ranges[ kraken_preempt_range_count ][ 1 ] =
+                start + info->dlpi_phdr[ header_idx ].p_memsz;
+            kraken_preempt_range_count++;
+        }
+    }
+
+    return 1;
+} // kraken_preempt_segments
+
+
+/// ### kraken_preempt_image
+/// Looks up the executable segments of the program image once.
+/// ```C
+/// void kraken_preempt_image ( void )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// Does not return.
+static void kraken_preempt_image
+(
+    void
+)
+{
+    dl_iterate_phdr( kraken_preempt_segments, NULL );
+} // kraken_preempt_image
+
+
+/// ### kraken_preempt_safe
+/// Tells whether an interrupted instruction belongs to the program image. libc and other
+/// shared libraries keep per os thread state like the malloc caches without locks, so a
+/// thread switched away from inside them would leave that state to the next thread.
+/// ```C
+/// bool kraken_preempt_safe ( uintptr_t ip )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// ip          | The interrupted instruction pointer
+/// > Returns true if the thread can be switched away from at `ip`
+static inline bool kraken_preempt_safe
+(
+    uintptr_t   ip
+)
+{
+    uint32_t range_idx;
+
+    for ( range_idx = 0; range_idx < kraken_preempt_range_count; range_idx++ )
+    {
+        if ( kraken_preempt_ranges[ range_idx ][ 0 ] <= ip &&
+             ip < kraken_preempt_ranges[ range_idx ][ 1 ] )
+        {
+            return true;
+        }
+    }
+
+    return false;
+} // kraken_preempt_safe
+
+
+/// ### kraken_preempt_signal
+/// Handler of `KRAKEN_PREEMPT_SIGNAL`. Yields on behalf of the interrupted thread if it
+/// has not yielded for a whole slice, is not in a section kraken_preempt_disable protects
+/// and was interrupted in the program's own code (see kraken_preempt_safe). The kernel
+/// saved every register in the signal frame on the thread's stack, so kraken_switch only
+/// has to save what a call would and the thread picks up where it was interrupted once it
+/// is switched back to and the handler returns.
+/// ```C
+/// void kraken_preempt_signal ( int        signal_number,
+///                              siginfo_t* info,
+///                              void*      context )
+/// ```
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// signal_number | `KRAKEN_PREEMPT_SIGNAL`
+/// info          | Carries the runtime the timer belongs to
+/// context       | The interrupted `ucontext_t`
+/// Does not return.
+static void kraken_preempt_signal
+(
+    int         signal_number,
+    siginfo_t*  info,
+    void*       context
+)
+{
+    struct kraken_runtime* runtime = ( struct kraken_runtime* )info->si_value.sival_ptr;
+    struct kraken_thread*  current_thread;
+    struct kraken_thread*  next_thread;
+    uint64_t               count;
+    int                    saved_errno;
+
+    ( void )signal_number;
+
+    if ( SI_TIMER != info->si_code || NULL == runtime || !runtime->preempting ||
+         0 != kraken_preempt_depth )
+    {
+        return;
+    }
+
+    current_thread = runtime->current_thread;
+    count          = runtime->schedule_count;
+
+    // a thread that yielded during the last slice gets another one
+    if ( count != runtime->preempt_seen )
+    {
+        runtime->preempt_seen = count;
+
+        return;
+    }
+
+    // the main thread drives the runtime and frames on the shared stack are copied lazily
+    if ( current_thread == runtime->main_thread || current_thread->shared_stack ||
+         !kraken_preempt_safe( kraken_signal_ip( context ) ) )
+    {
+        return;
+    }
+
+    // switching to a thread on the shared stack may allocate its save buffer
+    kraken_lock( &runtime->lock );
+    next_thread = kraken_queue_first( runtime );
+    kraken_unlock( &runtime->lock );
+
+    if ( NULL != next_thread && next_thread->shared_stack )
+    {
+        return;
+    }
+
+    saved_errno = errno;
+
+    runtime->preemptions++;
+    kraken_reschedule( runtime, READY );
+
+    errno = saved_errno;
+} // kraken_preempt_signal
+
+
+/// ### kraken_preempt_start
+/// Starts taking the processor away from threads of a runtime that run for `slice`
+/// nanoseconds of processor time without yielding, parking or stopping. Has to be called
+/// from the os thread driving the runtime. Preempted threads are READY again right away.
+/// Threads are only switched away from while they run the program's own code, never
+/// inside libc or other shared libraries. Locks the program takes itself and other threads
+/// of the runtime may wait for have to be wrapped in kraken_preempt_disable. Threads on the
+/// shared stack are never preempted, and never switched to by a preemption.
+/// ```C
+/// int kraken_preempt_start ( struct kraken_runtime* runtime,
+///                            uint64_t               slice )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// slice       | Time slice in nanoseconds
+/// > Returns 0 on success and -1 if the timer can't be set up
+int kraken_preempt_start
+(
+    struct kraken_runtime*  runtime,
+    uint64_t                slice
+)
+{
+    struct sigaction action;
+
+    assert( 0 < slice && "KRAKEN: Invalid time slice." );
+
+    kraken_preempt_stop( runtime );
+
+    pthread_once( &kraken_preempt_once, kraken_preempt_image );
+
+    // nested signals are turned away by kraken_preempt_depth. Not blocking the signal
+    // in the handler keeps the threads switched to from there preemptible.
+    memset( &action, 0, sizeof( action ) );
+    sigemptyset( &action.sa_mask );
+    action.sa_sigaction = kraken_preempt_signal;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART | SA_NODEFER;
+
+    if ( 0 != sigaction( KRAKEN_PREEMPT_SIGNAL, &action, NULL ) )
+    {
+        return -1;
+    }
+
+    runtime->preempt_seen = runtime->schedule_count;
+    runtime->preempting   = true;
+
+    if ( 0 != kraken_timer_start( runtime, KRAKEN_PREEMPT_SIGNAL, slice,
+                                  &runtime->preempt_timer ) )
+    {
+        runtime->preempting = false;
+
+        return -1;
+    }
+
+    return 0;
+} // kraken_preempt_start
+
+
+/// ### kraken_preempt_stop
+/// Stops preempting the threads of a runtime.
+/// ```C
+/// void kraken_preempt_stop ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+void kraken_preempt_stop
+(
+    struct kraken_runtime*  runtime
+)
+{
+    if ( !runtime->preempting )
+    {
+        return;
+    }
+
+    runtime->preempting = false;
+    timer_delete( runtime->preempt_timer );
+} // kraken_preempt_stop
+#endif // KRAKEN_ENABLE_PREEMPTION
+
+
+/// ### kraken_lock
+/// Acquires a `kraken_spinlock`. Does nothing unless `KRAKEN_ENABLE_LOCKING` is set.
+/// ```C
+/// void kraken_lock ( kraken_spinlock* lock );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | The lock to acquire
+/// Does not return.
+static inline void kraken_lock
+(
+    kraken_spinlock*    lock
+)
+{
+    // a thread preempted while holding the lock would stall every runtime of the pool
+    kraken_preempt_disable();
+
+#if KRAKEN_ENABLE_LOCKING
+    uint32_t spins = 0;
+
+    while ( __atomic_exchange_n( lock, 1, __ATOMIC_ACQUIRE ) )
+    {
+        while ( __atomic_load_n( lock, __ATOMIC_RELAXED ) )
+        {
+            // the holder may have been preempted, give it the core back
+            if ( ++spins % 64 == 0 )
+            {
+                sched_yield();
+            }
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64 || KRAKEN_ARCH == KRAKEN_ARCH_X86
+            __asm__ __volatile__ ( "pause" );
+#endif
+        }
+    }
+#else
+    ( void )lock;
+#endif // KRAKEN_ENABLE_LOCKING
+} // kraken_lock
+
+
+/// ### kraken_unlock
+/// Releases a `kraken_spinlock` taken with kraken_lock.
+/// ```C
+/// void kraken_unlock ( kraken_spinlock* lock );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// lock        | The lock to release
+/// Does not return.
+static inline void kraken_unlock
+(
+    kraken_spinlock*    lock
+)
+{
+#if KRAKEN_ENABLE_LOCKING
+    __atomic_store_n( lock, 0, __ATOMIC_RELEASE );
+#else
+    ( void )lock;
+#endif // KRAKEN_ENABLE_LOCKING
+
+    kraken_preempt_enable();
+} // kraken_unlock
+
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+/// ### kraken_fair_key
+/// Sort key of a thread in the fair scheduler's heap. The main thread only drives the
+/// runtime, so it sorts after every other READY thread.
+/// ```C
+/// uint64_t kraken_fair_key ( struct kraken_runtime* runtime,
+///                            struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | A thread on the run queue of `runtime`
+/// > Returns the virtual runtime of `thread`
+static inline uint64_t kraken_fair_key
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    return thread == runtime->main_thread ? UINT64_MAX : thread->vruntime;
+} // kraken_fair_key
+
+
+/// ### kraken_heap_move
+/// Restores the heap order around one slot of the fair scheduler's heap, moving the thread
+/// in it up or down as needed.
+/// ```C
+/// void kraken_heap_move ( struct kraken_runtime* runtime,
+///                         uint32_t               heap_idx );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// heap_idx    | The slot that may be out of order
+/// Does not return.
+static void kraken_heap_move
+(
+    struct kraken_runtime*  runtime,
+    uint32_t                heap_idx
+)
+{
+    struct kraken_thread** heap   = runtime->heap;
+    struct kraken_thread*  thread = heap[ heap_idx ];
+    uint64_t               key    = kraken_fair_key( runtime, thread );
+    uint32_t               child_idx;
+
+    // sift up
+    while ( 0 < heap_idx && key < kraken_fair_key( runtime, heap[ ( heap_idx - 1 ) / 2 ] ) )
+    {
+        heap[ heap_idx ]              = heap[ ( heap_idx - 1 ) / 2 ];
+        heap[ heap_idx ]->heap_index  = heap_idx;
+        heap_idx                      = ( heap_idx - 1 ) / 2;
+    }
+
+    // sift down
+    while ( ( child_idx = heap_idx * 2 + 1 ) < runtime->queue_count )
+    {
+        if ( child_idx + 1 < runtime->queue_count &&
+             kraken_fair_key( runtime, heap[ child_idx + 1 ] ) <
+             kraken_fair_key( runtime, heap[ child_idx ] ) )
+        {
+            child_idx++;
+        }
+
+        if ( key <= kraken_fair_key( runtime, heap[ child_idx ] ) )
+        {
+            break;
+        }
+
+        heap[ heap_idx ]             = heap[ child_idx ];
+        heap[ heap_idx ]->heap_index = heap_idx;
+        heap_idx                     = child_idx;
+    }
+
+    heap[ heap_idx ]   = thread;
+    thread->heap_index = heap_idx;
+} // kraken_heap_move
+
+
+/// ### kraken_queue_push
+/// Inserts a READY thread into the fair scheduler's heap. Threads coming back from
+/// elsewhere (new, stolen) can't bank more credit than the least served READY thread.
+/// The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_queue_push ( struct kraken_runtime* runtime,
+///                          struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The thread to insert
+/// Does not return.
+static inline void kraken_queue_push
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_thread** heap;
+
+    if ( runtime->queue_count == runtime->heap_capacity )
+    {
+        heap = ( struct kraken_thread** )realloc( runtime->heap,
+            sizeof( struct kraken_thread* ) * ( runtime->heap_capacity * 2 + KRAKEN_THREAD_CHUNK ) );
+
+        assert( NULL != heap && "KRAKEN: Can't allocate memory for run queue." );
+
+        runtime->heap          = heap;
+        runtime->heap_capacity = runtime->heap_capacity * 2 + KRAKEN_THREAD_CHUNK;
+    }
+
+    if ( thread->vruntime < runtime->min_vruntime )
+    {
+        thread->vruntime = runtime->min_vruntime;
+    }
+
+    runtime->heap[ runtime->queue_count ] = thread;
+    runtime->queue_count++;
+
+    kraken_heap_move( runtime, runtime->queue_count - 1 );
+} // kraken_queue_push
+
+
+/// ### kraken_queue_remove
+/// Removes a thread from anywhere in the fair scheduler's heap. The caller holds
+/// `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_remove ( struct kraken_runtime* runtime,
+///                                             struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | A thread on the run queue of `runtime`
+/// > Returns `thread`
+static inline struct kraken_thread* kraken_queue_remove
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    uint32_t heap_idx = thread->heap_index;
+
+    runtime->queue_count--;
+
+    if ( heap_idx != runtime->queue_count )
+    {
+        runtime->heap[ heap_idx ]             = runtime->heap[ runtime->queue_count ];
+        runtime->heap[ heap_idx ]->heap_index = heap_idx;
+
+        kraken_heap_move( runtime, heap_idx );
+    }
+
+    return thread;
+} // kraken_queue_remove
+
+
+/// ### kraken_queue_first
+/// Returns the thread with the least virtual runtime. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_first ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the next thread to run or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_first
+(
+    struct kraken_runtime*  runtime
+)
+{
+    return 0 == runtime->queue_count ? NULL : runtime->heap[ 0 ];
+} // kraken_queue_first
+
+
+/// ### kraken_queue_last
+/// Returns the last leaf of the heap, a cheap thread to give away when stealing. The
+/// caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_last ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns a READY thread or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_last
+(
+    struct kraken_runtime*  runtime
+)
+{
+    return 0 == runtime->queue_count ? NULL : runtime->heap[ runtime->queue_count - 1 ];
+} // kraken_queue_last
+#elif KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+/// ### kraken_queue_push
+/// Appends a READY thread to the run queue of its priority level and marks the level as
+/// occupied. The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_queue_push ( struct kraken_runtime* runtime,
+///                          struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The thread to append
+/// Does not return.
+static inline void kraken_queue_push
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    uint8_t level = thread->priority;
+
+    thread->next = NULL;
+    thread->prev = runtime->level_tails[ level ];
+
+    if ( NULL == runtime->level_tails[ level ] )
+    {
+        runtime->level_heads[ level ] = thread;
+        runtime->level_bitmap        |= ( uint64_t )1 << level;
+    }
+    else
+    {
+        runtime->level_tails[ level ]->next = thread;
+    }
+
+    runtime->level_tails[ level ] = thread;
+    runtime->queue_count++;
+} // kraken_queue_push
+
+
+/// ### kraken_queue_remove
+/// Unlinks a thread from the run queue of its priority level. The caller holds
+/// `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_remove ( struct kraken_runtime* runtime,
+///                                             struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | A thread on the run queue of `runtime`
+/// > Returns `thread`
+static inline struct kraken_thread* kraken_queue_remove
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    uint8_t level = thread->priority;
+
+    if ( NULL == thread->prev )
+    {
+        runtime->level_heads[ level ] = thread->next;
+    }
+    else
+    {
+        thread->prev->next = thread->next;
+    }
+
+    if ( NULL == thread->next )
+    {
+        runtime->level_tails[ level ] = thread->prev;
+    }
+    else
+    {
+        thread->next->prev = thread->prev;
+    }
+
+    if ( NULL == runtime->level_heads[ level ] )
+    {
+        runtime->level_bitmap &= ~( ( uint64_t )1 << level );
+    }
+
+    thread->next = NULL;
+    thread->prev = NULL;
+    runtime->queue_count--;
+
+    return thread;
+} // kraken_queue_remove
+
+
+/// ### kraken_queue_first
+/// Returns the oldest thread of the highest occupied priority level. The caller holds
+/// `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_first ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the next thread to run or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_first
+(
+    struct kraken_runtime*  runtime
+)
+{
+    if ( 0 == runtime->level_bitmap )
+    {
+        return NULL;
+    }
+
+    return runtime->level_heads[ 63 - __builtin_clzll( runtime->level_bitmap ) ];
+} // kraken_queue_first
+
+
+/// ### kraken_queue_last
+/// Returns the newest thread of the lowest occupied priority level, the one that would
+/// wait longest on this runtime. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_last ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns a READY thread or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_last
+(
+    struct kraken_runtime*  runtime
+)
+{
+    if ( 0 == runtime->level_bitmap )
+    {
+        return NULL;
+    }
+
+    return runtime->level_tails[ __builtin_ctzll( runtime->level_bitmap ) ];
+} // kraken_queue_last
+#else
+/// ### kraken_queue_push
+/// Appends a READY thread to the run queue of a runtime. The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_queue_push ( struct kraken_runtime* runtime,
+///                          struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The thread to append
+/// Does not return.
+static inline void kraken_queue_push
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    thread->next = NULL;
+    thread->prev = runtime->queue_tail;
+
+    if ( NULL == runtime->queue_tail )
+    {
+        runtime->queue_head = thread;
+    }
+    else
+    {
+        runtime->queue_tail->next = thread;
+    }
+
+    runtime->queue_tail = thread;
+    runtime->queue_count++;
+} // kraken_queue_push
+
+
+/// ### kraken_queue_remove
+/// Unlinks a thread from anywhere in the run queue of a runtime. The caller holds
+/// `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_remove ( struct kraken_runtime* runtime,
+///                                             struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | A thread on the run queue of `runtime`
+/// > Returns `thread`
+static inline struct kraken_thread* kraken_queue_remove
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    if ( NULL == thread->prev )
+    {
+        runtime->queue_head = thread->next;
+    }
+    else
+    {
+        thread->prev->next = thread->next;
+    }
+
+    if ( NULL == thread->next )
+    {
+        runtime->queue_tail = thread->prev;
+    }
+    else
+    {
+        thread->next->prev = thread->prev;
+    }
+
+    thread->next = NULL;
+    thread->prev = NULL;
+    runtime->queue_count--;
+
+    return thread;
+} // kraken_queue_remove
+
+/// ### kraken_queue_first
+/// Returns the thread at the head of the run queue. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_first ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the next thread to run or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_first
+(
+    struct kraken_runtime*  runtime
+)
+{
+    return runtime->queue_head;
+} // kraken_queue_first
+
+
+/// ### kraken_queue_last
+/// Returns the thread at the tail of the run queue. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_last ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the thread queued last or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_last
+(
+    struct kraken_runtime*  runtime
+)
+{
+    return runtime->queue_tail;
+} // kraken_queue_last
+#endif // KRAKEN_SCHEDULER
+
+
+/// ### kraken_queue_pop
+/// Removes the thread at the head of the run queue. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_queue_pop ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the next READY thread or NULL if the queue is empty
+static inline struct kraken_thread* kraken_queue_pop
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread* thread = kraken_queue_first( runtime );
+
+    if ( NULL == thread )
+    {
+        return NULL;
+    }
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+    if ( thread != runtime->main_thread && runtime->min_vruntime < thread->vruntime )
+    {
+        runtime->min_vruntime = thread->vruntime;
+    }
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+
+    return kraken_queue_remove( runtime, thread );
+} // kraken_queue_pop
+
+
+/// ### kraken_stack_stride
+/// Returns the distance between two stacks mapped by the same kraken_stack_map call, a
+/// guard page plus the stack rounded up to whole pages.
+/// ```C
+/// size_t kraken_stack_stride ( size_t size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// size        | Usable size of the stack in bytes
+/// > Returns the number of bytes mapped per stack
+static size_t kraken_stack_stride
+(
+    size_t                  size
+)
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+    size_t page_size = ( size_t )sysconf( _SC_PAGESIZE );
+
+    return page_size + ( ( size + page_size - 1 ) & ~( page_size - 1 ) );
+#else
+    return size;
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+} // kraken_stack_stride
+
+
+/// ### kraken_stack_map
+/// Maps fresh thread stacks with a PROT_NONE guard page below each of them, so overflowing
+/// a stack faults instead of running into other memory. Pages are committed on first touch.
+/// All stacks come from one mapping, `kraken_stack_stride( size )` bytes apart, and can
+/// still be unmapped one by one. Falls back to malloc without a guard page where mmap is
+/// not available, where only one stack can be mapped at a time.
+/// ```C
+/// char* kraken_stack_map ( size_t   size,
+///                          uint32_t count );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// size        | Usable size of each stack in bytes
+/// count       | Number of stacks
+/// > Returns the lowest usable byte of the first stack or NULL if memory runs out
+static char* kraken_stack_map
+(
+    size_t                  size,
+    uint32_t                count
+)
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+    size_t   page_size = ( size_t )sysconf( _SC_PAGESIZE );
+    size_t   map_size  = kraken_stack_stride( size );
+    uint32_t stack_idx;
+    char*    region    = ( char* )mmap( NULL, map_size * count, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+    if ( MAP_FAILED == region )
+    {
+        return NULL;
+    }
+
+    for ( stack_idx = 0; stack_idx < count; stack_idx++ )
+    {
+        if ( 0 != mprotect( region + map_size * stack_idx, page_size, PROT_NONE ) )
+        {
+            munmap( region, map_size * count );
+
+            return NULL;
+        }
+    }
+
+    // the usable part ends with the stride, the guard page sits right below it
+    return region + map_size - size;
+#else
+    assert( 1 == count );
+
+    return ( char* )malloc( size );
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+} // kraken_stack_map
+
+
+/// ### kraken_stack_unmap
+/// Gives a stack from kraken_stack_map back to the operating system.
+/// ```C
+/// void kraken_stack_unmap ( char*  stack,
+///                           size_t size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// stack       | The lowest usable byte of the stack
+/// size        | The size the stack was mapped with
+/// Does not return.
+static void kraken_stack_unmap
+(
+    char*                   stack,
+    size_t                  size
+)
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+    size_t map_size = kraken_stack_stride( size );
+
+    munmap( stack + size - map_size, map_size );
+#else
+    free( stack );
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+} // kraken_stack_unmap
+
+
+/// ### kraken_stack_bin
+/// Finds the list of the stack cache of a runtime that holds stacks of a size, or an empty
+/// list if none does. The caller holds `runtime->lock`.
+/// ```C
+/// uint32_t kraken_stack_bin ( struct kraken_runtime* runtime,
+///                             uint32_t               size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// size        | Size of the stack in bytes
+/// > Returns the index of the list or `KRAKEN_STACK_SIZES` if all hold other sizes
+static uint32_t kraken_stack_bin
+(
+    struct kraken_runtime*  runtime,
+    uint32_t                size
+)
+{
+    uint32_t bin;
+    uint32_t empty = KRAKEN_STACK_SIZES;
+
+    for ( bin = 0; bin < KRAKEN_STACK_SIZES; bin++ )
+    {
+        if ( NULL == runtime->free_stacks[ bin ] )
+        {
+            empty = KRAKEN_STACK_SIZES == empty ? bin : empty;
+        }
+        else if ( size == runtime->free_stack_sizes[ bin ] )
+        {
+            return bin;
+        }
+    }
+
+    return empty;
+} // kraken_stack_bin
+
+
+/// ### kraken_stack_pop
+/// Takes a stack of a size off the stack cache of a runtime.
+/// ```C
+/// char* kraken_stack_pop ( struct kraken_runtime* runtime,
+///                          uint32_t               size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// size        | Size of the stack in bytes
+/// > Returns a cached stack or NULL if the cache has none of that size
+static char* kraken_stack_pop
+(
+    struct kraken_runtime*  runtime,
+    uint32_t                size
+)
+{
+    char*    stack = NULL;
+    uint32_t bin;
+
+    kraken_lock( &runtime->lock );
+
+    bin = kraken_stack_bin( runtime, size );
+
+    if ( KRAKEN_STACK_SIZES > bin && NULL != runtime->free_stacks[ bin ] )
+    {
+        // the link lives in the top word, which every thread has touched already
+        stack                       = runtime->free_stacks[ bin ];
+        runtime->free_stacks[ bin ] = *( char** )&( stack[ size - sizeof( char* ) ] );
+        runtime->free_stack_count--;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    return stack;
+} // kraken_stack_pop
+
+
+/// ### kraken_stack_allocate
+/// Hands out a stack for a new thread, reusing one from the stack cache when possible.
+/// ```C
+/// char* kraken_stack_allocate ( struct kraken_runtime* runtime,
+///                               uint32_t               size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// size        | Size of the stack in bytes
+/// > Returns the lowest usable byte of the stack or NULL if memory runs out
+static char* kraken_stack_allocate
+(
+    struct kraken_runtime*  runtime,
+    uint32_t                size
+)
+{
+    char* stack = kraken_stack_pop( runtime, size );
+
+    return NULL != stack ? stack : kraken_stack_map( size, 1 );
+} // kraken_stack_allocate
+
+
+/// ### kraken_stack_release
+/// Puts the stack of a STOPPED thread into the stack cache of a runtime, or unmaps it
+/// once the cache holds `KRAKEN_STACK_CACHE` stacks or `KRAKEN_STACK_SIZES` other sizes.
+/// ```C
+/// void kraken_stack_release ( struct kraken_runtime* runtime,
+///                             char*                  stack,
+///                             uint32_t               size );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// stack       | A stack no thread runs on anymore
+/// size        | Size of the stack in bytes
+/// Does not return.
+static void kraken_stack_release
+(
+    struct kraken_runtime*  runtime,
+    char*                   stack,
+    uint32_t                size
+)
+{
+    uint32_t bin;
+
+    kraken_lock( &runtime->lock );
+
+    bin = kraken_stack_bin( runtime, size );
+
+    if ( KRAKEN_STACK_SIZES > bin && KRAKEN_STACK_CACHE > runtime->free_stack_count )
+    {
+        *( char** )&( stack[ size - sizeof( char* ) ] ) = runtime->free_stacks[ bin ];
+        runtime->free_stacks[ bin ]      = stack;
+        runtime->free_stack_sizes[ bin ] = size;
+        runtime->free_stack_count++;
+        stack                            = NULL;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    if ( NULL != stack )
+    {
+        kraken_stack_unmap( stack, size );
+    }
+} // kraken_stack_release
+
+
+/// ### kraken_stack_usage
+/// Measures the most stack a thread has used so far. Private stacks are scanned for the
+/// deepest word that lost `KRAKEN_STACK_PATTERN`. For shared stack threads it is the
+/// largest live stack seen at a switch. The last measurement is kept once the thread
+/// stops, until its slot is reused.
+/// ```C
+/// uint32_t kraken_stack_usage ( struct kraken_thread* thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | A pointer to `struct kraken_thread`
+/// > Returns the peak usage in bytes, always 0 without `KRAKEN_ENABLE_STACK_WATERMARK`
+uint32_t kraken_stack_usage
+(
+    struct kraken_thread*   thread
+)
+{
+#if KRAKEN_ENABLE_STACK_WATERMARK
+    uint64_t* words = ( uint64_t* )thread->stack;
+    uint32_t  word_idx;
+
+    if ( NULL != words )
+    {
+        for ( word_idx = 0; word_idx < thread->stack_size / 8; word_idx++ )
+        {
+            // reclaimed pages read back as zeros, the peak before that is in stack_peak
+            if ( KRAKEN_STACK_PATTERN != words[ word_idx ] &&
+                 ( 0 != words[ word_idx ] || ( char* )&words[ word_idx ] >= thread->reclaim_end ) )
+            {
+                break;
+            }
+        }
+
+        if ( thread->stack_peak < thread->stack_size - word_idx * 8 )
+        {
+            thread->stack_peak = thread->stack_size - word_idx * 8;
+        }
+    }
+
+    return thread->stack_peak;
+#else
+    ( void )thread;
+
+    return 0;
+#endif // KRAKEN_ENABLE_STACK_WATERMARK
+} // kraken_stack_usage
+
+
+/// ### kraken_parked_remove
+/// Unlinks a thread from the parked list of a runtime. The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_parked_remove ( struct kraken_runtime* runtime,
+///                             struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | A thread on the parked list of `runtime`
+/// Does not return.
+static void kraken_parked_remove
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    if ( NULL == thread->prev )
+    {
+        runtime->parked_head = thread->next;
+    }
+    else
+    {
+        thread->prev->next = thread->next;
+    }
+
+    if ( NULL == thread->next )
+    {
+        runtime->parked_tail = thread->prev;
+    }
+    else
+    {
+        thread->next->prev = thread->prev;
+    }
+
+    thread->next = NULL;
+    thread->prev = NULL;
+} // kraken_parked_remove
+
+
+/// ### kraken_reclaim_stacks
+/// Returns the pages below the saved stack pointer of every thread parked for longer than
+/// `runtime->reclaim_after` to the os. They read back as zeros when the thread needs them
+/// again. Each parked thread is reclaimed once.
+/// ```C
+/// void kraken_reclaim_stacks ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_reclaim_stacks
+(
+    struct kraken_runtime*  runtime
+)
+{
+#if ( defined( __unix__ ) || defined( __APPLE__ ) ) && KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    struct kraken_thread*    thread;
+    struct kraken_generator* generator;
+    uintptr_t                page_mask = ( uintptr_t )sysconf( _SC_PAGESIZE ) - 1;
+    uint64_t                 now;
+    uint64_t                 rsp;
+    char*                    start;
+    char*                    end;
+
+    if ( NULL == __atomic_load_n( &runtime->parked_head, __ATOMIC_RELAXED ) )
+    {
+        return;
+    }
+
+    now = kraken_now();
+
+    // the list is in parking order, stop at the first thread that hasn't waited long enough
+    kraken_lock( &runtime->lock );
+
+    while ( NULL != ( thread = runtime->parked_head ) &&
+            runtime->reclaim_after <= now - thread->blocked_since )
+    {
+        kraken_parked_remove( runtime, thread );
+
+#if KRAKEN_ENABLE_STACK_WATERMARK
+        kraken_stack_usage( thread );
+#endif // KRAKEN_ENABLE_STACK_WATERMARK
+
+        rsp = thread->context.rsp;
+
+        // a thread parked inside a generator left its own stack where it entered the first one
+        for ( generator = thread->generator; NULL != generator; generator = generator->outer )
+        {
+            rsp = generator->caller.rsp;
+        }
+
+        start = ( char* )( ( ( uintptr_t )thread->stack + page_mask ) & ~page_mask );
+        end   = ( char* )( ( uintptr_t )rsp & ~page_mask );
+
+        // off the parked list from here on, even if there was nothing to give back
+        thread->reclaim_end = end;
+
+        if ( start < end && 0 == madvise( start, end - start, MADV_DONTNEED ) )
+        {
+            runtime->reclaimed_bytes += end - start;
+        }
+    }
+
+    kraken_unlock( &runtime->lock );
+#endif // ( defined( __unix__ ) || defined( __APPLE__ ) ) && KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+} // kraken_reclaim_stacks
+
+
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+/// ### kraken_shared_stack_swap
+/// Copies the live part of the shared stack out to its occupant's save buffer and the
+/// saved bytes of `thread` back in. Must not run on the shared stack itself.
+/// ```C
+/// void kraken_shared_stack_swap ( struct kraken_runtime* runtime,
+///                                 struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The shared stack thread about to run
+/// Does not return.
+static void kraken_shared_stack_swap
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_thread* occupant = runtime->stack_occupant;
+    char*                 top      = runtime->shared_stack + KRAKEN_SHARED_STACK_SIZE;
+    uint32_t              size;
+
+    if ( occupant == thread )
+    {
+        return;
+    }
+
+    if ( NULL != occupant )
+    {
+        size = ( uint32_t )( top - ( char* )occupant->context.rsp );
+
+        // keep the buffer right sized, parked threads often need far less than before
+        if ( occupant->saved_capacity < size || occupant->saved_capacity / 4 > size )
+        {
+            free( occupant->saved_stack );
+            occupant->saved_stack    = ( char* )malloc( size );
+            occupant->saved_capacity = size;
+
+            assert( NULL != occupant->saved_stack && "KRAKEN: Can't save shared stack." );
+        }
+
+        memcpy( occupant->saved_stack, ( char* )occupant->context.rsp, size );
+        occupant->saved_size = size;
+
+#if KRAKEN_ENABLE_STACK_WATERMARK
+        if ( occupant->stack_peak < size )
+        {
+            occupant->stack_peak = size;
+        }
+#endif // KRAKEN_ENABLE_STACK_WATERMARK
+    }
+
+    memcpy( top - thread->saved_size, thread->saved_stack, thread->saved_size );
+    runtime->stack_occupant = thread;
+} // kraken_shared_stack_swap
+
+
+/// ### kraken_copy_loop
+/// Body of `runtime->copy_context`. Switching between two shared stack threads goes through
+/// here, because the incoming frames can't be copied in while running on top of them.
+/// ```C
+/// void kraken_copy_loop ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_copy_loop
+(
+    struct kraken_runtime*  runtime
+)
+{
+    while ( true )
+    {
+        kraken_shared_stack_swap( runtime, runtime->copy_target );
+        kraken_switch( &runtime->copy_context, &runtime->copy_target->context, runtime );
+    }
+} // kraken_copy_loop
+
+
+/// ### kraken_shared_stack_prepare
+/// Maps the shared stack of a runtime on first use and gives a new thread the saved image
+/// of a fresh frame that returns into kraken_guard.
+/// ```C
+/// bool kraken_shared_stack_prepare ( struct kraken_runtime* runtime,
+///                                    struct kraken_thread*  thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The thread being started
+/// > Returns false if memory runs out
+static bool kraken_shared_stack_prepare
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    char* shared_stack = NULL;
+    char* copy_stack   = NULL;
+
+    kraken_lock( &runtime->lock );
+
+    if ( NULL == runtime->shared_stack )
+    {
+        shared_stack = kraken_stack_map( KRAKEN_SHARED_STACK_SIZE, 1 );
+        copy_stack   = kraken_stack_map( KRAKEN_STACK_SIZE, 1 );
+
+        if ( NULL == shared_stack || NULL == copy_stack )
+        {
+            kraken_unlock( &runtime->lock );
+
+            if ( NULL != shared_stack ) kraken_stack_unmap( shared_stack, KRAKEN_SHARED_STACK_SIZE );
+            if ( NULL != copy_stack   ) kraken_stack_unmap( copy_stack, KRAKEN_STACK_SIZE );
+
+            return false;
+        }
+
+        *( uint64_t* )&( copy_stack[ KRAKEN_STACK_SIZE -  8 ] ) = ( uint64_t )0;
+        *( uint64_t* )&( copy_stack[ KRAKEN_STACK_SIZE - 16 ] ) = ( uint64_t )kraken_copy_loop;
+
+        runtime->copy_context.rsp = ( uint64_t )&( copy_stack[ KRAKEN_STACK_SIZE - 16 ] );
+        runtime->copy_context.rbp = 0;
+        runtime->copy_stack       = copy_stack;
+        runtime->shared_stack     = shared_stack;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    kraken_preempt_disable();
+    thread->saved_stack = ( char* )malloc( 16 );
+    kraken_preempt_enable();
+
+    if ( NULL == thread->saved_stack )
+    {
+        return false;
+    }
+
+    // the same frame a private stack starts with, copied in when the thread first runs
+    *( uint64_t* )&( thread->saved_stack[ 0 ] ) = ( uint64_t )kraken_guard;
+    *( uint64_t* )&( thread->saved_stack[ 8 ] ) = ( uint64_t )0;
+
+    thread->saved_size     = 16;
+    thread->saved_capacity = 16;
+    thread->context.rsp    = ( uint64_t )&( runtime->shared_stack[ KRAKEN_SHARED_STACK_SIZE - 16 ] );
+    thread->context.rbp    = 0;
+
+    return true;
+} // kraken_shared_stack_prepare
+#endif // KRAKEN_ARCH == KRAKEN_ARCH_X86_64
 
 
 /// ### kraken_run
-/// Prints the contents of a kraken_runtime (see struct kraken_runtme)
+/// Runs threads until all of them have stopped, frees their stacks and exits the process.
+/// ```C
+/// void kraken_run ( struct kraken_runtime* runtime,
+///                   int                    return_code );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`.
+/// return_code | Program exit code you want to return with
+/// Does not return.
+void __attribute__( ( noreturn ) ) kraken_run
+(
+    struct kraken_runtime*  runtime,
+    int                     return_code
+)
+{
+    char*               stack;
+    struct kraken_task* task;
+    uint32_t            bin;
+    uint32_t            size;
+
+    runtime = kraken_local( runtime );
+
+    if ( runtime->current_thread != runtime->main_thread )
+    {
+        kraken_reschedule( runtime, STOPPED );
+    }
+
+    kraken_wait( runtime );
+
+    while ( NULL != ( task = runtime->free_tasks ) )
+    {
+        runtime->free_tasks = task->next;
+        free( task );
+    }
+
+    // Free thread stack memory when done. Stopped threads left their stacks in the cache.
+    for ( bin = 0; bin < KRAKEN_STACK_SIZES; bin++ )
+    {
+        size = runtime->free_stack_sizes[ bin ];
+
+        while ( NULL != ( stack = kraken_stack_pop( runtime, size ) ) )
+        {
+            kraken_stack_unmap( stack, size );
+        }
+    }
+
+    exit( return_code );
+} // kraken_run
+
+
+/// ### kraken_wait
+/// Runs threads until all of them have stopped and returns to the caller. While every
+/// thread is BLOCKED the os thread sleeps until the next timer expires or another os
+/// thread unparks one or submits a new one.
+/// ```C
+/// void kraken_wait ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`.
+/// Does not return.
+void kraken_wait
+(
+    struct kraken_runtime*  runtime
+)
+{
+    runtime = kraken_local( runtime );
+
+    while ( true )
+    {
+        if ( kraken_yield( runtime ) )
+        {
+            continue;
+        }
+
+        // only the main thread's slot and threads waiting to be joined are left, no task
+        // waits and no other os thread submitted threads
+        if ( 1 >= __atomic_load_n( &runtime->used_threads, __ATOMIC_ACQUIRE ) -
+                  __atomic_load_n( &runtime->zombie_threads, __ATOMIC_ACQUIRE ) &&
+             0 == __atomic_load_n( &runtime->task_count, __ATOMIC_ACQUIRE ) &&
+             NULL == __atomic_load_n( &runtime->inbox, __ATOMIC_ACQUIRE ) )
+        {
+            break;
+        }
+
+        kraken_idle( runtime, UINT64_MAX );
+    }
+} // kraken_wait
+
+
+/// ### kraken_allocate_thread
+/// Takes a slot off the free list of a runtime, growing the thread table by one chunk when
+/// the free list is empty. Live slots never move. The caller holds `runtime->lock`.
+/// ```C
+/// struct kraken_thread* kraken_allocate_thread ( struct kraken_runtime* runtime );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns a STOPPED slot or NULL if `KRAKEN_MAX_THREADS` is reached or memory runs out
+static struct kraken_thread* kraken_allocate_thread
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread*  thread;
+    struct kraken_thread*  chunk;
+    struct kraken_thread** chunks;
+    uint32_t               thread_idx;
+
+#if KRAKEN_MAX_THREADS
+    if ( KRAKEN_MAX_THREADS <= runtime->used_threads )
+    {
+        return NULL;
+    }
+#endif // KRAKEN_MAX_THREADS
+
+    if ( NULL == runtime->free_threads )
+    {
+        if ( runtime->chunk_count == runtime->chunk_capacity )
+        {
+            chunks = ( struct kraken_thread** )realloc( runtime->thread_chunks,
+                sizeof( struct kraken_thread* ) * ( runtime->chunk_capacity * 2 + 1 ) );
+
+            if ( NULL == chunks )
+            {
+                return NULL;
+            }
+
+            runtime->thread_chunks  = chunks;
+            runtime->chunk_capacity = runtime->chunk_capacity * 2 + 1;
+        }
+
+        chunk = ( struct kraken_thread* )calloc( KRAKEN_THREAD_CHUNK,
+                                                 sizeof( struct kraken_thread ) );
+
+        if ( NULL == chunk )
+        {
+            return NULL;
+        }
+
+        // link the new slots in id order, the lowest id is handed out first
+        for ( thread_idx = KRAKEN_THREAD_CHUNK; 0 < thread_idx--; )
+        {
+            chunk[ thread_idx ].id        = runtime->chunk_count * KRAKEN_THREAD_CHUNK +
+                                            thread_idx;
+            chunk[ thread_idx ].owner     = runtime;
+            chunk[ thread_idx ].next      = runtime->free_threads;
+            runtime->free_threads         = &chunk[ thread_idx ];
+        }
+
+        runtime->thread_chunks[ runtime->chunk_count++ ] = chunk;
+    }
+
+    thread                = runtime->free_threads;
+    runtime->free_threads = thread->next;
+    thread->next          = NULL;
+    runtime->used_threads++;
+
+    return thread;
+} // kraken_allocate_thread
+
+
+/// ### kraken_release_thread
+/// Puts a STOPPED thread back on the free list of the runtime that owns it.
+/// ```C
+/// void kraken_release_thread ( struct kraken_thread* thread );
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The slot to release
+/// Does not return.
+static void kraken_release_thread
+(
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_runtime* owner = thread->owner;
+
+    kraken_lock( &owner->lock );
+
+    if ( thread->finished )
+    {
+        owner->zombie_threads--;
+    }
+
+    thread->status      = STOPPED;
+    thread->routine     = NULL;
+    thread->joinable    = false;
+    thread->finished    = false;
+    thread->next        = owner->free_threads;
+    owner->free_threads = thread;
+    owner->used_threads--;
+
+    kraken_unlock( &owner->lock );
+} // kraken_release_thread
+
+
+/// ### kraken_initialize_runtime
+/// Creates a runtime. The calling os thread becomes its main thread.
+/// ```C
+/// void kraken_initialize_runtime ( void )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// void /**/   | No parameters!!!
+/// > Returns a pointer to `struct kraken_runtime`
+struct kraken_runtime* kraken_initialize_runtime
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = ( struct kraken_runtime* )
+        calloc( 1, sizeof( struct kraken_runtime ) );
+
+    assert( NULL != runtime && "KRAKEN: Can't allocate memory for runtime." );
+
+    // the main thread runs on the stack of the calling os thread
+    runtime->main_thread = kraken_allocate_thread( runtime );
+
+    assert( NULL != runtime->main_thread && "KRAKEN: Can't allocate memory for threads." );
+
+    runtime->current_thread          = runtime->main_thread;
+    runtime->current_thread->status  = RUNNING;
+    runtime->current_thread->runtime = runtime;
+    runtime->switch_time             = kraken_now();
+    runtime->run_start               = runtime->switch_time;
+    runtime->trace_ticks             = kraken_ticks();
+    runtime->trace_time              = kraken_now();
+    runtime->timer_tick              = runtime->trace_time / KRAKEN_TIMER_TICK;
+#if KRAKEN_ENABLE_WATCHDOG
+    runtime->os_thread               = pthread_self();
+#endif // KRAKEN_ENABLE_WATCHDOG
+#if KRAKEN_ENABLE_REACTOR
+    runtime->reactor_fd              = -1;
+    runtime->wake_fd                 = -1;
+#endif // KRAKEN_ENABLE_REACTOR
+
+#if KRAKEN_ENABLE_TRACE
+    runtime->trace = ( struct kraken_trace_record* )
+        calloc( KRAKEN_TRACE_SIZE, sizeof( struct kraken_trace_record ) );
+
+    assert( NULL != runtime->trace && "KRAKEN: Can't allocate memory for trace records." );
+#endif // KRAKEN_ENABLE_TRACE
+    runtime->reclaim_after           = KRAKEN_RECLAIM_AFTER;
+
+    return runtime;
+} // kraken_initialize_runtime
+
+
+/// ### kraken_switch
+/// Switches between old and new processor contexts when a new thread is ready for
+/// execution.
+/// ```C
+/// void kraken_switch ( struct kraken_context* old_context,
+///                      struct kraken_context* new_context,
+///                      struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// old_context | Old context
+/// new_context | New context
+/// runtime     | Pointer to a runtime. Handed to kraken_guard when a thread starts.
+/// Does not return.
+__asm__
+(
+    ".globl _kraken_switch, kraken_switch\n\t"
+    "_kraken_switch:                     \n\t"
+    "kraken_switch:                      \n\t"
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+#ifdef KRAKEN_DEBUG
+#if KRAKEN_ENABLE_BREAK_BEFORE_SWITCH == 0x1
+   // interrupt gdb if build type is debug.
+   "int    $3                           \n\t"
+#endif // KRAKEN_ENABLE_BREAK_BEFORE_SWITCH == 0x1
+#endif // KRAKEN_DEBUG
+#warning "COMPILING FOR X86_64"
+    "movq   %rsp,       0x00(%rdi)       \n\t"
+    "movq   %r15,       0x08(%rdi)       \n\t"
+    "movq   %r14,       0x10(%rdi)       \n\t"
+    "movq   %r13,       0x18(%rdi)       \n\t"
+    "movq   %r12,       0x20(%rdi)       \n\t"
+    "movq   %rbx,       0x28(%rdi)       \n\t"
+    "movq   %rbp,       0x30(%rdi)       \n\t"
+    "movq   0x00(%rsi), %rsp             \n\t"
+    "movq   0x08(%rsi), %r15             \n\t"
+    "movq   0x10(%rsi), %r14             \n\t"
+    "movq   0x18(%rsi), %r13             \n\t"
+    "movq   0x20(%rsi), %r12             \n\t"
+    "movq   0x28(%rsi), %rbx             \n\t"
+    "movq   0x30(%rsi), %rbp             \n\t"
+    "movq   %rdx,       %rax             \n\t"
+    // first argument of kraken_guard when a new thread starts
+    "movq   %rdx,       %rdi             \n\t"
+    // jump to thread's function
+    "ret                                 \n\t"
+#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
+#warning "COMPILING FOR X86"
+    "movl   %esp,       0x00(%edi)       \n\t"
+    "movl   %ebx,       0x28(%edi)       \n\t"
+    "movl   %ebp,       0x30(%edi)       \n\t"
+    "movl   0x00(%esi), %esp             \n\t"
+    "movl   0x28(%esi), %ebx             \n\t"
+    "movl   0x30(%esi), %ebp             \n\t"
+#elif KRAKEN_ARCH == KRAKEN_ARCH_AVR
+#warning "COMPILING FOR AVR"
+    "mov    r15,         r12             \n\t"
+#endif
+);
+
+
+/// ### kraken_guard
+/// First code executed by a new thread. Runs the thread's function and stops the thread
+/// once the function returns.
+/// ```C
+/// void kraken_guard ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_guard
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread* thread;
+
+    assert( NULL != runtime );
+
+    kraken_finish_switch( runtime );
+
+    // undoes the kraken_preempt_disable of the kraken_reschedule that switched here
+    kraken_preempt_enable();
+
+    thread = runtime->current_thread;
+
+    if ( NULL != thread->routine )
+    {
+        thread->result = thread->routine( runtime, thread->argument );
+    }
+    else
+    {
+        thread->function( runtime );
+    }
+
+    // the thread may have been stolen by another runtime while it ran
+    runtime = kraken_local( runtime );
+
+    kraken_trace( runtime, KRAKEN_TRACE_EXIT, runtime->current_thread, NULL );
+    kraken_reschedule( runtime, STOPPED );
+
+    assert( false && "KRAKEN: Stopped thread was resumed." );
+} // kraken_guard
+
+
+/// ### kraken_account_switch
+/// Charges the run that ends to the thread switched away from and the wait that ends to
+/// the thread switched to. Called before every switch with `KRAKEN_ENABLE_STATS`.
+/// ```C
+/// void kraken_account_switch ( struct kraken_runtime* runtime,
+///                              struct kraken_thread*  current_thread,
+///                              struct kraken_thread*  next_thread )
+/// ```
+/// Parameter      | Description
+/// ---------------|-------------------------------------------------------------------------
+/// runtime        | A pointer to `struct kraken_runtime`
+/// current_thread | The thread giving up the processor
+/// next_thread    | The thread getting the processor
+/// Does not return.
+static inline void kraken_account_switch
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   current_thread,
+    struct kraken_thread*   next_thread
+)
+{
+    uint64_t now = kraken_now();
+    uint64_t run = now - runtime->run_start;
+
+    current_thread->stats.run_time += run;
+
+    if ( run > current_thread->stats.longest_run )
+    {
+        current_thread->stats.longest_run = run;
+    }
+
+    // the main thread falls back in whenever the queue runs dry, it never waits on it
+    if ( next_thread != runtime->main_thread && now > next_thread->ready_since )
+    {
+        next_thread->stats.ready_time += now - next_thread->ready_since;
+    }
+
+    next_thread->stats.switches++;
+
+    runtime->stats.switches++;
+    runtime->stats.queue_samples++;
+    runtime->stats.queue_total += runtime->queue_count;
+
+    if ( runtime->queue_count > runtime->stats.queue_max )
+    {
+        runtime->stats.queue_max = runtime->queue_count;
+    }
+
+    runtime->run_start = now;
+} // kraken_account_switch
+
+
+/// ### kraken_read_thread_stats
+/// Copies the counters of a thread. The counters of a thread running on another os thread
+/// of a pool may be one switch behind.
+/// ```C
+/// void kraken_read_thread_stats ( struct kraken_thread*       thread,
+///                                 struct kraken_thread_stats* stats )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The thread to read
+/// stats       | Receives the counters, all 0 without `KRAKEN_ENABLE_STATS`
+/// Does not return.
+void kraken_read_thread_stats
+(
+    struct kraken_thread*       thread,
+    struct kraken_thread_stats* stats
+)
+{
+    assert( NULL != thread && NULL != stats && "KRAKEN: Can't read stats of no thread." );
+
+    *stats = thread->stats;
+} // kraken_read_thread_stats
+
+
+/// ### kraken_read_runtime_stats
+/// Copies the counters of a runtime. Like kraken_read_thread_stats it does not stop the
+/// os thread driving the runtime, so the copy may be one switch behind.
+/// ```C
+/// void kraken_read_runtime_stats ( struct kraken_runtime*       runtime,
+///                                  struct kraken_runtime_stats* stats )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime to read
+/// stats       | Receives the counters, all 0 without `KRAKEN_ENABLE_STATS`
+/// Does not return.
+void kraken_read_runtime_stats
+(
+    struct kraken_runtime*       runtime,
+    struct kraken_runtime_stats* stats
+)
+{
+    assert( NULL != runtime && NULL != stats && "KRAKEN: Can't read stats of no runtime." );
+
+    *stats = runtime->stats;
+} // kraken_read_runtime_stats
+
+
+/// ### kraken_reschedule
+/// Takes the current thread off the processor and switches to the next READY thread.
+/// When the run queue is empty a READY caller keeps running and any other caller hands
+/// the processor back to the runtime's main thread. The fair scheduler also keeps a READY
+/// caller running while no other thread has used less processor time, the priority
+/// scheduler while no other thread has the same or a higher priority.
+/// ```C
+/// bool kraken_reschedule ( struct kraken_runtime* runtime,
+///                          enum kraken_status     status )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// status      | The status of the current thread once it is off the processor
+/// > Returns false if no switch took place
+static bool kraken_reschedule
+(
+    struct kraken_runtime*  runtime,
+    enum kraken_status      status
+)
+{
+    struct kraken_thread* current_thread = runtime->current_thread;
+    struct kraken_thread* next_thread    = NULL;
+    bool                  main_turn;
+
+    assert( !runtime->task_running && "KRAKEN: Tasks can't block, start a thread instead." );
+
+    // the run queue and the thread being switched away from are in flux from here on
+    kraken_preempt_disable();
+
+#if KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+    // the current thread gives the runtime a chance to run others, that resets the budget
+    __atomic_store_n( &runtime->schedule_count, runtime->schedule_count + 1, __ATOMIC_RELEASE );
+#endif // KRAKEN_ENABLE_WATCHDOG || KRAKEN_ENABLE_PREEMPTION
+
+    // the main thread gets the processor regularly, a good time to look at parked threads
+    if ( current_thread == runtime->main_thread )
+    {
+        kraken_reclaim_stacks( runtime );
+
+        // not from the preemption handler, starting threads allocates
+        if ( NULL != __atomic_load_n( &runtime->inbox, __ATOMIC_RELAXED ) )
+        {
+            kraken_inbox_drain( runtime );
+        }
+
+#if KRAKEN_ENABLE_REACTOR
+        if ( 0 != runtime->io_waiters )
+        {
+            kraken_reactor_poll( runtime, 0 );
+        }
+#endif // KRAKEN_ENABLE_REACTOR
+
+        if ( 0 != __atomic_load_n( &runtime->task_count, __ATOMIC_RELAXED ) )
+        {
+            kraken_tasks_run( runtime );
+        }
+    }
+
+    // Tasks and requests of other os threads are handled by the main thread. While some
+    // wait it gets the processor next, wherever the scheduler has put it, so they take
+    // turns with the READY threads.
+    main_turn = current_thread != runtime->main_thread &&
+                ( 0 != __atomic_load_n( &runtime->task_count, __ATOMIC_RELAXED ) ||
+                  NULL != __atomic_load_n( &runtime->inbox, __ATOMIC_RELAXED ) );
+
+    if ( 0 != __atomic_load_n( &runtime->timer_count, __ATOMIC_RELAXED ) )
+    {
+        kraken_timers_advance( runtime );
+    }
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+    uint64_t now = kraken_now();
+
+    current_thread->vruntime += now - runtime->switch_time;
+    runtime->switch_time      = now;
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+
+    kraken_lock( &runtime->lock );
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+    // keep running while the current thread is still the least served one
+    next_thread = kraken_queue_first( runtime );
+
+    if ( READY == status && current_thread != runtime->main_thread && !main_turn &&
+         ( NULL == next_thread ||
+           current_thread->vruntime <= kraken_fair_key( runtime, next_thread ) ) )
+    {
+        kraken_unlock( &runtime->lock );
+        kraken_preempt_enable();
+
+        return false;
+    }
+#elif KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+    // only threads of the same or a higher level take over from a yielding thread
+    next_thread = kraken_queue_first( runtime );
+
+    if ( READY == status && current_thread != runtime->main_thread && !main_turn &&
+         ( NULL == next_thread || next_thread->priority < current_thread->priority ) )
+    {
+        kraken_unlock( &runtime->lock );
+        kraken_preempt_enable();
+
+        return false;
+    }
+#endif // KRAKEN_SCHEDULER
+
+    if ( !main_turn )
+    {
+        next_thread = kraken_queue_pop( runtime );
+    }
+    else if ( NULL == runtime->pool )
+    {
+        // the main thread of a runtime without a pool is queued whenever it isn't running
+        next_thread = kraken_queue_remove( runtime, runtime->main_thread );
+    }
+    else
+    {
+        // the os thread driving a pool runtime is never queued
+        next_thread = runtime->main_thread;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    if ( NULL == next_thread )
+    {
+        if ( READY == status || current_thread == runtime->main_thread )
+        {
+            kraken_preempt_enable();
+
+            return false;
+        }
+
+        next_thread = runtime->main_thread;
+    }
+
+#if KRAKEN_ENABLE_STATS
+    kraken_account_switch( runtime, current_thread, next_thread );
+#endif // KRAKEN_ENABLE_STATS
+
+    kraken_trace( runtime, KRAKEN_TRACE_SWITCH, current_thread, next_thread );
+
+    // The current thread is handed to the scheduler by kraken_finish_switch, after its
+    // context has been saved. Until then no other runtime may pick it up.
+    runtime->previous_thread = current_thread;
+    runtime->previous_status = status;
+
+    next_thread->status      = RUNNING;
+    next_thread->runtime     = runtime;
+    runtime->current_thread  = next_thread;
+
+    assert( runtime->current_thread != NULL );
+
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    // frames of a stopped thread are not worth saving
+    if ( STOPPED == status && current_thread == runtime->stack_occupant )
+    {
+        runtime->stack_occupant = NULL;
+    }
+
+    if ( next_thread->shared_stack && next_thread != runtime->stack_occupant )
+    {
+        if ( current_thread->shared_stack )
+        {
+            runtime->copy_target = next_thread;
+            kraken_switch( &current_thread->context, &runtime->copy_context, runtime );
+            kraken_finish_switch( kraken_local( runtime ) );
+            kraken_preempt_enable();
+
+            return true;
+        }
+
+        kraken_shared_stack_swap( runtime, next_thread );
+    }
+#endif // KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+
+    // switch from old context to new context
+    kraken_switch( &current_thread->context, &next_thread->context, runtime );
+
+    kraken_finish_switch( kraken_local( runtime ) );
+
+    // disabled by the thread that switched here, on this os thread
+    kraken_preempt_enable();
+
+    return true;
+} // kraken_reschedule
+
+
+/// ### kraken_finish_switch
+/// Completes a switch on behalf of the thread that was switched away from. Called by the
+/// thread that was switched to, once the old context is saved.
+/// ```C
+/// void kraken_finish_switch ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_finish_switch
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread* previous_thread = runtime->previous_thread;
+
+    if ( NULL == previous_thread )
+    {
+        return;
+    }
+
+    runtime->previous_thread = NULL;
+
+    if ( READY == runtime->previous_status )
+    {
+        previous_thread->status      = READY;
+        previous_thread->ready_since = runtime->run_start;
+
+        // the os thread driving a pool runtime is never queued or stolen
+        if ( NULL == runtime->pool || previous_thread != runtime->main_thread )
+        {
+            kraken_lock( &runtime->lock );
+            kraken_queue_push( runtime, previous_thread );
+            kraken_unlock( &runtime->lock );
+        }
+    }
+    else if ( BLOCKED == runtime->previous_status )
+    {
+        uint32_t park_state = KRAKEN_PARK_EMPTY;
+
+        kraken_lock( &runtime->lock );
+
+        // an unpark that came in while switching away turns the park into a yield
+        if ( __atomic_compare_exchange_n( &previous_thread->park_state, &park_state,
+                                          KRAKEN_PARK_PARKED, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            kraken_trace( runtime, KRAKEN_TRACE_BLOCK, previous_thread, NULL );
+
+            previous_thread->status        = BLOCKED;
+            previous_thread->blocked_since = kraken_now();
+            previous_thread->reclaim_end   = NULL;
+
+            // only private stacks have pages to give back
+            if ( !previous_thread->shared_stack )
+            {
+                previous_thread->next = NULL;
+                previous_thread->prev = runtime->parked_tail;
+
+                if ( NULL == runtime->parked_tail )
+                {
+                    runtime->parked_head = previous_thread;
+                }
+                else
+                {
+                    runtime->parked_tail->next = previous_thread;
+                }
+
+                runtime->parked_tail = previous_thread;
+            }
+        }
+        else
+        {
+            __atomic_store_n( &previous_thread->park_state, KRAKEN_PARK_EMPTY, __ATOMIC_RELEASE );
+
+            previous_thread->status      = READY;
+            previous_thread->ready_since = runtime->run_start;
+            kraken_queue_push( runtime, previous_thread );
+        }
+
+        kraken_unlock( &runtime->lock );
+    }
+    else if ( STOPPED == runtime->previous_status )
+    {
+        struct kraken_thread* joiner = NULL;
+        bool                  joinable;
+
+#if KRAKEN_ENABLE_STACK_WATERMARK
+        if ( NULL != previous_thread->owner->stack_report )
+        {
+            previous_thread->owner->stack_report( previous_thread,
+                                                  kraken_stack_usage( previous_thread ) );
+        }
+#endif // KRAKEN_ENABLE_STACK_WATERMARK
+
+        // nothing runs on the stack anymore, keep it around for the next thread
+        if ( previous_thread->shared_stack )
+        {
+            free( previous_thread->saved_stack );
+            previous_thread->saved_stack    = NULL;
+            previous_thread->saved_size     = 0;
+            previous_thread->saved_capacity = 0;
+        }
+        else
+        {
+            kraken_stack_release( runtime, previous_thread->stack, previous_thread->stack_size );
+            previous_thread->stack = NULL;
+        }
+
+        kraken_lock( &previous_thread->owner->lock );
+
+        joinable = previous_thread->joinable;
+
+        if ( joinable )
+        {
+            // the slot stays with its result until kraken_join or kraken_detach
+            previous_thread->finished = true;
+            previous_thread->owner->zombie_threads++;
+            joiner = kraken_waiters_pop( &previous_thread->joiners );
+        }
+
+        kraken_unlock( &previous_thread->owner->lock );
+
+        if ( !joinable )
+        {
+            // the slot can be reused by the owner from here on
+            kraken_release_thread( previous_thread );
+        }
+        else if ( NULL != joiner )
+        {
+            kraken_waiters_grant( joiner );
+        }
+
+#if KRAKEN_ENABLE_POOL
+        if ( NULL != runtime->pool )
+        {
+            __atomic_sub_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+        }
+#endif // KRAKEN_ENABLE_POOL
+    }
+} // kraken_finish_switch
+
+
+/// ### kraken_yield
+/// Switches to a different thread once the current thread has completed its work
+/// ```C
+/// bool kraken_yield ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns false if there was no other thread to switch to
+bool kraken_yield
+(
+    struct kraken_runtime*  runtime
+)
+{
+    runtime = kraken_local( runtime );
+
+    kraken_trace( runtime, KRAKEN_TRACE_YIELD, runtime->current_thread, NULL );
+
+    return kraken_reschedule( runtime, READY );
+} // kraken_yield
+
+
+/// ### kraken_park
+/// Blocks the current thread until kraken_unpark is called for it. Returns right away if
+/// the thread was unparked since it last parked. Blocked threads are not scheduled and,
+/// after `reclaim_after` nanoseconds, give the unused part of their stack back to the os.
+/// ```C
+/// void kraken_park ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+void kraken_park
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread* current_thread;
+    uint32_t              park_state = KRAKEN_PARK_NOTIFIED;
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+
+    assert( current_thread != runtime->main_thread && "KRAKEN: The main thread can't park." );
+
+    if ( __atomic_compare_exchange_n( &current_thread->park_state, &park_state,
+                                      KRAKEN_PARK_EMPTY, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+    {
+        return;
+    }
+
+    kraken_reschedule( runtime, BLOCKED );
+} // kraken_park
+
+
+/// ### kraken_unpark_claim
+/// Moves the park state of a thread on behalf of an unpark.
+/// ```C
+/// bool kraken_unpark_claim ( struct kraken_thread* thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The thread to wake up
+/// > Returns true if the thread is parked and the caller has to queue it
+static bool kraken_unpark_claim
+(
+    struct kraken_thread*   thread
+)
+{
+    uint32_t state = __atomic_load_n( &thread->park_state, __ATOMIC_ACQUIRE );
+
+    while ( true )
+    {
+        if ( KRAKEN_PARK_NOTIFIED == state )
+        {
+            return false;
+        }
+
+        if ( __atomic_compare_exchange_n( &thread->park_state, &state,
+                                          KRAKEN_PARK_EMPTY == state ?
+                                          KRAKEN_PARK_NOTIFIED : KRAKEN_PARK_EMPTY,
+                                          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            return KRAKEN_PARK_EMPTY != state;
+        }
+    }
+} // kraken_unpark_claim
+
+
+/// ### kraken_unpark_queue
+/// Puts a parked thread whose unpark was claimed back on the run queue of the runtime it
+/// parked on. The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_unpark_queue ( struct kraken_runtime* runtime,
+///                            struct kraken_thread*  thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime the thread parked on
+/// thread      | The thread to wake up
+/// Does not return.
+static void kraken_unpark_queue
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    if ( !thread->shared_stack && NULL == thread->reclaim_end )
+    {
+        kraken_parked_remove( runtime, thread );
+    }
+
+    thread->status = READY;
+#if KRAKEN_ENABLE_STATS
+    thread->ready_since = kraken_now();
+#endif // KRAKEN_ENABLE_STATS
+    kraken_trace( runtime, KRAKEN_TRACE_WAKE, thread, NULL );
+    kraken_queue_push( runtime, thread );
+} // kraken_unpark_queue
+
+
+/// ### kraken_unpark
+/// Makes a parked thread READY again, or lets its next kraken_park return right away.
+/// Can be called from any thread of any runtime. Other os threads need
+/// `KRAKEN_ENABLE_LOCKING`, on with the pool or the offload pool, or use
+/// kraken_submit_unpark.
+/// ```C
+/// void kraken_unpark ( struct kraken_thread* thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The thread to wake up
+/// Does not return.
+void kraken_unpark
+(
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_runtime* runtime;
+
+    if ( !kraken_unpark_claim( thread ) )
+    {
+        return;
+    }
+
+    // the thread is parked and this call won the right to queue it
+    runtime = thread->runtime;
+
+    kraken_lock( &runtime->lock );
+    kraken_unpark_queue( runtime, thread );
+    kraken_unlock( &runtime->lock );
+
+    kraken_wake( runtime );
+} // kraken_unpark
+
+
+/// ### kraken_timer_insert
+/// Puts a timer on the wheel of a runtime, in the lowest level whose turn reaches its
+/// tick. Timers beyond the last level wait in its farthest slot and are placed again
+/// when that slot comes up. The caller holds `runtime->lock`.
+/// ```C
+/// void kraken_timer_insert ( struct kraken_runtime* runtime,
+///                            struct kraken_timer*   timer )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// timer       | The timer, with `tick` set
+/// Does not return.
+static void kraken_timer_insert
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_timer*    timer
+)
+{
+    uint64_t tick  = timer->tick > runtime->timer_tick ? timer->tick : runtime->timer_tick + 1;
+    uint64_t delta = tick - runtime->timer_tick;
+    uint32_t level = 0;
+
+    while ( level < KRAKEN_TIMER_LEVELS - 1 &&
+            delta >= ( 1ULL << ( KRAKEN_TIMER_BITS * ( level + 1 ) ) ) )
+    {
+        level++;
+    }
+
+    if ( delta >= ( 1ULL << ( KRAKEN_TIMER_BITS * KRAKEN_TIMER_LEVELS ) ) )
+    {
+        tick = runtime->timer_tick +
+               ( ( 1ULL << ( KRAKEN_TIMER_BITS * KRAKEN_TIMER_LEVELS ) ) - 1 );
+    }
+
+    timer->slot    = &runtime->timer_wheel[ level ]
+                                          [ ( tick >> ( KRAKEN_TIMER_BITS * level ) ) &
+                                            ( KRAKEN_TIMER_SLOTS - 1 ) ];
+    timer->prev    = NULL;
+    timer->next    = *timer->slot;
+    timer->runtime = runtime;
+
+    if ( NULL != timer->next )
+    {
+        timer->next->prev = timer;
+    }
+
+    *timer->slot = timer;
+} // kraken_timer_insert
+
+
+/// ### kraken_timer_remove
+/// Takes a pending timer off the wheel. The caller holds `timer->runtime->lock`.
+/// ```C
+/// void kraken_timer_remove ( struct kraken_timer* timer )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// timer       | The timer
+/// Does not return.
+static void kraken_timer_remove
+(
+    struct kraken_timer*    timer
+)
+{
+    if ( NULL == timer->prev )
+    {
+        *timer->slot = timer->next;
+    }
+    else
+    {
+        timer->prev->next = timer->next;
+    }
+
+    if ( NULL != timer->next )
+    {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->slot = NULL;
+    timer->next = NULL;
+    timer->prev = NULL;
+} // kraken_timer_remove
+
+
+/// ### kraken_timers_advance
+/// Turns the timer wheel of a runtime up to the current tick. Slots of the upper levels
+/// are spread over the levels below whenever the level below completes a turn, timers of
+/// the level 0 slots passed wake their threads. Ticks without a slot to handle are jumped
+/// over, so the time spent doesn't grow with the time since the last turn.
+/// ```C
+/// void kraken_timers_advance ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_timers_advance
+(
+    struct kraken_runtime*  runtime
+)
+{
+    uint64_t             target = kraken_now() / KRAKEN_TIMER_TICK;
+    uint64_t             next;
+    struct kraken_timer* timer;
+    struct kraken_timer* next_timer;
+    uint32_t             level;
+    uint32_t             index;
+
+    kraken_lock( &runtime->lock );
+
+    while ( runtime->timer_tick < target )
+    {
+        next = runtime->timer_tick + 1;
+
+        // busy wheels take the next tick right away, the others skip the empty stretch
+        if ( NULL == runtime->timer_wheel[ 0 ][ next & ( KRAKEN_TIMER_SLOTS - 1 ) ] )
+        {
+            next = kraken_timers_next( runtime );
+        }
+
+        if ( next > target )
+        {
+            runtime->timer_tick = target;
+            break;
+        }
+
+        runtime->timer_tick = next;
+
+        for ( level = 1; level < KRAKEN_TIMER_LEVELS; level++ )
+        {
+            if ( 0 != ( runtime->timer_tick & ( ( 1ULL << ( KRAKEN_TIMER_BITS * level ) ) - 1 ) ) )
+            {
+                break;
+            }
+
+            index = ( runtime->timer_tick >> ( KRAKEN_TIMER_BITS * level ) ) &
+                    ( KRAKEN_TIMER_SLOTS - 1 );
+            timer = runtime->timer_wheel[ level ][ index ];
+            runtime->timer_wheel[ level ][ index ] = NULL;
+
+            for ( ; NULL != timer; timer = next_timer )
+            {
+                next_timer = timer->next;
+                kraken_timer_insert( runtime, timer );
+            }
+        }
+
+        index = runtime->timer_tick & ( KRAKEN_TIMER_SLOTS - 1 );
+        timer = runtime->timer_wheel[ 0 ][ index ];
+        runtime->timer_wheel[ 0 ][ index ] = NULL;
+
+        for ( ; NULL != timer; timer = next_timer )
+        {
+            struct kraken_thread* thread = ( struct kraken_thread* )
+                ( ( char* )timer - offsetof( struct kraken_thread, timer ) );
+
+            next_timer  = timer->next;
+            timer->slot = NULL;
+            timer->next = NULL;
+            timer->prev = NULL;
+            runtime->timer_count--;
+
+            if ( kraken_unpark_claim( thread ) )
+            {
+                kraken_unpark_queue( runtime, thread );
+            }
+        }
+    }
+
+    kraken_unlock( &runtime->lock );
+} // kraken_timers_advance
+
+
+/// ### kraken_timers_next
+/// Finds a lower bound for the tick the next timer of a runtime expires at: the start of
+/// the first occupied slot of every level. The caller holds `runtime->lock`.
+/// ```C
+/// uint64_t kraken_timers_next ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// > Returns the tick or UINT64_MAX if no timer is pending
+static uint64_t kraken_timers_next
+(
+    struct kraken_runtime*  runtime
+)
+{
+    uint64_t next = UINT64_MAX;
+    uint64_t tick;
+    uint32_t level;
+    uint32_t step;
+
+    if ( 0 == runtime->timer_count )
+    {
+        return next;
+    }
+
+    for ( level = 0; level < KRAKEN_TIMER_LEVELS; level++ )
+    {
+        for ( step = 1; step <= KRAKEN_TIMER_SLOTS; step++ )
+        {
+            tick = ( ( runtime->timer_tick >> ( KRAKEN_TIMER_BITS * level ) ) + step ) <<
+                   ( KRAKEN_TIMER_BITS * level );
+
+            if ( NULL != runtime->timer_wheel[ level ][ ( tick >> ( KRAKEN_TIMER_BITS * level ) ) &
+                                                        ( KRAKEN_TIMER_SLOTS - 1 ) ] )
+            {
+                next = tick < next ? tick : next;
+                break;
+            }
+        }
+    }
+
+    return next;
+} // kraken_timers_next
+
+
+/// ### kraken_idle
+/// Puts the os thread driving a runtime to sleep until a timer expires, `deadline` passes
+/// or kraken_wake is called for the runtime. Returns right away if a thread is READY.
+/// While threads wait for file descriptors the os thread sleeps in epoll_wait instead,
+/// which also returns when one of the descriptors becomes ready.
+/// ```C
+/// void kraken_idle ( struct kraken_runtime* runtime,
+///                    uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// deadline    | Monotonic clock time to wake up at the latest, UINT64_MAX for none
+/// Does not return.
+static void kraken_idle
+(
+    struct kraken_runtime*  runtime,
+    uint64_t                deadline
+)
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+    struct timespec timeout;
+    uint64_t        next;
+    uint64_t        now;
+    bool            ready;
+    uint32_t        idle = KRAKEN_IDLE_SLEEPING;
+
+#if KRAKEN_ENABLE_REACTOR
+    if ( 0 != runtime->io_waiters )
+    {
+        idle = KRAKEN_IDLE_POLLING;
+    }
+#endif // KRAKEN_ENABLE_REACTOR
+
+    // announce the sleep before looking at the queue one last time, wakers do the reverse.
+    // A wake since the last sleep may be for something the caller hasn't looked at yet.
+    ready = KRAKEN_IDLE_WOKEN == __atomic_exchange_n( &runtime->idle, idle, __ATOMIC_SEQ_CST );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+    kraken_lock( &runtime->lock );
+    ready = ready || NULL != kraken_queue_first( runtime ) || 0 != runtime->task_count ||
+            NULL != __atomic_load_n( &runtime->inbox, __ATOMIC_RELAXED );
+    next  = kraken_timers_next( runtime );
+    kraken_unlock( &runtime->lock );
+
+    next     = UINT64_MAX == next ? next : next * KRAKEN_TIMER_TICK;
+    deadline = next < deadline ? next : deadline;
+    now      = kraken_now();
+
+    if ( !ready && now < deadline )
+    {
+        timeout.tv_sec  = ( time_t )( ( deadline - now ) / 1000000000ULL );
+        timeout.tv_nsec = ( long )( ( deadline - now ) % 1000000000ULL );
+
+#if KRAKEN_ENABLE_REACTOR
+        if ( KRAKEN_IDLE_POLLING == idle )
+        {
+            // epoll counts in milliseconds, round up so timers don't fire early
+            kraken_reactor_poll( runtime, UINT64_MAX == deadline ? -1 :
+                                 ( int )( ( deadline - now + 999999ULL ) / 1000000ULL ) );
+        }
+        else
+#endif // KRAKEN_ENABLE_REACTOR
+#if defined( __linux__ )
+        syscall( SYS_futex, &runtime->idle, FUTEX_WAIT_PRIVATE, KRAKEN_IDLE_SLEEPING,
+                 UINT64_MAX == deadline ? NULL : &timeout, NULL, 0 );
+#else
+        // without futexes poll for wakers at least once a millisecond
+        if ( UINT64_MAX == deadline || deadline - now > 1000000ULL )
+        {
+            timeout.tv_sec  = 0;
+            timeout.tv_nsec = 1000000;
+        }
+
+        nanosleep( &timeout, NULL );
+#endif // defined( __linux__ )
+
+#if KRAKEN_ENABLE_STATS
+        runtime->stats.idle_time += kraken_now() - now;
+#endif // KRAKEN_ENABLE_STATS
+    }
+
+    __atomic_exchange_n( &runtime->idle, KRAKEN_IDLE_NONE, __ATOMIC_ACQ_REL );
+
+    if ( 0 != __atomic_load_n( &runtime->timer_count, __ATOMIC_RELAXED ) )
+    {
+        kraken_timers_advance( runtime );
+    }
+#else
+    ( void )runtime;
+    ( void )deadline;
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+} // kraken_idle
+
+
+/// ### kraken_wake
+/// Wakes the os thread driving a runtime if it sleeps in kraken_idle, or keeps it from
+/// falling asleep in its next one. Called after queueing a thread on a runtime that may be
+/// driven by another os thread.
+/// ```C
+/// void kraken_wake ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_wake
+(
+    struct kraken_runtime*  runtime
+)
+{
+    uint32_t idle;
+
+    // pairs with the store to idle in kraken_idle
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+    if ( KRAKEN_IDLE_WOKEN == __atomic_load_n( &runtime->idle, __ATOMIC_RELAXED ) )
+    {
+        return;
+    }
+
+    idle = __atomic_exchange_n( &runtime->idle, KRAKEN_IDLE_WOKEN, __ATOMIC_SEQ_CST );
+
+#if KRAKEN_ENABLE_REACTOR
+    if ( KRAKEN_IDLE_POLLING == idle )
+    {
+        uint64_t value = 1;
+
+        if ( sizeof( value ) != write( runtime->wake_fd, &value, sizeof( value ) ) )
+        {
+            // the counter is saturated, the os thread is awake anyway
+        }
+    }
+#endif // KRAKEN_ENABLE_REACTOR
+#if defined( __linux__ )
+    if ( KRAKEN_IDLE_SLEEPING == idle )
+    {
+        syscall( SYS_futex, &runtime->idle, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+    }
+#endif // defined( __linux__ )
+    ( void )idle;
+} // kraken_wake
+
+
+/// ### kraken_inbox_push
+/// Pushes a request onto the inbox of a runtime and wakes the os thread driving it. Lock
+/// free, so any os thread can push.
+/// ```C
+/// void kraken_inbox_push ( struct kraken_runtime* runtime,
+///                          struct kraken_request* request )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime
+/// request     | The request
+/// Does not return.
+static void kraken_inbox_push
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_request*  request
+)
+{
+    struct kraken_request* head = __atomic_load_n( &runtime->inbox, __ATOMIC_RELAXED );
+
+    do
+    {
+        request->next = head;
+    }
+    while ( !__atomic_compare_exchange_n( &runtime->inbox, &head, request, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
+
+    kraken_wake( runtime );
+} // kraken_inbox_push
+
+
+/// ### kraken_inbox_drain
+/// Carries out the requests other os threads pushed onto the inbox of a runtime, oldest
+/// first. Runs on the os thread driving the runtime, outside of signal handlers.
+/// ```C
+/// void kraken_inbox_drain ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_inbox_drain
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_request* request = __atomic_exchange_n( &runtime->inbox, NULL,
+                                                          __ATOMIC_ACQUIRE );
+    struct kraken_request* oldest  = NULL;
+    struct kraken_request* next;
+
+    // the inbox is a stack, turn it around
+    while ( NULL != request )
+    {
+        next          = request->next;
+        request->next = oldest;
+        oldest        = request;
+        request       = next;
+    }
+
+    for ( request = oldest; NULL != request; request = next )
+    {
+        struct kraken_thread* thread = request->thread;
+
+        // read before the request can be pushed again
+        next = request->next;
+
+        if ( NULL == thread )
+        {
+            int success = kraken_start_thread( runtime, request->function );
+
+            // only a submitter that asked for the outcome can find out about a failure
+            assert( ( -1 < success || NULL != request->status ) &&
+                    "KRAKEN: Can't start a submitted thread." );
+
+            if ( NULL != request->status )
+            {
+                __atomic_store_n( request->status, success, __ATOMIC_RELEASE );
+            }
+
+#if KRAKEN_ENABLE_POOL
+            // the thread counts for itself now, or never will
+            if ( NULL != runtime->pool )
+            {
+                __atomic_sub_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+            }
+#endif // KRAKEN_ENABLE_POOL
+
+            free( request );
+        }
+        else
+        {
+            __atomic_store_n( &thread->unpark_queued, 0, __ATOMIC_RELEASE );
+            kraken_unpark( thread );
+        }
+    }
+} // kraken_inbox_drain
+
+
+/// ### kraken_submit_thread
+/// Starts a thread on a runtime from any os thread, also one that doesn't drive a
+/// runtime. The thread starts the next time the runtime's main thread gets the processor.
+/// Use kraken_submit_thread_ex to find out whether it could be started.
+/// ```C
+/// int kraken_submit_thread ( struct kraken_runtime* runtime,
+///                            function_type          thread_function )
+/// ```
+/// Parameter       | Description
+/// ----------------|------------------------------------------------------------------------
+/// runtime         | The runtime to start the thread on
+/// thread_function | The function the thread runs
+/// > Returns 0 on success, -1 if out of memory
+int kraken_submit_thread
+(
+    struct kraken_runtime*  runtime,
+    function_type           thread_function
+)
+{
+    return kraken_submit_thread_ex( runtime, thread_function, NULL );
+} // kraken_submit_thread
+
+
+/// ### kraken_submit_thread_ex
+/// kraken_submit_thread that reports back whether the thread could be started. `status`
+/// is set to 1 right away, then to 0 once the thread is on the run queue or to -1 if the
+/// runtime had no free slot or stack memory for it. It is written atomically by the os
+/// thread driving the runtime and has to stay valid until then. A submitted thread keeps
+/// a pool running until it has been started.
+/// ```C
+/// int kraken_submit_thread_ex ( struct kraken_runtime* runtime,
+///                               function_type          thread_function,
+///                               int*                   status )
+/// ```
+/// Parameter       | Description
+/// ----------------|------------------------------------------------------------------------
+/// runtime         | The runtime to start the thread on
+/// thread_function | The function the thread runs
+/// status          | Where to report the outcome, or NULL
+/// > Returns 0 on success, -1 if out of memory
+int kraken_submit_thread_ex
+(
+    struct kraken_runtime*  runtime,
+    function_type           thread_function,
+    int*                    status
+)
+{
+    struct kraken_request* request = ( struct kraken_request* )
+        malloc( sizeof( struct kraken_request ) );
+
+    if ( NULL == request )
+    {
+        return -1;
+    }
+
+    request->function = thread_function;
+    request->thread   = NULL;
+    request->status   = status;
+
+    if ( NULL != status )
+    {
+        __atomic_store_n( status, 1, __ATOMIC_RELAXED );
+    }
+
+#if KRAKEN_ENABLE_POOL
+    // keeps the workers around until the drain has started the thread
+    if ( NULL != runtime->pool )
+    {
+        __atomic_add_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+    }
+#endif // KRAKEN_ENABLE_POOL
+
+    kraken_inbox_push( runtime, request );
+
+    return 0;
+} // kraken_submit_thread_ex
+
+
+/// ### kraken_submit_unpark
+/// kraken_unpark for os threads that don't drive the runtime holding the thread. The
+/// runtime owning the thread unparks it the next time its main thread gets the processor.
+/// Unparks submitted before that one is carried out are merged into it.
+/// ```C
+/// void kraken_submit_unpark ( struct kraken_thread* thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The thread to wake up
+/// Does not return.
+void kraken_submit_unpark
+(
+    struct kraken_thread*   thread
+)
+{
+    if ( 0 != __atomic_exchange_n( &thread->unpark_queued, 1, __ATOMIC_ACQ_REL ) )
+    {
+        return;
+    }
+
+    thread->unpark_request.function = NULL;
+    thread->unpark_request.thread   = thread;
+    thread->unpark_request.status   = NULL;
+
+    kraken_inbox_push( thread->owner, &thread->unpark_request );
+} // kraken_submit_unpark
+
+
+/// ### kraken_post_task
+/// Queues a function to run on the main thread of a runtime, on the main thread's own
+/// stack between two thread switches. Tasks run to completion in the order they were
+/// posted and take turns with the READY threads, a batch of tasks each time the main
+/// thread gets the processor. A task costs no stack and no context switch but must not
+/// block, yield or park. Work that turns out to need that can start a thread. Can be called
+/// from the threads of any runtime of a pool, and from tasks.
+/// ```C
+/// int kraken_post_task ( struct kraken_runtime* runtime,
+///                        kraken_task_type       function,
+///                        void*                  argument )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime to run the task on
+/// function    | The function
+/// argument    | Passed to `function`
+/// > Returns 0 on success and -1 if memory runs out
+int kraken_post_task
+(
+    struct kraken_runtime*  runtime,
+    kraken_task_type        function,
+    void*                   argument
+)
+{
+    struct kraken_task* task;
+
+    assert( NULL != function );
+
+    kraken_lock( &runtime->lock );
+
+    task = runtime->free_tasks;
+
+    if ( NULL != task )
+    {
+        runtime->free_tasks = task->next;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    if ( NULL == task )
+    {
+        task = ( struct kraken_task* )malloc( sizeof( struct kraken_task ) );
+
+        if ( NULL == task )
+        {
+            return -1;
+        }
+    }
+
+    task->next     = NULL;
+    task->function = function;
+    task->argument = argument;
+
+#if KRAKEN_ENABLE_POOL
+    if ( NULL != runtime->pool )
+    {
+        __atomic_add_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+    }
+#endif // KRAKEN_ENABLE_POOL
+
+    kraken_lock( &runtime->lock );
+
+    if ( NULL == runtime->task_tail )
+    {
+        runtime->task_head = task;
+    }
+    else
+    {
+        runtime->task_tail->next = task;
+    }
+
+    runtime->task_tail = task;
+    __atomic_store_n( &runtime->task_count, runtime->task_count + 1, __ATOMIC_RELEASE );
+
+    kraken_unlock( &runtime->lock );
+
+    kraken_wake( runtime );
+
+    return 0;
+} // kraken_post_task
+
+
+/// ### kraken_tasks_run
+/// Runs the tasks waiting on a runtime. Tasks posted meanwhile wait for the next turn so
+/// the threads get theirs. Called by the main thread in kraken_reschedule.
+/// ```C
+/// void kraken_tasks_run ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// Does not return.
+static void kraken_tasks_run
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_task* first_task;
+    struct kraken_task* last_task = NULL;
+    struct kraken_task* task;
+
+    kraken_lock( &runtime->lock );
+
+    first_task         = runtime->task_head;
+    runtime->task_head = NULL;
+    runtime->task_tail = NULL;
+    __atomic_store_n( &runtime->task_count, 0, __ATOMIC_RELEASE );
+
+    kraken_unlock( &runtime->lock );
+
+    runtime->task_running = true;
+
+    for ( task = first_task; NULL != task; task = task->next )
+    {
+        task->function( runtime, task->argument );
+        last_task = task;
+
+#if KRAKEN_ENABLE_POOL
+        if ( NULL != runtime->pool )
+        {
+            __atomic_sub_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+        }
+#endif // KRAKEN_ENABLE_POOL
+    }
+
+    runtime->task_running = false;
+
+    if ( NULL == last_task )
+    {
+        return;
+    }
+
+    kraken_lock( &runtime->lock );
+    last_task->next     = runtime->free_tasks;
+    runtime->free_tasks = first_task;
+    kraken_unlock( &runtime->lock );
+} // kraken_tasks_run
+
+
+/// ### kraken_park_until
+/// Blocks the current thread until kraken_unpark is called for it or the monotonic clock
+/// reaches `deadline` (see kraken_park).
+/// ```C
+/// bool kraken_park_until ( struct kraken_runtime* runtime,
+///                          uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// deadline    | Monotonic clock time in nanoseconds (see kraken_now)
+/// > Returns false if the thread woke up because the deadline passed
+bool kraken_park_until
+(
+    struct kraken_runtime*  runtime,
+    uint64_t                deadline
+)
+{
+    struct kraken_thread* current_thread;
+    struct kraken_timer*  timer;
+    bool                  unparked;
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+    timer          = &current_thread->timer;
+
+    if ( kraken_now() >= deadline )
+    {
+        return false;
+    }
+
+    // the thread must park on the runtime whose wheel holds the timer
+    kraken_preempt_disable();
+
+    kraken_lock( &runtime->lock );
+
+    // an empty wheel isn't turned, catch up before measuring the timer against it
+    if ( 0 == runtime->timer_count )
+    {
+        uint64_t now_tick = kraken_now() / KRAKEN_TIMER_TICK;
+
+        runtime->timer_tick = now_tick > runtime->timer_tick ? now_tick : runtime->timer_tick;
+    }
+
+    timer->tick = ( deadline + KRAKEN_TIMER_TICK - 1 ) / KRAKEN_TIMER_TICK;
+    kraken_timer_insert( runtime, timer );
+    runtime->timer_count++;
+    kraken_unlock( &runtime->lock );
+
+    kraken_park( runtime );
+
+    kraken_preempt_enable();
+
+    // a timer still pending means something else woke the thread up. The thread may
+    // have been stolen since, but the timer stays on the wheel it was put on.
+    runtime = timer->runtime;
+
+    kraken_lock( &runtime->lock );
+    unparked = NULL != timer->slot;
+
+    if ( unparked )
+    {
+        kraken_timer_remove( timer );
+        runtime->timer_count--;
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    return unparked;
+} // kraken_park_until
+
+
+/// ### kraken_sleep_until
+/// Blocks the current thread until the monotonic clock reaches `deadline`. Other threads
+/// run meanwhile and the os thread sleeps if there are none. Unparks while sleeping are
+/// swallowed. Wakes up at most one `KRAKEN_TIMER_TICK` late on an idle runtime.
+/// ```C
+/// void kraken_sleep_until ( struct kraken_runtime* runtime,
+///                           uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// deadline    | Monotonic clock time in nanoseconds (see kraken_now)
+/// Does not return.
+void kraken_sleep_until
+(
+    struct kraken_runtime*  runtime,
+    uint64_t                deadline
+)
+{
+    runtime = kraken_local( runtime );
+
+    while ( kraken_now() < deadline )
+    {
+        // the main thread can't park, it runs the others until the deadline instead
+        if ( runtime->current_thread != runtime->main_thread )
+        {
+            kraken_park_until( runtime, deadline );
+        }
+        else if ( !kraken_yield( runtime ) )
+        {
+            kraken_idle( runtime, deadline );
+        }
+    }
+} // kraken_sleep_until
+
+
+/// ### kraken_sleep
+/// Blocks the current thread for at least `nanoseconds` (see kraken_sleep_until).
+/// ```C
+/// void kraken_sleep ( struct kraken_runtime* runtime,
+///                     uint64_t               nanoseconds )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// nanoseconds | How long to sleep
+/// Does not return.
+void kraken_sleep
+(
+    struct kraken_runtime*  runtime,
+    uint64_t                nanoseconds
+)
+{
+    kraken_sleep_until( runtime, kraken_now() + nanoseconds );
+} // kraken_sleep
+
+
+#if KRAKEN_ENABLE_REACTOR
+/// ### kraken_reactor_arm
+/// Records the current thread as waiting for a file descriptor and arms the runtime's
+/// epoll instance for it, creating the instance on first use. Each descriptor can have
+/// one reader and one writer per runtime.
+/// ```C
+/// int kraken_reactor_arm ( struct kraken_runtime* runtime,
+///                          int                    fd,
+///                          bool                   write )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime the current thread runs on
+/// fd          | The file descriptor
+/// write       | Wait for the descriptor to become writable instead of readable
+/// > Returns 0 on success, -1 with `errno` set otherwise
+static int kraken_reactor_arm
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    bool                    write
+)
+{
+    struct kraken_io_state* state;
+    struct kraken_thread**  waiter;
+    struct epoll_event      event;
+
+    if ( 0 > fd )
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    if ( -1 == runtime->reactor_fd )
+    {
+        runtime->reactor_fd = epoll_create1( EPOLL_CLOEXEC );
+        runtime->wake_fd    = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+        assert( -1 != runtime->reactor_fd && -1 != runtime->wake_fd &&
+                "KRAKEN: Can't create the reactor." );
+
+        event.events  = EPOLLIN;
+        event.data.fd = runtime->wake_fd;
+
+        if ( -1 == epoll_ctl( runtime->reactor_fd, EPOLL_CTL_ADD, runtime->wake_fd, &event ) )
+        {
+            assert( false && "KRAKEN: Can't create the reactor." );
+        }
+    }
+
+    if ( ( uint32_t )fd >= runtime->io_capacity )
+    {
+        uint32_t                capacity = runtime->io_capacity * 2;
+        struct kraken_io_state* io_table;
+
+        capacity = capacity > ( uint32_t )fd ? capacity : ( uint32_t )fd + 1;
+        io_table = ( struct kraken_io_state* )
+            realloc( runtime->io_table, capacity * sizeof( struct kraken_io_state ) );
+
+        if ( NULL == io_table )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        memset( io_table + runtime->io_capacity, 0,
+                ( capacity - runtime->io_capacity ) * sizeof( struct kraken_io_state ) );
+
+        runtime->io_table    = io_table;
+        runtime->io_capacity = capacity;
+    }
+
+    state  = &runtime->io_table[ fd ];
+    waiter = write ? &state->writer : &state->reader;
+
+    if ( NULL != *waiter )
+    {
+        errno = EBUSY;
+        return -1;
+    }
+
+    *waiter        = runtime->current_thread;
+    event.events   = EPOLLONESHOT |
+                     ( NULL != state->reader ? EPOLLIN | EPOLLRDHUP : 0 ) |
+                     ( NULL != state->writer ? EPOLLOUT : 0 );
+    event.data.fd  = fd;
+
+    // the descriptor may have been closed and reopened since it was registered
+    if ( ( !state->registered ||
+           -1 == epoll_ctl( runtime->reactor_fd, EPOLL_CTL_MOD, fd, &event ) ) &&
+         -1 == epoll_ctl( runtime->reactor_fd, EPOLL_CTL_ADD, fd, &event ) &&
+         ( EEXIST != errno ||
+           -1 == epoll_ctl( runtime->reactor_fd, EPOLL_CTL_MOD, fd, &event ) ) )
+    {
+        *waiter = NULL;
+        return -1;
+    }
+
+    state->registered = true;
+    runtime->current_thread->io_waiting = 1;
+    runtime->io_waiters++;
+
+    return 0;
+} // kraken_reactor_arm
+
+
+/// ### kraken_reactor_poll
+/// Wakes the threads waiting for file descriptors that became ready. Runs on the os
+/// thread driving the runtime.
+/// ```C
+/// void kraken_reactor_poll ( struct kraken_runtime* runtime,
+///                            int                    timeout )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// timeout     | Milliseconds to wait for a descriptor, -1 for no limit
+/// Does not return.
+static void kraken_reactor_poll
+(
+    struct kraken_runtime*  runtime,
+    int                     timeout
+)
+{
+    struct epoll_event      events[ KRAKEN_REACTOR_EVENTS ];
+    struct kraken_io_state* state;
+    struct kraken_thread*   woken[ 2 ];
+    int                     count;
+    int                     i;
+    int                     j;
+
+    count = epoll_wait( runtime->reactor_fd, events, KRAKEN_REACTOR_EVENTS, timeout );
+
+    for ( i = 0; i < count; i++ )
+    {
+        if ( events[ i ].data.fd == runtime->wake_fd )
+        {
+            uint64_t value;
+
+            if ( sizeof( value ) != read( runtime->wake_fd, &value, sizeof( value ) ) )
+            {
+                // another poll drained it already
+            }
+
+            continue;
+        }
+
+        state      = &runtime->io_table[ events[ i ].data.fd ];
+        woken[ 0 ] = NULL;
+        woken[ 1 ] = NULL;
+
+        // errors and hang ups wake both sides, the next syscall reports them
+        if ( 0 != ( events[ i ].events & ( EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP ) ) )
+        {
+            woken[ 0 ]    = state->reader;
+            state->reader = NULL;
+        }
+
+        if ( 0 != ( events[ i ].events & ( EPOLLOUT | EPOLLERR | EPOLLHUP ) ) )
+        {
+            woken[ 1 ]    = state->writer;
+            state->writer = NULL;
+        }
+
+        // one shot disabled the descriptor, arm it again for the side still waiting
+        if ( NULL != state->reader || NULL != state->writer )
+        {
+            struct epoll_event event;
+
+            event.events  = EPOLLONESHOT |
+                            ( NULL != state->reader ? EPOLLIN | EPOLLRDHUP : 0 ) |
+                            ( NULL != state->writer ? EPOLLOUT : 0 );
+            event.data.fd = events[ i ].data.fd;
+
+            epoll_ctl( runtime->reactor_fd, EPOLL_CTL_MOD, events[ i ].data.fd, &event );
+        }
+
+        for ( j = 0; j < 2; j++ )
+        {
+            if ( NULL == woken[ j ] )
+            {
+                continue;
+            }
+
+            runtime->io_waiters--;
+            __atomic_store_n( &woken[ j ]->io_waiting, 0, __ATOMIC_RELEASE );
+
+            // the main thread polls for itself
+            if ( woken[ j ] != runtime->main_thread )
+            {
+                kraken_unpark( woken[ j ] );
+            }
+        }
+    }
+} // kraken_reactor_poll
+
+
+/// ### kraken_wait_io
+/// Blocks the current thread until a file descriptor becomes readable or writable. Other
+/// threads run meanwhile.
+/// ```C
+/// int kraken_wait_io ( struct kraken_runtime* runtime,
+///                      int                    fd,
+///                      bool                   write )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// fd          | The file descriptor
+/// write       | Wait for the descriptor to become writable instead of readable
+/// > Returns 0 on success, -1 with `errno` set otherwise
+static int kraken_wait_io
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    bool                    write
+)
+{
+    struct kraken_thread* current_thread;
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+
+    // a thread switched away from in the middle would leave the table half updated
+    kraken_preempt_disable();
+
+    if ( -1 == kraken_reactor_arm( runtime, fd, write ) )
+    {
+        kraken_preempt_enable();
+
+        // epoll refuses regular files, which never block
+        return EPERM == errno ? 0 : -1;
+    }
+
+    kraken_preempt_enable();
+
+    // other unparks are swallowed until the descriptor is ready
+    while ( 0 != __atomic_load_n( &current_thread->io_waiting, __ATOMIC_ACQUIRE ) )
+    {
+        if ( current_thread != runtime->main_thread )
+        {
+            kraken_park( runtime );
+        }
+        else if ( !kraken_yield( runtime ) )
+        {
+            kraken_idle( runtime, UINT64_MAX );
+        }
+    }
+
+    return 0;
+} // kraken_wait_io
+
+
+/// ### kraken_wait_readable
+/// Blocks the current thread until a file descriptor becomes readable, has an error or
+/// is hung up. Other threads run meanwhile.
+/// ```C
+/// int kraken_wait_readable ( struct kraken_runtime* runtime,
+///                            int                    fd )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// fd          | The file descriptor
+/// > Returns 0 on success, -1 with `errno` set otherwise. `EBUSY` means another thread of
+/// > the runtime waits for the descriptor to become readable already.
+int kraken_wait_readable
+(
+    struct kraken_runtime*  runtime,
+    int                     fd
+)
+{
+    return kraken_wait_io( runtime, fd, false );
+} // kraken_wait_readable
+
+
+/// ### kraken_wait_writable
+/// Blocks the current thread until a file descriptor becomes writable, has an error or
+/// is hung up. Other threads run meanwhile.
+/// ```C
+/// int kraken_wait_writable ( struct kraken_runtime* runtime,
+///                            int                    fd )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// fd          | The file descriptor
+/// > Returns 0 on success, -1 with `errno` set otherwise. `EBUSY` means another thread of
+/// > the runtime waits for the descriptor to become writable already.
+int kraken_wait_writable
+(
+    struct kraken_runtime*  runtime,
+    int                     fd
+)
+{
+    return kraken_wait_io( runtime, fd, true );
+} // kraken_wait_writable
+
+
+/// ### kraken_read
+/// read(2) that blocks only the current thread. The file descriptor has to be in non
+/// blocking mode.
+/// ```C
+/// ssize_t kraken_read ( struct kraken_runtime* runtime,
+///                       int                    fd,
+///                       void*                  buffer,
+///                       size_t                 count )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// fd          | The file descriptor
+/// buffer      | Where to store the bytes read
+/// count       | Most bytes to read
+/// > Returns the number of bytes read, 0 at end of file, -1 with `errno` set on error
+ssize_t kraken_read
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    void*                   buffer,
+    size_t                  count
+)
+{
+    ssize_t result;
+
+    while ( -1 == ( result = read( fd, buffer, count ) ) )
+    {
+        if ( EINTR != errno &&
+             ( ( EAGAIN != errno && EWOULDBLOCK != errno ) ||
+               -1 == kraken_wait_readable( runtime, fd ) ) )
+        {
+            break;
+        }
+    }
+
+    return result;
+} // kraken_read
+
+
+/// ### kraken_write
+/// write(2) that blocks only the current thread. The file descriptor has to be in non
+/// blocking mode. Like write(2) it may write fewer bytes than asked for.
+/// ```C
+/// ssize_t kraken_write ( struct kraken_runtime* runtime,
+///                        int                    fd,
+///                        const void*            buffer,
+///                        size_t                 count )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// fd          | The file descriptor
+/// buffer      | The bytes to write
+/// count       | Number of bytes to write
+/// > Returns the number of bytes written, -1 with `errno` set on error
+ssize_t kraken_write
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    const void*             buffer,
+    size_t                  count
+)
+{
+    ssize_t result;
+
+    while ( -1 == ( result = write( fd, buffer, count ) ) )
+    {
+        if ( EINTR != errno &&
+             ( ( EAGAIN != errno && EWOULDBLOCK != errno ) ||
+               -1 == kraken_wait_writable( runtime, fd ) ) )
+        {
+            break;
+        }
+    }
+
+    return result;
+} // kraken_write
+
+
+/// ### kraken_accept
+/// accept(2) that blocks only the current thread. The listening socket has to be in non
+/// blocking mode, the accepted socket is put in non blocking mode.
+/// ```C
+/// int kraken_accept ( struct kraken_runtime* runtime,
+///                     int                    fd,
+///                     struct sockaddr*       address,
+///                     socklen_t*             address_length )
+/// ```
+/// Parameter      | Description
+/// ---------------|-------------------------------------------------------------------------
+/// runtime        | A pointer to `struct kraken_runtime`
+/// fd             | The listening socket
+/// address        | Where to store the peer's address or NULL
+/// address_length | Size of `address`, updated to the size of the peer's address
+/// > Returns the accepted socket, -1 with `errno` set on error
+int kraken_accept
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    struct sockaddr*        address,
+    socklen_t*              address_length
+)
+{
+    int result;
+
+    while ( -1 == ( result = accept( fd, address, address_length ) ) )
+    {
+        if ( EINTR != errno &&
+             ( ( EAGAIN != errno && EWOULDBLOCK != errno ) ||
+               -1 == kraken_wait_readable( runtime, fd ) ) )
+        {
+            return -1;
+        }
+    }
+
+    if ( -1 == fcntl( result, F_SETFL, fcntl( result, F_GETFL ) | O_NONBLOCK ) )
+    {
+        close( result );
+        return -1;
+    }
+
+    return result;
+} // kraken_accept
+
+
+/// ### kraken_connect
+/// connect(2) that blocks only the current thread. The socket has to be in non blocking
+/// mode.
+/// ```C
+/// int kraken_connect ( struct kraken_runtime* runtime,
+///                      int                    fd,
+///                      const struct sockaddr* address,
+///                      socklen_t              address_length )
+/// ```
+/// Parameter      | Description
+/// ---------------|-------------------------------------------------------------------------
+/// runtime        | A pointer to `struct kraken_runtime`
+/// fd             | The socket
+/// address        | The address to connect to
+/// address_length | Size of `address`
+/// > Returns 0 once connected, -1 with `errno` set on error
+int kraken_connect
+(
+    struct kraken_runtime*  runtime,
+    int                     fd,
+    const struct sockaddr*  address,
+    socklen_t               address_length
+)
+{
+    int       error  = 0;
+    socklen_t length = sizeof( error );
+
+    if ( 0 == connect( fd, address, address_length ) )
+    {
+        return 0;
+    }
+
+    // an interrupted connect goes on in the background like a non blocking one
+    if ( ( EINPROGRESS != errno && EINTR != errno ) ||
+         -1 == kraken_wait_writable( runtime, fd ) ||
+         -1 == getsockopt( fd, SOL_SOCKET, SO_ERROR, &error, &length ) )
+    {
+        return -1;
+    }
+
+    if ( 0 != error )
+    {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+} // kraken_connect
+#endif // KRAKEN_ENABLE_REACTOR
+
+
+#if KRAKEN_ENABLE_OFFLOAD
+/// ### kraken_offload_loop
+/// Body of the helper os threads of the offload pool. Runs queued calls one after the
+/// other and wakes up the threads that made them.
+/// ```C
+/// void* kraken_offload_loop ( void* unused )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// unused      | Unused
+/// Does not return.
+static void* kraken_offload_loop
+(
+    void*   unused
+)
+{
+    struct kraken_offload_job* job;
+    struct kraken_thread*      thread;
+    struct kraken_runtime*     runtime;
+    uint64_t                   start;
+    uint64_t                   wait;
+
+    ( void )unused;
+
+    pthread_mutex_lock( &kraken_offload.mutex );
+
+    while ( true )
+    {
+        while ( NULL == kraken_offload.head )
+        {
+            pthread_cond_wait( &kraken_offload.ready, &kraken_offload.mutex );
+        }
+
+        job                 = kraken_offload.head;
+        kraken_offload.head = job->next;
+
+        if ( NULL == kraken_offload.head )
+        {
+            kraken_offload.tail = NULL;
+        }
+
+        start = kraken_now();
+        wait  = start - job->queued_at;
+
+        kraken_offload.stats.queue_depth--;
+        kraken_offload.stats.busy++;
+        kraken_offload.stats.wait_time   += wait;
+        kraken_offload.stats.longest_wait = wait > kraken_offload.stats.longest_wait ?
+                                            wait : kraken_offload.stats.longest_wait;
+
+        pthread_mutex_unlock( &kraken_offload.mutex );
+
+        job->result = job->function( job->argument );
+
+        // the job lives in the thread, which may stop as soon as it sees the call done.
+        // A done of 1 keeps it waiting until the unpark is through.
+        thread  = job->thread;
+        runtime = thread->runtime;
+
+        __atomic_store_n( &job->done, 1, __ATOMIC_RELEASE );
+
+        if ( thread == runtime->main_thread )
+        {
+            kraken_wake( runtime );
+        }
+        else
+        {
+            kraken_unpark( thread );
+        }
+
+        __atomic_store_n( &job->done, 2, __ATOMIC_RELEASE );
+
+        pthread_mutex_lock( &kraken_offload.mutex );
+
+        kraken_offload.stats.busy--;
+        kraken_offload.stats.calls++;
+        kraken_offload.stats.run_time += kraken_now() - start;
+    }
+
+    return NULL;
+} // kraken_offload_loop
+
+
+/// ### kraken_offload_start
+/// Starts the helper os threads of the offload pool, once per process.
+/// ```C
+/// void kraken_offload_start ( void )
+/// ```
+/// Does not return.
+static void kraken_offload_start
+(
+    void
+)
+{
+    pthread_t helper;
+    uint32_t  i;
+
+    for ( i = 0; i < KRAKEN_OFFLOAD_THREADS; i++ )
+    {
+        if ( 0 == pthread_create( &helper, NULL, kraken_offload_loop, NULL ) )
+        {
+            pthread_detach( helper );
+            kraken_offload.threads++;
+        }
+    }
+} // kraken_offload_start
+
+
+/// ### kraken_blocking
+/// Runs a call that may block the os thread, like getaddrinfo or fsync, on one of the
+/// `KRAKEN_OFFLOAD_THREADS` helper os threads of the process. The current thread parks
+/// until the call returns while the other threads of its runtime keep running. Calls
+/// queue up while all helpers are busy (see kraken_read_offload_stats).
+/// ```C
+/// void* kraken_blocking ( struct kraken_runtime* runtime,
+///                         kraken_blocking_type   function,
+///                         void*                  argument )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// function    | The call to run. It must not use the runtime.
+/// argument    | Passed to `function`
+/// > Returns what `function` returned
+void* kraken_blocking
+(
+    struct kraken_runtime*  runtime,
+    kraken_blocking_type    function,
+    void*                   argument
+)
+{
+    struct kraken_thread*      current_thread;
+    struct kraken_offload_job* job;
+    uint32_t                   done;
+
+    assert( NULL != function && "KRAKEN: Can't offload no function." );
+
+    pthread_once( &kraken_offload.once, kraken_offload_start );
+
+    // without helpers the call blocks the runtime, as it would have without kraken
+    if ( 0 == kraken_offload.threads )
+    {
+        return function( argument );
+    }
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+    job            = &current_thread->offload;
+
+    job->function  = function;
+    job->argument  = argument;
+    job->result    = NULL;
+    job->next      = NULL;
+    job->thread    = current_thread;
+    job->queued_at = kraken_now();
+    job->done      = 0;
+
+    // a thread switched away from while holding the mutex would stall the helpers
+    kraken_preempt_disable();
+    pthread_mutex_lock( &kraken_offload.mutex );
+
+    if ( NULL == kraken_offload.tail )
+    {
+        kraken_offload.head = job;
+    }
+    else
+    {
+        kraken_offload.tail->next = job;
+    }
+
+    kraken_offload.tail = job;
+    kraken_offload.stats.queue_depth++;
+    kraken_offload.stats.queue_max = kraken_offload.stats.queue_depth >
+                                     kraken_offload.stats.queue_max ?
+                                     kraken_offload.stats.queue_depth :
+                                     kraken_offload.stats.queue_max;
+
+    pthread_cond_signal( &kraken_offload.ready );
+    pthread_mutex_unlock( &kraken_offload.mutex );
+    kraken_preempt_enable();
+
+    // other unparks are swallowed until the call is done
+    while ( 2 != ( done = __atomic_load_n( &job->done, __ATOMIC_ACQUIRE ) ) )
+    {
+        if ( 0 == done && current_thread != runtime->main_thread )
+        {
+            kraken_park( runtime );
+        }
+        else if ( !kraken_yield( runtime ) && 0 == done )
+        {
+            kraken_idle( runtime, UINT64_MAX );
+        }
+
+        runtime = kraken_local( runtime );
+    }
+
+    return job->result;
+} // kraken_blocking
+
+
+/// ### kraken_read_offload_stats
+/// Copies the counters of the offload pool.
+/// ```C
+/// void kraken_read_offload_stats ( struct kraken_offload_stats* stats )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// stats       | Receives the counters
+/// Does not return.
+void kraken_read_offload_stats
+(
+    struct kraken_offload_stats* stats
+)
+{
+    assert( NULL != stats && "KRAKEN: Can't read stats into nothing." );
+
+    pthread_mutex_lock( &kraken_offload.mutex );
+    *stats = kraken_offload.stats;
+    pthread_mutex_unlock( &kraken_offload.mutex );
+} // kraken_read_offload_stats
+#endif // KRAKEN_ENABLE_OFFLOAD
+
+
+/// ### kraken_channel_create
+/// Creates a channel for messages of `element_size` bytes.
+/// ```C
+/// struct kraken_channel* kraken_channel_create ( size_t   element_size,
+///                                                uint32_t capacity )
+/// ```
+/// Parameter    | Description
+/// -------------|---------------------------------------------------------------------------
+/// element_size | Size of a message in bytes
+/// capacity     | Most messages buffered before senders wait, 0 to make every send wait
+///              | for a receiver, `KRAKEN_CHANNEL_UNBOUNDED` to buffer without limit
+/// > Returns the channel or NULL if out of memory
+struct kraken_channel* kraken_channel_create
+(
+    size_t      element_size,
+    uint32_t    capacity
+)
+{
+    struct kraken_channel* channel;
+
+    assert( 0 < element_size && "KRAKEN: Can't create a channel for empty messages." );
+
+    channel = ( struct kraken_channel* )calloc( 1, sizeof( struct kraken_channel ) );
+
+    if ( NULL == channel )
+    {
+        return NULL;
+    }
+
+    channel->element_size = element_size;
+    channel->capacity     = capacity;
+    channel->slots        = KRAKEN_CHANNEL_UNBOUNDED == capacity ? 16 : capacity;
+
+    if ( 0 < channel->slots )
+    {
+        channel->buffer = ( char* )malloc( channel->slots * element_size );
+
+        if ( NULL == channel->buffer )
+        {
+            free( channel );
+            return NULL;
+        }
+    }
+
+    return channel;
+} // kraken_channel_create
+
+
+/// ### kraken_channel_destroy
+/// Frees a channel. No thread may be waiting on it.
+/// ```C
+/// void kraken_channel_destroy ( struct kraken_channel* channel )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// Does not return.
+void kraken_channel_destroy
+(
+    struct kraken_channel*  channel
+)
+{
+    assert( NULL == channel->senders && NULL == channel->receivers &&
+            "KRAKEN: Can't destroy a channel threads wait on." );
+
+    free( channel->buffer );
+    free( channel );
+} // kraken_channel_destroy
+
+
+/// ### kraken_channel_link
+/// Puts a case at the end of the senders or receivers waiting on its channel. The caller
+/// holds `channel->lock`.
+/// ```C
+/// void kraken_channel_link ( struct kraken_select_case* waiter )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// waiter      | The case
+/// Does not return.
+static void kraken_channel_link
+(
+    struct kraken_select_case*  waiter
+)
+{
+    struct kraken_channel*      channel = waiter->channel;
+    struct kraken_select_case** head    = waiter->send ? &channel->senders :
+                                                         &channel->receivers;
+    struct kraken_select_case** tail    = waiter->send ? &channel->senders_tail :
+                                                         &channel->receivers_tail;
+
+    waiter->next   = NULL;
+    waiter->prev   = *tail;
+    waiter->linked = true;
+
+    if ( NULL == *tail )
+    {
+        *head = waiter;
+    }
+    else
+    {
+        ( *tail )->next = waiter;
+    }
+
+    *tail = waiter;
+} // kraken_channel_link
+
+
+/// ### kraken_channel_unlink
+/// Takes a case off the waiter list of its channel. The caller holds `channel->lock`.
+/// ```C
+/// void kraken_channel_unlink ( struct kraken_select_case* waiter )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// waiter      | The case
+/// Does not return.
+static void kraken_channel_unlink
+(
+    struct kraken_select_case*  waiter
+)
+{
+    struct kraken_channel*      channel = waiter->channel;
+    struct kraken_select_case** head    = waiter->send ? &channel->senders :
+                                                         &channel->receivers;
+    struct kraken_select_case** tail    = waiter->send ? &channel->senders_tail :
+                                                         &channel->receivers_tail;
+
+    if ( NULL == waiter->prev )
+    {
+        *head = waiter->next;
+    }
+    else
+    {
+        waiter->prev->next = waiter->next;
+    }
+
+    if ( NULL == waiter->next )
+    {
+        *tail = waiter->prev;
+    }
+    else
+    {
+        waiter->next->prev = waiter->prev;
+    }
+
+    waiter->linked = false;
+} // kraken_channel_unlink
+
+
+/// ### kraken_channel_claim
+/// Takes the longest waiting sender or receiver of a channel whose select is still open
+/// and completes its select. Waiters whose select completed elsewhere are dropped on the
+/// way. The caller holds `channel->lock` and wakes the waiter with kraken_channel_release.
+/// ```C
+/// struct kraken_select_case* kraken_channel_claim ( struct kraken_channel* channel,
+///                                                   bool                   senders )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// senders     | Take a sender instead of a receiver
+/// > Returns the waiter or NULL if there is none
+static struct kraken_select_case* kraken_channel_claim
+(
+    struct kraken_channel*  channel,
+    bool                    senders
+)
+{
+    struct kraken_select_case* waiter;
+    uint32_t                   state;
+
+    while ( NULL != ( waiter = senders ? channel->senders : channel->receivers ) )
+    {
+        kraken_channel_unlink( waiter );
+
+        state = KRAKEN_SELECT_WAITING;
+
+        if ( __atomic_compare_exchange_n( &waiter->wait->state, &state, KRAKEN_SELECT_CLAIMED,
+                                          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            waiter->wait->index = waiter->index;
+            return waiter;
+        }
+    }
+
+    return NULL;
+} // kraken_channel_claim
+
+
+/// ### kraken_channel_release
+/// Wakes up the thread of a claimed waiter once its message was copied.
+/// ```C
+/// void kraken_channel_release ( struct kraken_select_case* waiter,
+///                               int                        result )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// waiter      | The waiter returned by kraken_channel_claim
+/// result      | `KRAKEN_CHANNEL_OK` or `KRAKEN_CHANNEL_CLOSED`
+/// Does not return.
+static void kraken_channel_release
+(
+    struct kraken_select_case*  waiter,
+    int                         result
+)
+{
+    struct kraken_select_wait* wait   = waiter->wait;
+    struct kraken_thread*      thread = wait->thread;
+
+    waiter->result = result;
+    __atomic_store_n( &wait->state, KRAKEN_SELECT_DONE, __ATOMIC_RELEASE );
+
+    if ( thread == thread->runtime->main_thread )
+    {
+        kraken_wake( thread->runtime );
+    }
+    else
+    {
+        kraken_unpark( thread );
+    }
+
+    // the waiting thread may return and drop the wait from here on
+    __atomic_store_n( &wait->released, 1, __ATOMIC_RELEASE );
+} // kraken_channel_release
+
+
+/// ### kraken_channel_push
+/// Copies a message to the end of a channel's ring, growing an unbounded ring when full.
+/// The caller holds `channel->lock`.
+/// ```C
+/// bool kraken_channel_push ( struct kraken_channel* channel,
+///                            const void*            message )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// message     | The message
+/// > Returns false if the ring is full
+static bool kraken_channel_push
+(
+    struct kraken_channel*  channel,
+    const void*             message
+)
+{
+    if ( channel->count == channel->slots )
+    {
+        char*    buffer;
+        uint32_t first;
+
+        if ( KRAKEN_CHANNEL_UNBOUNDED != channel->capacity )
+        {
+            return false;
+        }
+
+        buffer = ( char* )malloc( 2 * channel->slots * channel->element_size );
+
+        assert( NULL != buffer && "KRAKEN: Can't allocate memory for channel messages." );
+
+        // unwrap the ring into the new buffer
+        first = channel->slots - channel->head;
+        memcpy( buffer, channel->buffer + channel->head * channel->element_size,
+                first * channel->element_size );
+        memcpy( buffer + first * channel->element_size, channel->buffer,
+                channel->head * channel->element_size );
+
+        free( channel->buffer );
+        channel->buffer = buffer;
+        channel->head   = 0;
+        channel->slots *= 2;
+    }
+
+    memcpy( channel->buffer + ( ( channel->head + channel->count ) % channel->slots ) *
+                              channel->element_size,
+            message, channel->element_size );
+    channel->count++;
+
+    return true;
+} // kraken_channel_push
+
+
+/// ### kraken_channel_try
+/// Sends or receives right away if the channel allows it. The caller holds
+/// `channel->lock` and releases the waiter handed back, if any, once it let go of it.
+/// ```C
+/// int kraken_channel_try ( struct kraken_select_case*  operation,
+///                          struct kraken_select_case** woken )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// operation   | The send or receive
+/// woken       | Receives the waiter the operation completed or NULL
+/// > Returns `KRAKEN_CHANNEL_OK`, `KRAKEN_CHANNEL_CLOSED` or `KRAKEN_CHANNEL_TIMEOUT` if
+/// > the operation has to wait
+static int kraken_channel_try
+(
+    struct kraken_select_case*  operation,
+    struct kraken_select_case** woken
+)
+{
+    struct kraken_channel* channel = operation->channel;
+
+    *woken = NULL;
+
+    if ( operation->send )
+    {
+        if ( channel->closed )
+        {
+            return KRAKEN_CHANNEL_CLOSED;
+        }
+
+        // hand the message straight to a waiting receiver
+        if ( NULL != ( *woken = kraken_channel_claim( channel, false ) ) )
+        {
+            memcpy( ( *woken )->message, operation->message, channel->element_size );
+            return KRAKEN_CHANNEL_OK;
+        }
+
+        return kraken_channel_push( channel, operation->message ) ?
+               KRAKEN_CHANNEL_OK : KRAKEN_CHANNEL_TIMEOUT;
+    }
+
+    if ( 0 < channel->count )
+    {
+        memcpy( operation->message, channel->buffer + channel->head * channel->element_size,
+                channel->element_size );
+        channel->head = ( channel->head + 1 ) % channel->slots;
+        channel->count--;
+
+        // the longest waiting sender takes the freed slot
+        if ( NULL != ( *woken = kraken_channel_claim( channel, true ) ) )
+        {
+            kraken_channel_push( channel, ( *woken )->message );
+        }
+
+        return KRAKEN_CHANNEL_OK;
+    }
+
+    if ( NULL != ( *woken = kraken_channel_claim( channel, true ) ) )
+    {
+        memcpy( operation->message, ( *woken )->message, channel->element_size );
+        return KRAKEN_CHANNEL_OK;
+    }
+
+    return channel->closed ? KRAKEN_CHANNEL_CLOSED : KRAKEN_CHANNEL_TIMEOUT;
+} // kraken_channel_try
+
+
+/// ### kraken_channel_close
+/// Closes a channel. Sends fail from now on, receives fail once the buffered messages
+/// are taken. Threads waiting on the channel wake up with `KRAKEN_CHANNEL_CLOSED`.
+/// ```C
+/// void kraken_channel_close ( struct kraken_channel* channel )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// Does not return.
+void kraken_channel_close
+(
+    struct kraken_channel*  channel
+)
+{
+    struct kraken_select_case* woken = NULL;
+    struct kraken_select_case* waiter;
+
+    kraken_lock( &channel->lock );
+
+    channel->closed = true;
+
+    // waiting receivers mean an empty ring, so every waiter fails
+    while ( NULL != ( waiter = kraken_channel_claim( channel, false ) ) ||
+            NULL != ( waiter = kraken_channel_claim( channel, true ) ) )
+    {
+        waiter->next = woken;
+        woken        = waiter;
+    }
+
+    kraken_unlock( &channel->lock );
+
+    while ( NULL != ( waiter = woken ) )
+    {
+        woken = waiter->next;
+        kraken_channel_release( waiter, KRAKEN_CHANNEL_CLOSED );
+    }
+} // kraken_channel_close
+
+
+/// ### kraken_select_lock
+/// Locks the channels of a select in address order, so selects over the same channels
+/// on different runtimes of a pool don't deadlock.
+/// ```C
+/// uint32_t kraken_select_lock ( struct kraken_select_case* cases,
+///                               uint32_t                   count,
+///                               struct kraken_channel**    channels )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// cases       | The cases
+/// count       | Number of cases
+/// channels    | Receives the distinct channels in the order they were locked
+/// > Returns the number of distinct channels
+static uint32_t kraken_select_lock
+(
+    struct kraken_select_case*  cases,
+    uint32_t                    count,
+    struct kraken_channel**     channels
+)
+{
+    struct kraken_channel* channel;
+    uint32_t               unique = 0;
+    uint32_t               i;
+    uint32_t               j;
+
+    for ( i = 0; i < count; i++ )
+    {
+        channel = cases[ i ].channel;
+
+        for ( j = unique; 0 < j && channels[ j - 1 ] > channel; j-- )
+        {
+            channels[ j ] = channels[ j - 1 ];
+        }
+
+        if ( 0 < j && channels[ j - 1 ] == channel )
+        {
+            // already there, close the gap again
+            for ( ; j < unique; j++ )
+            {
+                channels[ j ] = channels[ j + 1 ];
+            }
+
+            continue;
+        }
+
+        channels[ j ] = channel;
+        unique++;
+    }
+
+    for ( i = 0; i < unique; i++ )
+    {
+        kraken_lock( &channels[ i ]->lock );
+    }
+
+    return unique;
+} // kraken_select_lock
+
+
+/// ### kraken_select
+/// Waits until one of several sends and receives can complete and completes it. Cases are
+/// tried in order, so earlier cases win when several are ready. Threads on the shared
+/// stack can only select with a deadline of 0.
+/// ```C
+/// int kraken_select ( struct kraken_runtime*     runtime,
+///                     struct kraken_select_case* cases,
+///                     uint32_t                   count,
+///                     uint64_t                   deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`, unused with a deadline of 0
+/// cases       | Up to `KRAKEN_SELECT_CASES` cases. `result` of the completed case is set.
+/// count       | Number of cases
+/// deadline    | Monotonic clock time to give up at, 0 to not wait at all and UINT64_MAX
+///             | to wait for as long as it takes
+/// > Returns the position of the completed case or -1 if the deadline passed
+int kraken_select
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_select_case*  cases,
+    uint32_t                    count,
+    uint64_t                    deadline
+)
+{
+    struct kraken_channel*     channels[ KRAKEN_SELECT_CASES ];
+    struct kraken_select_case* woken = NULL;
+    struct kraken_select_wait  wait;
+    struct kraken_thread*      current_thread;
+    uint32_t                   unique;
+    uint32_t                   state;
+    uint32_t                   i;
+    int                        result = KRAKEN_CHANNEL_TIMEOUT;
+
+    assert( 0 < count && KRAKEN_SELECT_CASES >= count && "KRAKEN: Too many select cases." );
+
+    unique = kraken_select_lock( cases, count, channels );
+
+    for ( i = 0; i < count && KRAKEN_CHANNEL_TIMEOUT == result; i++ )
+    {
+        result = kraken_channel_try( &cases[ i ], &woken );
+    }
+
+    if ( KRAKEN_CHANNEL_TIMEOUT != result || 0 == deadline || kraken_now() >= deadline )
+    {
+        while ( 0 < unique )
+        {
+            kraken_unlock( &channels[ --unique ]->lock );
+        }
+
+        if ( NULL != woken )
+        {
+            kraken_channel_release( woken, KRAKEN_CHANNEL_OK );
+        }
+
+        if ( KRAKEN_CHANNEL_TIMEOUT == result )
+        {
+            return -1;
+        }
+
+        cases[ i - 1 ].result = result;
+
+        return ( int )i - 1;
+    }
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+
+    // whoever completes a case copies in or out of its message while this thread is away
+    assert( !current_thread->shared_stack &&
+            "KRAKEN: Threads on the shared stack can't wait on channels." );
+
+    wait.state    = KRAKEN_SELECT_WAITING;
+    wait.released = 0;
+    wait.index    = 0;
+    wait.thread   = current_thread;
+
+    for ( i = 0; i < count; i++ )
+    {
+        cases[ i ].wait  = &wait;
+        cases[ i ].index = i;
+        kraken_channel_link( &cases[ i ] );
+    }
+
+    while ( 0 < unique )
+    {
+        kraken_unlock( &channels[ --unique ]->lock );
+    }
+
+    while ( 0 == __atomic_load_n( &wait.released, __ATOMIC_ACQUIRE ) )
+    {
+        state = __atomic_load_n( &wait.state, __ATOMIC_ACQUIRE );
+
+        if ( KRAKEN_SELECT_WAITING != state )
+        {
+            // claimed, the claimer is about to wake this thread up
+            kraken_yield( runtime );
+        }
+        else if ( kraken_now() >= deadline )
+        {
+            if ( __atomic_compare_exchange_n( &wait.state, &state, KRAKEN_SELECT_TIMEOUT, false,
+                                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+            {
+                break;
+            }
+        }
+        else if ( current_thread == runtime->main_thread )
+        {
+            if ( !kraken_yield( runtime ) )
+            {
+                kraken_idle( runtime, deadline );
+            }
+        }
+        else if ( UINT64_MAX == deadline )
+        {
+            kraken_park( runtime );
+        }
+        else
+        {
+            kraken_park_until( runtime, deadline );
+        }
+
+        runtime = kraken_local( runtime );
+    }
+
+    // take the cases nobody claimed off their channels again
+    for ( i = 0; i < count; i++ )
+    {
+        kraken_lock( &cases[ i ].channel->lock );
+
+        if ( cases[ i ].linked )
+        {
+            kraken_channel_unlink( &cases[ i ] );
+        }
+
+        kraken_unlock( &cases[ i ].channel->lock );
+    }
+
+    return KRAKEN_SELECT_TIMEOUT == wait.state ? -1 : ( int )wait.index;
+} // kraken_select
+
+
+/// ### kraken_channel_send_until
+/// Sends a message, waiting at most until `deadline` for a receiver or a free slot.
+/// ```C
+/// int kraken_channel_send_until ( struct kraken_runtime* runtime,
+///                                 struct kraken_channel* channel,
+///                                 const void*            message,
+///                                 uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// channel     | The channel
+/// message     | `element_size` bytes to send
+/// deadline    | Monotonic clock time to give up at (see kraken_select)
+/// > Returns `KRAKEN_CHANNEL_OK`, `KRAKEN_CHANNEL_CLOSED` or `KRAKEN_CHANNEL_TIMEOUT`
+int kraken_channel_send_until
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_channel*  channel,
+    const void*             message,
+    uint64_t                deadline
+)
+{
+    struct kraken_select_case operation;
+
+    operation.channel = channel;
+    operation.message = ( void* )message;
+    operation.send    = true;
+
+    return 0 == kraken_select( runtime, &operation, 1, deadline ) ?
+           operation.result : KRAKEN_CHANNEL_TIMEOUT;
+} // kraken_channel_send_until
+
+
+/// ### kraken_channel_recv_until
+/// Receives a message, waiting at most until `deadline` for one.
+/// ```C
+/// int kraken_channel_recv_until ( struct kraken_runtime* runtime,
+///                                 struct kraken_channel* channel,
+///                                 void*                  message,
+///                                 uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// channel     | The channel
+/// message     | Room for `element_size` bytes
+/// deadline    | Monotonic clock time to give up at (see kraken_select)
+/// > Returns `KRAKEN_CHANNEL_OK`, `KRAKEN_CHANNEL_CLOSED` or `KRAKEN_CHANNEL_TIMEOUT`
+int kraken_channel_recv_until
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_channel*  channel,
+    void*                   message,
+    uint64_t                deadline
+)
+{
+    struct kraken_select_case operation;
+
+    operation.channel = channel;
+    operation.message = message;
+    operation.send    = false;
+
+    return 0 == kraken_select( runtime, &operation, 1, deadline ) ?
+           operation.result : KRAKEN_CHANNEL_TIMEOUT;
+} // kraken_channel_recv_until
+
+
+/// ### kraken_channel_send
+/// Sends a message, waiting for a receiver or a free slot as long as it takes.
+/// ```C
+/// int kraken_channel_send ( struct kraken_runtime* runtime,
+///                           struct kraken_channel* channel,
+///                           const void*            message )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// channel     | The channel
+/// message     | `element_size` bytes to send
+/// > Returns `KRAKEN_CHANNEL_OK` or `KRAKEN_CHANNEL_CLOSED`
+int kraken_channel_send
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_channel*  channel,
+    const void*             message
+)
+{
+    return kraken_channel_send_until( runtime, channel, message, UINT64_MAX );
+} // kraken_channel_send
+
+
+/// ### kraken_channel_recv
+/// Receives a message, waiting for one as long as it takes.
+/// ```C
+/// int kraken_channel_recv ( struct kraken_runtime* runtime,
+///                           struct kraken_channel* channel,
+///                           void*                  message )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// channel     | The channel
+/// message     | Room for `element_size` bytes
+/// > Returns `KRAKEN_CHANNEL_OK` or `KRAKEN_CHANNEL_CLOSED`
+int kraken_channel_recv
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_channel*  channel,
+    void*                   message
+)
+{
+    return kraken_channel_recv_until( runtime, channel, message, UINT64_MAX );
+} // kraken_channel_recv
+
+
+/// ### kraken_channel_try_send
+/// Sends a message if a receiver waits or a slot is free.
+/// ```C
+/// int kraken_channel_try_send ( struct kraken_channel* channel,
+///                               const void*            message )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// message     | `element_size` bytes to send
+/// > Returns `KRAKEN_CHANNEL_OK`, `KRAKEN_CHANNEL_CLOSED` or `KRAKEN_CHANNEL_TIMEOUT` if
+/// > the send would wait
+int kraken_channel_try_send
+(
+    struct kraken_channel*  channel,
+    const void*             message
+)
+{
+    return kraken_channel_send_until( NULL, channel, message, 0 );
+} // kraken_channel_try_send
+
+
+/// ### kraken_channel_try_recv
+/// Receives a message if one is buffered or a sender waits.
+/// ```C
+/// int kraken_channel_try_recv ( struct kraken_channel* channel,
+///                               void*                  message )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// channel     | The channel
+/// message     | Room for `element_size` bytes
+/// > Returns `KRAKEN_CHANNEL_OK`, `KRAKEN_CHANNEL_CLOSED` or `KRAKEN_CHANNEL_TIMEOUT` if
+/// > the receive would wait
+int kraken_channel_try_recv
+(
+    struct kraken_channel*  channel,
+    void*                   message
+)
+{
+    return kraken_channel_recv_until( NULL, channel, message, 0 );
+} // kraken_channel_try_recv
+
+
+/// ### kraken_waiters_push
+/// Puts the current thread at the end of a wait list. The caller holds the lock of the
+/// primitive the list belongs to and waits with kraken_waiters_wait once it let go of it.
+/// ```C
+/// void kraken_waiters_push ( struct kraken_wait_list* list,
+///                            struct kraken_thread*    thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// list        | The wait list
+/// thread      | The current thread
+/// Does not return.
+static void kraken_waiters_push
+(
+    struct kraken_wait_list*    list,
+    struct kraken_thread*       thread
+)
+{
+    thread->waiter_state = KRAKEN_WAITER_WAITING;
+    thread->waiter_next  = NULL;
+    thread->waiter_prev  = list->tail;
+
+    if ( NULL == list->tail )
+    {
+        list->head = thread;
+    }
+    else
+    {
+        list->tail->waiter_next = thread;
+    }
+
+    list->tail = thread;
+} // kraken_waiters_push
+
+
+/// ### kraken_waiters_remove
+/// Takes a thread off a wait list. The caller holds the lock of the primitive.
+/// ```C
+/// void kraken_waiters_remove ( struct kraken_wait_list* list,
+///                              struct kraken_thread*    thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// list        | The wait list
+/// thread      | A thread on the list
+/// Does not return.
+static void kraken_waiters_remove
+(
+    struct kraken_wait_list*    list,
+    struct kraken_thread*       thread
+)
+{
+    if ( NULL == thread->waiter_prev )
+    {
+        list->head = thread->waiter_next;
+    }
+    else
+    {
+        thread->waiter_prev->waiter_next = thread->waiter_next;
+    }
+
+    if ( NULL == thread->waiter_next )
+    {
+        list->tail = thread->waiter_prev;
+    }
+    else
+    {
+        thread->waiter_next->waiter_prev = thread->waiter_prev;
+    }
+} // kraken_waiters_remove
+
+
+/// ### kraken_waiters_pop
+/// Takes the longest waiting thread off a wait list and marks it as served. The caller
+/// holds the lock of the primitive and wakes the thread with kraken_waiters_grant once it
+/// let go of it.
+/// ```C
+/// struct kraken_thread* kraken_waiters_pop ( struct kraken_wait_list* list )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// list        | The wait list
+/// > Returns the thread or NULL if none waits
+static struct kraken_thread* kraken_waiters_pop
+(
+    struct kraken_wait_list*    list
+)
+{
+    struct kraken_thread* thread = list->head;
+
+    if ( NULL != thread )
+    {
+        kraken_waiters_remove( list, thread );
+        __atomic_store_n( &thread->waiter_state, KRAKEN_WAITER_CLAIMED, __ATOMIC_RELAXED );
+    }
+
+    return thread;
+} // kraken_waiters_pop
+
+
+/// ### kraken_waiters_grant
+/// Wakes up a thread taken off a wait list with kraken_waiters_pop.
+/// ```C
+/// void kraken_waiters_grant ( struct kraken_thread* thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The thread
+/// Does not return.
+static void kraken_waiters_grant
+(
+    struct kraken_thread*   thread
+)
+{
+    if ( thread == thread->runtime->main_thread )
+    {
+        kraken_wake( thread->runtime );
+    }
+    else
+    {
+        kraken_unpark( thread );
+    }
+
+    // the thread may return and wait on something else from here on
+    __atomic_store_n( &thread->waiter_state, KRAKEN_WAITER_GRANTED, __ATOMIC_RELEASE );
+} // kraken_waiters_grant
+
+
+/// ### kraken_waiters_wait
+/// Blocks the current thread, put on a wait list with kraken_waiters_push, until it is
+/// granted what it waits for or `deadline` passes.
+/// ```C
+/// bool kraken_waiters_wait ( struct kraken_runtime*   runtime,
+///                            kraken_spinlock*         lock,
+///                            struct kraken_wait_list* list,
+///                            uint64_t                 deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// lock        | Lock of the primitive the list belongs to
+/// list        | The wait list
+/// deadline    | Monotonic clock time to give up at, UINT64_MAX for none
+/// > Returns false if the deadline passed first
+static bool kraken_waiters_wait
+(
+    struct kraken_runtime*      runtime,
+    kraken_spinlock*            lock,
+    struct kraken_wait_list*    list,
+    uint64_t                    deadline
+)
+{
+    struct kraken_thread* current_thread = kraken_local( runtime )->current_thread;
+    uint32_t              state;
+
+    while ( KRAKEN_WAITER_GRANTED !=
+            ( state = __atomic_load_n( &current_thread->waiter_state, __ATOMIC_ACQUIRE ) ) )
+    {
+        runtime = kraken_local( runtime );
+
+        if ( KRAKEN_WAITER_CLAIMED == state )
+        {
+            // served, the waker is about to wake this thread up
+            kraken_yield( runtime );
+        }
+        else if ( kraken_now() >= deadline )
+        {
+            kraken_lock( lock );
+
+            if ( KRAKEN_WAITER_WAITING == current_thread->waiter_state )
+            {
+                kraken_waiters_remove( list, current_thread );
+                kraken_unlock( lock );
+
+                return false;
+            }
+
+            kraken_unlock( lock );
+        }
+        else if ( current_thread == runtime->main_thread )
+        {
+            if ( !kraken_yield( runtime ) )
+            {
+                kraken_idle( runtime, deadline );
+            }
+        }
+        else if ( UINT64_MAX == deadline )
+        {
+            kraken_park( runtime );
+        }
+        else
+        {
+            kraken_park_until( runtime, deadline );
+        }
+    }
+
+    return true;
+} // kraken_waiters_wait
+
+
+/// ### kraken_mutex_lock_until
+/// Locks a mutex, parking until the owner hands it over or `deadline` passes. Waiters get
+/// the mutex in the order they asked for it.
+/// ```C
+/// bool kraken_mutex_lock_until ( struct kraken_runtime* runtime,
+///                                struct kraken_mutex*   mutex,
+///                                uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// mutex       | The mutex
+/// deadline    | Monotonic clock time to give up at, 0 to not wait and UINT64_MAX for none
+/// > Returns true if the current thread holds the mutex now
+bool kraken_mutex_lock_until
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_mutex*    mutex,
+    uint64_t                deadline
+)
+{
+    struct kraken_thread* current_thread = kraken_local( runtime )->current_thread;
+
+    kraken_lock( &mutex->lock );
+
+    assert( mutex->owner != current_thread && "KRAKEN: The mutex is held by this thread." );
+
+    if ( NULL == mutex->owner )
+    {
+        mutex->owner = current_thread;
+        kraken_unlock( &mutex->lock );
+
+        return true;
+    }
+
+    if ( 0 == deadline )
+    {
+        kraken_unlock( &mutex->lock );
+
+        return false;
+    }
+
+    kraken_waiters_push( &mutex->waiters, current_thread );
+    kraken_unlock( &mutex->lock );
+
+    // kraken_mutex_unlock made this thread the owner before waking it up
+    return kraken_waiters_wait( runtime, &mutex->lock, &mutex->waiters, deadline );
+} // kraken_mutex_lock_until
+
+
+/// ### kraken_mutex_lock
+/// Locks a mutex, parking until the owner hands it over.
+/// ```C
+/// void kraken_mutex_lock ( struct kraken_runtime* runtime,
+///                          struct kraken_mutex*   mutex )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// mutex       | The mutex
+/// Does not return.
+void kraken_mutex_lock
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_mutex*    mutex
+)
+{
+    kraken_mutex_lock_until( runtime, mutex, UINT64_MAX );
+} // kraken_mutex_lock
+
+
+/// ### kraken_mutex_try_lock
+/// Locks a mutex if nobody holds it.
+/// ```C
+/// bool kraken_mutex_try_lock ( struct kraken_runtime* runtime,
+///                              struct kraken_mutex*   mutex )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// mutex       | The mutex
+/// > Returns true if the current thread holds the mutex now
+bool kraken_mutex_try_lock
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_mutex*    mutex
+)
+{
+    return kraken_mutex_lock_until( runtime, mutex, 0 );
+} // kraken_mutex_try_lock
+
+
+/// ### kraken_mutex_unlock
+/// Unlocks a mutex held by the current thread. The longest waiting thread becomes the
+/// owner and is made READY, so a contended mutex costs its waiters no switches before.
+/// ```C
+/// void kraken_mutex_unlock ( struct kraken_runtime* runtime,
+///                            struct kraken_mutex*   mutex )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// mutex       | The mutex
+/// Does not return.
+void kraken_mutex_unlock
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_mutex*    mutex
+)
+{
+    struct kraken_thread* waiter;
+
+    kraken_lock( &mutex->lock );
+
+    assert( mutex->owner == kraken_local( runtime )->current_thread &&
+            "KRAKEN: The mutex is not held by this thread." );
+    ( void )runtime;
+
+    waiter       = kraken_waiters_pop( &mutex->waiters );
+    mutex->owner = waiter;
+
+    kraken_unlock( &mutex->lock );
+
+    if ( NULL != waiter )
+    {
+        kraken_waiters_grant( waiter );
+    }
+} // kraken_mutex_unlock
+
+
+/// ### kraken_cond_wait_until
+/// Unlocks a mutex and waits for a signal on a condition variable or `deadline`, then
+/// locks the mutex again. Like with pthreads the condition has to be checked in a loop.
+/// ```C
+/// bool kraken_cond_wait_until ( struct kraken_runtime* runtime,
+///                               struct kraken_cond*    cond,
+///                               struct kraken_mutex*   mutex,
+///                               uint64_t               deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// cond        | The condition variable
+/// mutex       | The mutex, held by the current thread
+/// deadline    | Monotonic clock time to give up at, UINT64_MAX for none
+/// > Returns false if the deadline passed before a signal
+bool kraken_cond_wait_until
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_cond*     cond,
+    struct kraken_mutex*    mutex,
+    uint64_t                deadline
+)
+{
+    bool signalled;
+
+    // queue up before letting go of the mutex, so no signal gets lost in between
+    kraken_lock( &cond->lock );
+    kraken_waiters_push( &cond->waiters, kraken_local( runtime )->current_thread );
+    kraken_unlock( &cond->lock );
+
+    kraken_mutex_unlock( runtime, mutex );
+
+    signalled = kraken_waiters_wait( runtime, &cond->lock, &cond->waiters, deadline );
+
+    kraken_mutex_lock( runtime, mutex );
+
+    return signalled;
+} // kraken_cond_wait_until
+
+
+/// ### kraken_cond_wait
+/// Unlocks a mutex and waits for a signal on a condition variable, then locks the mutex
+/// again (see kraken_cond_wait_until).
+/// ```C
+/// void kraken_cond_wait ( struct kraken_runtime* runtime,
+///                         struct kraken_cond*    cond,
+///                         struct kraken_mutex*   mutex )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// cond        | The condition variable
+/// mutex       | The mutex, held by the current thread
+/// Does not return.
+void kraken_cond_wait
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_cond*     cond,
+    struct kraken_mutex*    mutex
+)
+{
+    kraken_cond_wait_until( runtime, cond, mutex, UINT64_MAX );
+} // kraken_cond_wait
+
+
+/// ### kraken_cond_signal
+/// Wakes up the thread waiting the longest on a condition variable, if any.
+/// ```C
+/// void kraken_cond_signal ( struct kraken_cond* cond )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// cond        | The condition variable
+/// Does not return.
+void kraken_cond_signal
+(
+    struct kraken_cond*     cond
+)
+{
+    struct kraken_thread* waiter;
+
+    kraken_lock( &cond->lock );
+    waiter = kraken_waiters_pop( &cond->waiters );
+    kraken_unlock( &cond->lock );
+
+    if ( NULL != waiter )
+    {
+        kraken_waiters_grant( waiter );
+    }
+} // kraken_cond_signal
+
+
+/// ### kraken_cond_broadcast
+/// Wakes up every thread waiting on a condition variable.
+/// ```C
+/// void kraken_cond_broadcast ( struct kraken_cond* cond )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// cond        | The condition variable
+/// Does not return.
+void kraken_cond_broadcast
+(
+    struct kraken_cond*     cond
+)
+{
+    struct kraken_thread* woken = NULL;
+    struct kraken_thread* waiter;
+
+    kraken_lock( &cond->lock );
+
+    while ( NULL != ( waiter = kraken_waiters_pop( &cond->waiters ) ) )
+    {
+        waiter->waiter_next = woken;
+        woken               = waiter;
+    }
+
+    kraken_unlock( &cond->lock );
+
+    while ( NULL != ( waiter = woken ) )
+    {
+        woken = waiter->waiter_next;
+        kraken_waiters_grant( waiter );
+    }
+} // kraken_cond_broadcast
+
+
+/// ### kraken_semaphore_init
+/// Sets up a semaphore.
+/// ```C
+/// void kraken_semaphore_init ( struct kraken_semaphore* semaphore,
+///                              uint32_t                 count )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// semaphore   | The semaphore
+/// count       | Units available at first
+/// Does not return.
+void kraken_semaphore_init
+(
+    struct kraken_semaphore*    semaphore,
+    uint32_t                    count
+)
+{
+    memset( semaphore, 0, sizeof( struct kraken_semaphore ) );
+    semaphore->count = count;
+} // kraken_semaphore_init
+
+
+/// ### kraken_semaphore_acquire_until
+/// Takes a unit of a semaphore, parking until one is released to the current thread or
+/// `deadline` passes.
+/// ```C
+/// bool kraken_semaphore_acquire_until ( struct kraken_runtime*   runtime,
+///                                       struct kraken_semaphore* semaphore,
+///                                       uint64_t                 deadline )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// semaphore   | The semaphore
+/// deadline    | Monotonic clock time to give up at, 0 to not wait and UINT64_MAX for none
+/// > Returns true if the current thread got a unit
+bool kraken_semaphore_acquire_until
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_semaphore*    semaphore,
+    uint64_t                    deadline
+)
+{
+    kraken_lock( &semaphore->lock );
+
+    if ( 0 < semaphore->count )
+    {
+        semaphore->count--;
+        kraken_unlock( &semaphore->lock );
+
+        return true;
+    }
+
+    if ( 0 == deadline )
+    {
+        kraken_unlock( &semaphore->lock );
+
+        return false;
+    }
+
+    kraken_waiters_push( &semaphore->waiters, kraken_local( runtime )->current_thread );
+    kraken_unlock( &semaphore->lock );
+
+    // kraken_semaphore_release hands the unit over before waking this thread up
+    return kraken_waiters_wait( runtime, &semaphore->lock, &semaphore->waiters, deadline );
+} // kraken_semaphore_acquire_until
+
+
+/// ### kraken_semaphore_acquire
+/// Takes a unit of a semaphore, parking until one is released to the current thread.
+/// ```C
+/// void kraken_semaphore_acquire ( struct kraken_runtime*   runtime,
+///                                 struct kraken_semaphore* semaphore )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// semaphore   | The semaphore
+/// Does not return.
+void kraken_semaphore_acquire
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_semaphore*    semaphore
+)
+{
+    kraken_semaphore_acquire_until( runtime, semaphore, UINT64_MAX );
+} // kraken_semaphore_acquire
+
+
+/// ### kraken_semaphore_release
+/// Gives a unit back to a semaphore, straight to the thread waiting the longest if any.
+/// ```C
+/// void kraken_semaphore_release ( struct kraken_semaphore* semaphore )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// semaphore   | The semaphore
+/// Does not return.
+void kraken_semaphore_release
+(
+    struct kraken_semaphore*    semaphore
+)
+{
+    struct kraken_thread* waiter;
+
+    kraken_lock( &semaphore->lock );
+
+    if ( NULL == ( waiter = kraken_waiters_pop( &semaphore->waiters ) ) )
+    {
+        semaphore->count++;
+    }
+
+    kraken_unlock( &semaphore->lock );
+
+    if ( NULL != waiter )
+    {
+        kraken_waiters_grant( waiter );
+    }
+} // kraken_semaphore_release
+
+
+/// ### kraken_wait_group_add
+/// Adds to or, with a negative `delta`, takes from the outstanding work of a wait group.
+/// Wakes up the waiting threads once nothing is outstanding.
+/// ```C
+/// void kraken_wait_group_add ( struct kraken_wait_group* group,
+///                              int64_t                   delta )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// group       | The wait group
+/// delta       | Work started, or finished if negative
+/// Does not return.
+void kraken_wait_group_add
+(
+    struct kraken_wait_group*   group,
+    int64_t                     delta
+)
+{
+    struct kraken_thread* woken = NULL;
+    struct kraken_thread* waiter;
+
+    kraken_lock( &group->lock );
+
+    group->count += delta;
+
+    assert( 0 <= group->count && "KRAKEN: More work done than added to the wait group." );
+
+    while ( 0 == group->count && NULL != ( waiter = kraken_waiters_pop( &group->waiters ) ) )
+    {
+        waiter->waiter_next = woken;
+        woken               = waiter;
+    }
+
+    kraken_unlock( &group->lock );
+
+    while ( NULL != ( waiter = woken ) )
+    {
+        woken = waiter->waiter_next;
+        kraken_waiters_grant( waiter );
+    }
+} // kraken_wait_group_add
+
+
+/// ### kraken_wait_group_done
+/// Takes one unit of work from a wait group (see kraken_wait_group_add).
+/// ```C
+/// void kraken_wait_group_done ( struct kraken_wait_group* group )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// group       | The wait group
+/// Does not return.
+void kraken_wait_group_done
+(
+    struct kraken_wait_group*   group
+)
+{
+    kraken_wait_group_add( group, -1 );
+} // kraken_wait_group_done
+
+
+/// ### kraken_wait_group_wait
+/// Parks the current thread until nothing is outstanding in a wait group.
+/// ```C
+/// void kraken_wait_group_wait ( struct kraken_runtime*    runtime,
+///                               struct kraken_wait_group* group )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// group       | The wait group
+/// Does not return.
+void kraken_wait_group_wait
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_wait_group*   group
+)
+{
+    kraken_lock( &group->lock );
+
+    if ( 0 == group->count )
+    {
+        kraken_unlock( &group->lock );
+        return;
+    }
+
+    kraken_waiters_push( &group->waiters, kraken_local( runtime )->current_thread );
+    kraken_unlock( &group->lock );
+
+    kraken_waiters_wait( runtime, &group->lock, &group->waiters, UINT64_MAX );
+} // kraken_wait_group_wait
+
+
+/// ### kraken_start_thread
+/// Creates a thread with default options and appends it to the run queue of a runtime.
+/// ```C
+/// int kraken_start_thread ( struct kraken_runtime* runtime,
+///                           function_type          thread_func )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread_func | The function the thread runs
+/// > Returns 0 on success and -1 if there is no free slot or stack memory
+int kraken_start_thread
+(
+    struct kraken_runtime*  runtime,
+    function_type           thread_func
+)
+{
+    return kraken_start_thread_ex( runtime, thread_func, NULL );
+} // kraken_start_thread
+
+
+/// ### kraken_prepare_thread
+/// Fills in a slot taken off the free list and sets up its first frame so that switching
+/// to it enters kraken_guard. A private stack is allocated unless the slot already has one.
+/// ```C
+/// bool kraken_prepare_thread ( struct kraken_runtime*              runtime,
+///                              struct kraken_thread*               thread,
+///                              function_type                       thread_func,
+///                              const struct kraken_thread_options* options )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The slot
+/// thread_func | The function the thread runs
+/// options     | Thread settings or NULL for the defaults
+/// > Returns false if there is no stack memory
+static bool kraken_prepare_thread
+(
+    struct kraken_runtime*              runtime,
+    struct kraken_thread*               thread,
+    function_type                       thread_func,
+    const struct kraken_thread_options* options
+)
+{
+    char* stack_top;
+
+    assert( NULL == options || KRAKEN_PRIORITY_LEVELS > options->priority );
+    assert( NULL == options || 0 == options->stack_size || 64 <= options->stack_size );
+
+    thread->status       = READY;
+    thread->shared_stack = NULL != options && options->shared_stack;
+    thread->stack_peak   = 0;
+    thread->park_state   = KRAKEN_PARK_EMPTY;
+    thread->reclaim_end  = NULL;
+    thread->stack_size   = NULL == options || 0 == options->stack_size ?
+                           KRAKEN_STACK_SIZE : ( options->stack_size + 15 ) & ~15u;
+    thread->function     = thread_func;
+    thread->runtime      = runtime;
+    thread->priority     = NULL == options ? KRAKEN_PRIORITY_DEFAULT : options->priority;
+
+    memset( &thread->stats, 0, sizeof( thread->stats ) );
+#if KRAKEN_ENABLE_STATS
+    thread->ready_since  = kraken_now();
+#endif // KRAKEN_ENABLE_STATS
+
+    kraken_trace( runtime, KRAKEN_TRACE_SPAWN, thread, NULL );
+
+    if ( thread->shared_stack )
+    {
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+        if ( !kraken_shared_stack_prepare( runtime, thread ) )
+        {
+            thread->shared_stack = false;
+
+            return false;
+        }
+#else
+        assert( false && "KRAKEN: Shared stacks need x86_64." );
+#endif // KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+
+        return true;
+    }
+
+    if ( NULL == thread->stack )
+    {
+        thread->stack = kraken_stack_allocate( runtime, thread->stack_size );
+
+        if ( NULL == thread->stack )
+        {
+            return false;
+        }
+    }
+
+#if KRAKEN_ENABLE_STACK_WATERMARK
+    memset( thread->stack, ( uint8_t )KRAKEN_STACK_PATTERN, thread->stack_size );
+#endif // KRAKEN_ENABLE_STACK_WATERMARK
+
+    stack_top = thread->stack + thread->stack_size;
+
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    // kraken_switch returns into kraken_guard. The zero above it stands in for a return
+    // address so kraken_guard starts with the stack alignment of a called function.
+    *( uint64_t* )( stack_top -  8 ) = ( uint64_t )0;
+    *( uint64_t* )( stack_top - 16 ) = ( uint64_t )kraken_guard;
+
+    thread->context.rsp = ( uint64_t )( stack_top - 16 );
+    thread->context.rbp = 0;
+
+#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
+    *( uint32_t* )( stack_top -  4 ) = ( uint32_t )runtime;
+    *( uint32_t* )( stack_top -  8 ) = ( uint32_t )0;
+    *( uint32_t* )( stack_top - 12 ) = ( uint32_t )kraken_guard;
+
+    thread->context.esp = ( uint32_t )( stack_top - 12 );
+
+#endif
+
+    return true;
+} // kraken_prepare_thread
+
+
+/// ### kraken_create_thread
+/// Takes a slot off the free list and prepares it. The thread is not queued yet.
+/// ```C
+/// struct kraken_thread* kraken_create_thread ( struct kraken_runtime*              runtime,
+///                                              function_type                       thread_func,
+///                                              const struct kraken_thread_options* options )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread_func | The function the thread runs
+/// options     | Thread settings or NULL for the defaults
+/// > Returns the thread or NULL if there is no free slot or stack memory
+static struct kraken_thread* kraken_create_thread
+(
+    struct kraken_runtime*              runtime,
+    function_type                       thread_func,
+    const struct kraken_thread_options* options
+)
+{
+    struct kraken_thread* new_thread = NULL;
+
+    kraken_lock( &runtime->lock );
+    new_thread = kraken_allocate_thread( runtime );
+    kraken_unlock( &runtime->lock );
+
+    if ( NULL == new_thread )
+    {
+        return NULL;
+    }
+
+    if ( !kraken_prepare_thread( runtime, new_thread, thread_func, options ) )
+    {
+        kraken_release_thread( new_thread );
+
+        return NULL;
+    }
+
+    return new_thread;
+} // kraken_create_thread
+
+
+/// ### kraken_launch_thread
+/// Appends a thread made with kraken_create_thread to the run queue of a runtime.
+/// ```C
+/// void kraken_launch_thread ( struct kraken_runtime* runtime,
+///                             struct kraken_thread*  thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The thread
+/// Does not return.
+static void kraken_launch_thread
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+#if KRAKEN_ENABLE_POOL
+    if ( NULL != runtime->pool )
+    {
+        __atomic_add_fetch( &runtime->pool->live_threads, 1, __ATOMIC_RELEASE );
+    }
+#endif // KRAKEN_ENABLE_POOL
+
+    kraken_lock( &runtime->lock );
+    kraken_queue_push( runtime, thread );
+    kraken_unlock( &runtime->lock );
+
+    kraken_wake( runtime );
+} // kraken_launch_thread
+
+
+/// ### kraken_start_thread_ex
+/// Creates a thread and appends it to the run queue of a runtime.
+/// ```C
+/// int kraken_start_thread_ex ( struct kraken_runtime*              runtime,
+///                              function_type                       thread_func,
+///                              const struct kraken_thread_options* options )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread_func | The function the thread runs
+/// options     | Thread settings or NULL for the defaults
+/// > Returns 0 on success and -1 if there is no free slot or stack memory
+int kraken_start_thread_ex
+(
+    struct kraken_runtime*              runtime,
+    function_type                       thread_func,
+    const struct kraken_thread_options* options
+)
+{
+    struct kraken_thread* new_thread = kraken_create_thread( runtime, thread_func, options );
+
+    if ( NULL == new_thread )
+    {
+        return -1;
+    }
+
+    kraken_launch_thread( runtime, new_thread );
+
+    return 0;
+} // kraken_start_thread_ex
+
+
+/// ### kraken_spawn
+/// Creates a thread that runs `routine` with `argument` and appends it to the run queue of
+/// a runtime. The thread's stack goes back to the stack cache as soon as it stops, its slot
+/// and the value `routine` returned stay until kraken_join or kraken_detach is called with
+/// the handle.
+/// ```C
+/// struct kraken_thread* kraken_spawn ( struct kraken_runtime*              runtime,
+///                                      kraken_routine_type                 routine,
+///                                      void*                               argument,
+///                                      const struct kraken_thread_options* options )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// routine     | The function the thread runs
+/// argument    | Passed to `routine`
+/// options     | Thread settings or NULL for the defaults
+/// > Returns the handle of the thread or NULL if there is no free slot or stack memory
+struct kraken_thread* kraken_spawn
+(
+    struct kraken_runtime*              runtime,
+    kraken_routine_type                 routine,
+    void*                               argument,
+    const struct kraken_thread_options* options
+)
+{
+    struct kraken_thread* new_thread;
+
+    assert( NULL != routine );
+
+    // kraken_guard calls the routine instead of a start function
+    new_thread = kraken_create_thread( runtime, NULL, options );
+
+    if ( NULL == new_thread )
+    {
+        return NULL;
+    }
+
+    new_thread->routine  = routine;
+    new_thread->argument = argument;
+    new_thread->result   = NULL;
+    new_thread->joinable = true;
+
+    kraken_launch_thread( runtime, new_thread );
+
+    return new_thread;
+} // kraken_spawn
+
+
+/// ### kraken_join
+/// Blocks the current thread until a thread started with kraken_spawn stops, then gives
+/// its slot back to the runtime that owns it. The handle is invalid afterwards. Every
+/// spawned thread is joined or detached exactly once.
+/// ```C
+/// void* kraken_join ( struct kraken_runtime* runtime,
+///                     struct kraken_thread*  thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread      | The handle returned by kraken_spawn
+/// > Returns the value the thread's routine returned
+void* kraken_join
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_runtime* owner = thread->owner;
+    void*                  result;
+
+    runtime = kraken_local( runtime );
+
+    assert( thread->joinable && "KRAKEN: The thread is not joinable." );
+    assert( thread != runtime->current_thread && "KRAKEN: A thread can't join itself." );
+
+    kraken_lock( &owner->lock );
+
+    if ( !thread->finished )
+    {
+        kraken_waiters_push( &thread->joiners, runtime->current_thread );
+        kraken_unlock( &owner->lock );
+
+        kraken_waiters_wait( runtime, &owner->lock, &thread->joiners, UINT64_MAX );
+    }
+    else
+    {
+        kraken_unlock( &owner->lock );
+    }
+
+    result = thread->result;
+    kraken_release_thread( thread );
+
+    return result;
+} // kraken_join
+
+
+/// ### kraken_detach
+/// Lets the slot of a thread started with kraken_spawn go back to its runtime as soon as
+/// the thread stops. The handle is invalid afterwards.
+/// ```C
+/// void kraken_detach ( struct kraken_thread* thread )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// thread      | The handle returned by kraken_spawn
+/// Does not return.
+void kraken_detach
+(
+    struct kraken_thread*   thread
+)
+{
+    struct kraken_runtime* owner = thread->owner;
+    bool                   finished;
+
+    assert( thread->joinable && "KRAKEN: The thread is not joinable." );
+
+    kraken_lock( &owner->lock );
+
+    finished         = thread->finished;
+    thread->joinable = finished;
+
+    kraken_unlock( &owner->lock );
+
+    if ( finished )
+    {
+        kraken_release_thread( thread );
+    }
+} // kraken_detach
+
+
+/// ### kraken_generator_entry
+/// First code executed by a generator. Runs the generator's routine and switches back to
+/// the consumer for good once it returns.
+/// ```C
+/// void kraken_generator_entry ( struct kraken_runtime* runtime )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | The runtime of the first kraken_generator_next
+/// Does not return.
+static void kraken_generator_entry
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_generator* generator = runtime->current_thread->generator;
+
+    generator->result = generator->routine( runtime, generator->argument );
+
+    // the consumer may have been stolen by another runtime while the routine ran
+    runtime = kraken_local( runtime );
+
+    generator->finished = true;
+    kraken_switch( &generator->context, &generator->caller, runtime );
+
+    assert( false && "KRAKEN: Finished generator was resumed." );
+} // kraken_generator_entry
+
+
+/// ### kraken_generator_create
+/// Creates a generator that runs `routine` with `argument` on a stack of its own. Nothing
+/// runs until the first kraken_generator_next.
+/// ```C
+/// struct kraken_generator* kraken_generator_create ( struct kraken_runtime* runtime,
+///                                                    kraken_routine_type    routine,
+///                                                    void*                  argument,
+///                                                    uint32_t               stack_size )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// routine     | The function the generator runs
+/// argument    | Passed to `routine`
+/// stack_size  | Size of the generator's stack in bytes, 0 for `KRAKEN_STACK_SIZE`
+/// > Returns the generator or NULL if memory runs out
+struct kraken_generator* kraken_generator_create
+(
+    struct kraken_runtime*  runtime,
+    kraken_routine_type     routine,
+    void*                   argument,
+    uint32_t                stack_size
+)
+{
+    struct kraken_generator* generator;
+    char*                    stack_top;
+
+    assert( NULL != routine );
+    assert( 0 == stack_size || 64 <= stack_size );
+
+    generator = ( struct kraken_generator* )calloc( 1, sizeof( struct kraken_generator ) );
+
+    if ( NULL == generator )
+    {
+        return NULL;
+    }
+
+    generator->stack_size = 0 == stack_size ? KRAKEN_STACK_SIZE : ( stack_size + 15 ) & ~15u;
+    generator->stack      = kraken_stack_allocate( kraken_local( runtime ),
+                                                   generator->stack_size );
+    generator->routine    = routine;
+    generator->argument   = argument;
+
+    if ( NULL == generator->stack )
+    {
+        free( generator );
+
+        return NULL;
+    }
+
+    stack_top = generator->stack + generator->stack_size;
+
+#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
+    // same first frame as a thread, see kraken_prepare_thread
+    *( uint64_t* )( stack_top -  8 ) = ( uint64_t )0;
+    *( uint64_t* )( stack_top - 16 ) = ( uint64_t )kraken_generator_entry;
+
+    generator->context.rsp = ( uint64_t )( stack_top - 16 );
+    generator->context.rbp = 0;
+
+#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
+    *( uint32_t* )( stack_top -  4 ) = ( uint32_t )runtime;
+    *( uint32_t* )( stack_top -  8 ) = ( uint32_t )0;
+    *( uint32_t* )( stack_top - 12 ) = ( uint32_t )kraken_generator_entry;
+
+    generator->context.esp = ( uint32_t )( stack_top - 12 );
+
+#endif
+
+    return generator;
+} // kraken_generator_create
+
+
+/// ### kraken_generator_next
+/// Runs a generator until it yields its next value or its routine returns. The consumer
+/// can be any thread, including the main thread, except threads on the shared stack.
+/// The generator's stack goes back to the stack cache as soon as the routine returns.
+/// ```C
+/// bool kraken_generator_next ( struct kraken_runtime*   runtime,
+///                              struct kraken_generator* generator,
+///                              void**                   value )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// generator   | The generator
+/// value       | Receives the yielded value, can be NULL
+/// > Returns false if the generator finished instead of yielding a value
+bool kraken_generator_next
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_generator*    generator,
+    void**                      value
+)
+{
+    struct kraken_thread* current_thread;
+
+    if ( generator->finished )
+    {
+        return false;
+    }
+
+    runtime        = kraken_local( runtime );
+    current_thread = runtime->current_thread;
+
+    assert( !generator->running && "KRAKEN: The generator is running." );
+    assert( !current_thread->shared_stack && "KRAKEN: Shared stack threads can't run generators." );
+
+    generator->running        = true;
+    generator->outer          = current_thread->generator;
+    current_thread->generator = generator;
+
+    kraken_switch( &generator->caller, &generator->context, runtime );
+
+    current_thread->generator = generator->outer;
+    generator->running        = false;
+
+    if ( generator->finished )
+    {
+        // nothing runs on the stack anymore, keep it around for the next thread
+        kraken_stack_release( kraken_local( runtime ), generator->stack, generator->stack_size );
+        generator->stack = NULL;
+
+        return false;
+    }
+
+    if ( NULL != value )
+    {
+        *value = generator->value;
+    }
+
+    return true;
+} // kraken_generator_next
+
+
+/// ### kraken_generator_yield
+/// Hands a value to the consumer of the generator the current thread is running in and
+/// suspends the generator until the next kraken_generator_next.
 /// ```C
-/// void kraken_print_thread_state ( struct kraken_thread* runtime 
-///                                  int                   return_code );
+/// void kraken_generator_yield ( struct kraken_runtime* runtime,
+///                               void*                  value )
 /// ```
 /// Parameter   | Description
 /// ------------|----------------------------------------------------------------------------
-/// runtime     | A pointer to `struct kraken_runtime`.
-/// return_code | Program exit code you want to return with
+/// runtime     | A pointer to `struct kraken_runtime`
+/// value       | The value
 /// Does not return.
-void __attribute__( ( noreturn ) ) kraken_run
+void kraken_generator_yield
 (
     struct kraken_runtime*  runtime,
-    int                     return_code
+    void*                   value
+)
+{
+    struct kraken_generator* generator;
+
+    runtime   = kraken_local( runtime );
+    generator = runtime->current_thread->generator;
+
+    assert( NULL != generator && "KRAKEN: Not inside a generator." );
+
+    generator->value = value;
+    kraken_switch( &generator->context, &generator->caller, runtime );
+} // kraken_generator_yield
+
+
+/// ### kraken_generator_destroy
+/// Frees a generator. A generator that has not finished is dropped where it last yielded,
+/// its routine does not get to clean up.
+/// ```C
+/// void kraken_generator_destroy ( struct kraken_runtime*   runtime,
+///                                 struct kraken_generator* generator )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// generator   | The generator
+/// Does not return.
+void kraken_generator_destroy
+(
+    struct kraken_runtime*      runtime,
+    struct kraken_generator*    generator
+)
+{
+    assert( !generator->running && "KRAKEN: The generator is running." );
+
+    if ( NULL != generator->stack )
+    {
+        kraken_stack_release( kraken_local( runtime ), generator->stack, generator->stack_size );
+    }
+
+    free( generator );
+} // kraken_generator_destroy
+
+
+/// ### kraken_start_threads
+/// Creates `count` threads running the same function. The slots are taken in one go,
+/// the stacks the stack cache can't provide come from a single mapping and all threads
+/// join the run queue under one lock. Either all threads are started or none.
+/// ```C
+/// int kraken_start_threads ( struct kraken_runtime*              runtime,
+///                            function_type                       thread_func,
+///                            uint32_t                            count,
+///                            const struct kraken_thread_options* options )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// runtime     | A pointer to `struct kraken_runtime`
+/// thread_func | The function the threads run
+/// count       | Number of threads
+/// options     | Settings for all threads or NULL for the defaults
+/// > Returns 0 on success and -1 if there are not enough free slots or stack memory
+int kraken_start_threads
+(
+    struct kraken_runtime*              runtime,
+    function_type                       thread_func,
+    uint32_t                            count,
+    const struct kraken_thread_options* options
 )
 {
-    uint16_t thread_idx;
-    if ( runtime->current_thread != &runtime->threads[ 0 ] )
+    struct kraken_thread* first_thread = NULL;
+    struct kraken_thread* last_thread  = NULL;
+    struct kraken_thread* thread;
+    struct kraken_thread* next_thread;
+    uint32_t              thread_count = 0;
+    uint32_t              map_count    = 0;
+    uint32_t              stack_size   = NULL == options || 0 == options->stack_size ?
+                                         KRAKEN_STACK_SIZE : ( options->stack_size + 15 ) & ~15u;
+    bool                  shared_stack = NULL != options && options->shared_stack;
+    char*                 region       = NULL;
+
+    if ( 0 == count )
     {
-        runtime->current_thread->status = STOPPED;
-        kraken_yield( runtime );
+        return 0;
     }
 
-    while ( kraken_yield( runtime ) );
+    // take all slots at once, linked through next in id order
+    kraken_lock( &runtime->lock );
 
-    // Free thread stack memory when done
-    for ( thread_idx = 0; thread_idx < KRAKEN_MAX_THREADS; thread_idx++ )
+    for ( ; thread_count < count; thread_count++ )
     {
-        if ( NULL != runtime->threads[ thread_idx ].stack )
+        if ( NULL == ( thread = kraken_allocate_thread( runtime ) ) )
         {
-            free( runtime->threads[ thread_idx ].stack );
+            break;
+        }
+
+        thread->stack_size = stack_size;
+
+        if ( NULL == last_thread )
+        {
+            first_thread = thread;
+        }
+        else
+        {
+            last_thread->next = thread;
         }
+
+        last_thread = thread;
     }
 
-    exit( return_code );
-} // kraken_run
+    kraken_unlock( &runtime->lock );
 
+    if ( thread_count == count && !shared_stack )
+    {
+        // cached stacks first, one mapping for the rest
+        for ( thread = first_thread; NULL != thread; thread = thread->next )
+        {
+            thread->stack = kraken_stack_pop( runtime, stack_size );
+            map_count += NULL == thread->stack;
+        }
 
-/// ### kraken_initialize_runtime
-/// Prints the contents of a kraken_runtime (see struct kraken_runtme)
+#if defined( __unix__ ) || defined( __APPLE__ )
+        if ( 0 < map_count && NULL != ( region = kraken_stack_map( stack_size, map_count ) ) )
+        {
+            for ( thread = first_thread; NULL != thread; thread = thread->next )
+            {
+                if ( NULL == thread->stack )
+                {
+                    thread->stack = region;
+                    region       += kraken_stack_stride( stack_size );
+                }
+            }
+        }
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+    }
+
+    for ( thread = first_thread; NULL != thread && thread_count == count; thread = thread->next )
+    {
+        if ( !kraken_prepare_thread( runtime, thread, thread_func, options ) )
+        {
+            thread_count = 0;
+        }
+    }
+
+    if ( thread_count != count )
+    {
+        for ( thread = first_thread; NULL != thread; thread = next_thread )
+        {
+            next_thread = thread->next;
+
+            kraken_preempt_disable();
+            free( thread->saved_stack );
+            kraken_preempt_enable();
+
+            thread->saved_stack    = NULL;
+            thread->saved_size     = 0;
+            thread->saved_capacity = 0;
+            thread->shared_stack   = false;
+
+            if ( NULL != thread->stack )
+            {
+                kraken_stack_release( runtime, thread->stack, stack_size );
+                thread->stack = NULL;
+            }
+
+            kraken_release_thread( thread );
+        }
+
+        return -1;
+    }
+
+#if KRAKEN_ENABLE_POOL
+    if ( NULL != runtime->pool )
+    {
+        __atomic_add_fetch( &runtime->pool->live_threads, count, __ATOMIC_RELEASE );
+    }
+#endif // KRAKEN_ENABLE_POOL
+
+    kraken_lock( &runtime->lock );
+
+    for ( thread = first_thread; NULL != thread; thread = next_thread )
+    {
+        next_thread = thread->next;
+        kraken_queue_push( runtime, thread );
+    }
+
+    kraken_unlock( &runtime->lock );
+
+    kraken_wake( runtime );
+
+    return 0;
+} // kraken_start_threads
+
+
+#if KRAKEN_ENABLE_POOL
+/// ### kraken_initialize_pool
+/// Creates a pool of runtimes. The calling os thread drives the first runtime once
+/// kraken_pool_run or kraken_pool_wait is called.
 /// ```C
-/// void kraken_initialize_runtime ( void ) 
+/// struct kraken_pool* kraken_initialize_pool ( uint16_t runtime_count )
 /// ```
-/// Parameter   | Description
-/// ------------|----------------------------------------------------------------------------
-/// void /**/   | No parameters!!!
-/// > Returns a pointer to `struct kraken_runtime`
-struct kraken_runtime* kraken_initialize_runtime
+/// Parameter     | Description
+/// --------------|--------------------------------------------------------------------------
+/// runtime_count | Number of runtimes. 0 creates one runtime per online processor core.
+/// > Returns a pointer to `struct kraken_pool`
+struct kraken_pool* kraken_initialize_pool
 (
-    void
+    uint16_t                runtime_count
 )
 {
-    uint16_t thread_idx;
-    
-    struct kraken_runtime* runtime = ( struct kraken_runtime* )
-        calloc( 0, sizeof( struct kraken_runtime ) );
+    uint16_t            runtime_idx;
+    struct kraken_pool* pool;
+
+    if ( 0 == runtime_count )
+    {
+        runtime_count = ( uint16_t )sysconf( _SC_NPROCESSORS_ONLN );
+    }
 
-    runtime->current_thread         = &runtime->threads[ 0 ];
-    runtime->current_thread->status = RUNNING;
-    runtime->current_thread->stack  = ( char* )malloc( sizeof( char ) * KRAKEN_STACK_SIZE );
+    pool = ( struct kraken_pool* )calloc( 1, sizeof( struct kraken_pool ) );
 
-    const char* const thread_stack = runtime->current_thread->stack;
-    assert( ( thread_stack == NULL, "KRAKEN: Can't allocate memory for thread stack." ) );
+    assert( NULL != pool && "KRAKEN: Can't allocate memory for pool." );
 
-    for ( thread_idx = 0; thread_idx < KRAKEN_MAX_THREADS; thread_idx++ )
+    pool->runtimes      = ( struct kraken_runtime** )
+        calloc( runtime_count, sizeof( struct kraken_runtime* ) );
+    pool->runtime_count = runtime_count;
+
+    assert( NULL != pool->runtimes && "KRAKEN: Can't allocate memory for pool." );
+
+    for ( runtime_idx = 0; runtime_idx < runtime_count; runtime_idx++ )
     {
-        runtime->threads[ thread_idx ].id = thread_idx;
+        pool->runtimes[ runtime_idx ]        = kraken_initialize_runtime();
+        pool->runtimes[ runtime_idx ]->pool  = pool;
+        pool->runtimes[ runtime_idx ]->index = runtime_idx;
     }
 
-    return runtime;
-} // kraken_initialize_runtime
+    return pool;
+} // kraken_initialize_pool
 
 
-/// ### kraken_switch
-/// Switches between old and new processor contexts when a new thread is ready for
-/// execution.
+/// ### kraken_pool_start_thread
+/// Creates a thread on the runtimes of a pool in round robin order.
 /// ```C
-/// void kraken_switch ( struct kraken_context* old_context,
-///                      struct kraken_context* new_context,
-///                      struct kraken_runtime* runtime ) 
+/// int kraken_pool_start_thread ( struct kraken_pool* pool,
+///                                function_type       thread_func )
 /// ```
 /// Parameter   | Description
 /// ------------|----------------------------------------------------------------------------
-/// old_context | Old context
-/// new_context | New context
-/// runtime     | Pointer to a runtime
-/// > Returns a pointer to `struct kraken_runtime`
-__asm__
+/// pool        | A pointer to `struct kraken_pool`
+/// thread_func | The function the thread runs
+/// > Returns 0 on success and -1 on failure
+int kraken_pool_start_thread
 (
-    ".globl _kraken_switch, kraken_switch\n\t"
-    "_kraken_switch:                     \n\t"
-    "kraken_switch:                      \n\t"
-#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
-#ifdef KRAKEN_DEBUG
-#if KRAKEN_ENABLE_BREAK_BEFORE_SWITCH == 0x1 
-   // interrupt gdb if build type is debug.
-   "int    $3                           \n\t"
-#endif // KRAKEN_ENABLE_BREAK_BEFORE_SWITCH == 0x1
-#endif // KRAKEN_DEBUG
-#warning "COMPILING FOR X86_64"
-    "movq   %rsp,       0x00(%rdi)       \n\t"
-    "movq   %r15,       0x08(%rdi)       \n\t"
-    "movq   %r14,       0x10(%rdi)       \n\t"
-    "movq   %r13,       0x18(%rdi)       \n\t"
-    "movq   %r12,       0x20(%rdi)       \n\t"
-    "movq   %rbx,       0x28(%rdi)       \n\t"
-    "movq   %rbp,       0x30(%rdi)       \n\t"
-    "movq   0x00(%rsi), %rsp             \n\t"
-    "movq   0x08(%rsi), %r15             \n\t"
-    "movq   0x10(%rsi), %r14             \n\t"
-    "movq   0x18(%rsi), %r13             \n\t"
-    "movq   0x20(%rsi), %r12             \n\t"
-    "movq   0x28(%rsi), %rbx             \n\t"
-    "movq   0x30(%rsi), %rbp             \n\t"
-    "movq   %rdx,       %rax             \n\t"
-    // jump to thread's function
-    "ret                                 \n\t"
-#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
-#warning "COMPILING FOR X86"
-    "movl   %esp,       0x00(%edi)       \n\t"
-    "movl   %ebx,       0x28(%edi)       \n\t"
-    "movl   %ebp,       0x30(%edi)       \n\t"
-    "movl   0x00(%esi), %esp             \n\t"
-    "movl   0x28(%esi), %ebx             \n\t"
-    "movl   0x30(%esi), %ebp             \n\t"
-#elif KRAKEN_ARCH == KRAKEN_ARCH_AVR
-#warning "COMPILING FOR AVR"
-    "mov    r15,         r12             \n\t"
-#endif
-);
+    struct kraken_pool*     pool,
+    function_type           thread_func
+)
+{
+    uint16_t runtime_idx = __atomic_fetch_add( &pool->next_runtime, 1, __ATOMIC_RELAXED );
 
+    return kraken_start_thread( pool->runtimes[ runtime_idx % pool->runtime_count ],
+                                thread_func );
+} // kraken_pool_start_thread
 
-/// ### kraken_guard
-/// Prints the contents of a kraken_runtime (see struct kraken_runtme)
+
+/// ### kraken_steal
+/// Moves up to half of the READY threads of another runtime onto the queue of `thief`.
 /// ```C
-/// void kraken_initialize_runtime ( void ) 
+/// bool kraken_steal ( struct kraken_runtime* thief )
 /// ```
 /// Parameter   | Description
 /// ------------|----------------------------------------------------------------------------
-/// runtime     | A pointer to `struct kraken_runtime`
-/// Does not return.
-static void kraken_guard
+/// thief       | The idle runtime
+/// > Returns true if any thread was stolen
+static bool kraken_steal
 (
-    struct kraken_runtime*  runtime
+    struct kraken_runtime*  thief
 )
 {
-    // Mov runtime pointer into rax register just to ensure we have a backup copy.
-    // Helpful for debugging.
-    __asm__
-    (
-#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64    
-    "movq   %rdi, %rax                   \n\t"
-    "movq   %rax, -0x8(%rbp)             \n\t"
-#elif KRAKEN_ARCH == KRAKEN_ARCH_AVR
-    "nop                                 \n\t"
-#endif
-    );
-    
-    assert( NULL != runtime );
+    struct kraken_pool*    pool                           = thief->pool;
+    struct kraken_runtime* victim                         = NULL;
+    struct kraken_thread*  stolen[ KRAKEN_STEAL_BATCH ];
+    uint32_t               stolen_count                   = 0;
+    uint32_t               steal_count;
+    uint16_t               offset;
 
-    if ( runtime->current_thread != &runtime->threads[ 0 ] )
+    for ( offset = 1; offset < pool->runtime_count && 0 == stolen_count; offset++ )
     {
-        runtime->current_thread->status = STOPPED;
-        kraken_yield( runtime );
+        victim = pool->runtimes[ ( thief->index + offset ) % pool->runtime_count ];
+
+        // peek without the lock, most victims have nothing to give
+        if ( 0 == __atomic_load_n( &victim->queue_count, __ATOMIC_RELAXED ) )
+        {
+            continue;
+        }
+
+        kraken_lock( &victim->lock );
+
+        steal_count = ( victim->queue_count + 1 ) / 2;
+
+        if ( KRAKEN_STEAL_BATCH < steal_count )
+        {
+            steal_count = KRAKEN_STEAL_BATCH;
+        }
+
+        // take from the tail, the victim keeps the threads that have waited longest.
+        // Threads on the victim's shared stack can't move and end the batch.
+        while ( stolen_count < steal_count && !kraken_queue_last( victim )->shared_stack )
+        {
+            stolen[ stolen_count++ ] = kraken_queue_remove( victim, kraken_queue_last( victim ) );
+        }
+
+        kraken_unlock( &victim->lock );
     }
 
-    while ( kraken_yield( runtime ) ) ;
-} // kraken_guard
+    if ( 0 == stolen_count )
+    {
+        return false;
+    }
 
+    kraken_lock( &thief->lock );
 
-/// ### kraken_yield
-/// Switches to a different thread once the current thread has completed its work
+    while ( 0 < stolen_count )
+    {
+        kraken_queue_push( thief, stolen[ --stolen_count ] );
+    }
+
+    kraken_unlock( &thief->lock );
+
+    return true;
+} // kraken_steal
+
+
+/// ### kraken_pool_schedule
+/// Drives one runtime of a pool on the calling os thread until every thread of the pool
+/// has stopped. The os thread is pinned to the core matching the runtime's index.
 /// ```C
-/// void kraken_initialize_runtime ( void )
+/// void kraken_pool_schedule ( struct kraken_runtime* runtime )
 /// ```
 /// Parameter   | Description
 /// ------------|----------------------------------------------------------------------------
-/// runtime     | A pointer to `struct kraken_runtime`
+/// runtime     | A runtime of a pool
 /// Does not return.
-bool kraken_yield
+static void kraken_pool_schedule
 (
     struct kraken_runtime*  runtime
 )
 {
-    struct kraken_context *old_ctx             =       NULL;
-    struct kraken_context *new_ctx             =       NULL;
-    struct kraken_thread  *previous_thread     =       NULL;
-    struct kraken_thread  *invalid_thread      =       NULL;
-    struct kraken_thread  *next_thread         =       NULL;
+    struct kraken_pool* pool       = runtime->pool;
+    long                core_count = sysconf( _SC_NPROCESSORS_ONLN );
+    cpu_set_t           previous_cpus;
+    cpu_set_t           cpus;
+    uint32_t            idle_rounds = 0;
 
-#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_ROUND_ROBIN
-    previous_thread = runtime->current_thread;
+    sched_getaffinity( 0, sizeof( previous_cpus ), &previous_cpus );
 
-    while ( previous_thread->status != READY )
+    CPU_ZERO( &cpus );
+    CPU_SET( runtime->index % ( 0 < core_count ? core_count : 1 ), &cpus );
+    sched_setaffinity( 0, sizeof( cpus ), &cpus );
+
+    kraken_local_runtime = runtime;
+
+#if KRAKEN_ENABLE_WATCHDOG
+    runtime->os_thread   = pthread_self();
+#endif // KRAKEN_ENABLE_WATCHDOG
+
+#if KRAKEN_ENABLE_PREEMPTION
+    if ( 0 != pool->preempt_slice )
     {
-        // if the current thread is the last thread
-        next_thread = previous_thread++;
+        kraken_preempt_start( runtime, pool->preempt_slice );
+    }
+#endif // KRAKEN_ENABLE_PREEMPTION
 
-        invalid_thread = &runtime->threads[ KRAKEN_MAX_THREADS ];
+#if KRAKEN_ENABLE_PROFILER
+    if ( 0 != pool->profile_hz )
+    {
+        kraken_profile_start( runtime, pool->profile_hz );
+    }
+#endif // KRAKEN_ENABLE_PROFILER
 
-        if ( next_thread == invalid_thread )
+    while ( 0 != __atomic_load_n( &pool->live_threads, __ATOMIC_ACQUIRE ) )
+    {
+        if ( kraken_yield( runtime ) || kraken_steal( runtime ) )
         {
-            // set the current thread to the first thread
-            previous_thread = &( runtime->threads[ 0 ] );
+            idle_rounds = 0;
         }
-
-        if ( previous_thread == runtime->current_thread )
+        // threads to steal may turn up any moment, sleep only once that seems unlikely
+        else if ( ++idle_rounds < 64 )
         {
-            return false;
+            sched_yield();
+        }
+        else
+        {
+            kraken_idle( runtime, kraken_now() + KRAKEN_POOL_IDLE_SLEEP );
         }
     }
 
-    if ( runtime->current_thread->status != STOPPED )
-    {
-        runtime->current_thread->status = READY;
-    }
-    
-    previous_thread->status = RUNNING;
-#endif
+#if KRAKEN_ENABLE_PROFILER
+    kraken_profile_stop( runtime );
+#endif // KRAKEN_ENABLE_PROFILER
 
-    old_ctx = &runtime->current_thread->context;
-    
-    new_ctx = &previous_thread->context;
+#if KRAKEN_ENABLE_PREEMPTION
+    kraken_preempt_stop( runtime );
+#endif // KRAKEN_ENABLE_PREEMPTION
 
-    runtime->current_thread = previous_thread;
+    kraken_local_runtime = NULL;
 
-    assert( runtime->current_thread != NULL );
+    sched_setaffinity( 0, sizeof( previous_cpus ), &previous_cpus );
+} // kraken_pool_schedule
 
-    // switch from old context to new context
-    kraken_switch( old_ctx, new_ctx, runtime );
 
-    return true;
-} // kraken_yield
+static void* kraken_pool_worker
+(
+    void*   runtime
+)
+{
+    kraken_pool_schedule( ( struct kraken_runtime* )runtime );
 
+    return NULL;
+} // kraken_pool_worker
 
-/// ### kraken_start_thread
-/// Switches to a different thread once the current thread has completed its work
+
+/// ### kraken_pool_wait
+/// Starts one os thread per runtime, with the calling os thread driving the first runtime,
+/// and returns once every thread of the pool has stopped.
 /// ```C
-/// void kraken_initialize_runtime ( void )
+/// void kraken_pool_wait ( struct kraken_pool* pool )
 /// ```
 /// Parameter   | Description
 /// ------------|----------------------------------------------------------------------------
-/// runtime     | A pointer to `struct kraken_runtime`
+/// pool        | A pointer to `struct kraken_pool`
 /// Does not return.
-int kraken_start_thread
+void kraken_pool_wait
 (
-    struct kraken_runtime*  runtime,
-    function_type           thread_func
+    struct kraken_pool*     pool
 )
 {
-    struct kraken_thread* new_thread = NULL;
-    const char* const thread_stack   = new_thread->stack;
+    uint16_t   runtime_idx;
+    pthread_t* workers = ( pthread_t* )calloc( pool->runtime_count, sizeof( pthread_t ) );
 
-    // look for a slot for the new thread;
-    for ( new_thread = &runtime->threads[ 0 ]; true ;new_thread++ )
+    assert( NULL != workers && "KRAKEN: Can't allocate memory for pool workers." );
+
+    for ( runtime_idx = 1; runtime_idx < pool->runtime_count; runtime_idx++ )
     {
-        if ( new_thread == &runtime->threads[ KRAKEN_MAX_THREADS ] )
-        {
-            return -1;
-        }
-        else if ( new_thread->status == STOPPED )
-        {
-            break;
-        }
-    }
+        int result = pthread_create( &workers[ runtime_idx ], NULL, kraken_pool_worker,
+                                     pool->runtimes[ runtime_idx ] );
 
-    new_thread->stack = ( char* )malloc( KRAKEN_STACK_SIZE );
+        assert( 0 == result && "KRAKEN: Can't start pool worker." );
+        ( void )result;
+    }
 
-    assert( ( NULL == thread_stack, "KRAKEN: Can't allocate memory for thread stack." ) );
+    kraken_pool_schedule( pool->runtimes[ 0 ] );
 
-    if ( NULL == thread_stack )
+    for ( runtime_idx = 1; runtime_idx < pool->runtime_count; runtime_idx++ )
     {
-        return -1;
+        pthread_join( workers[ runtime_idx ], NULL );
     }
 
-#if KRAKEN_ARCH == KRAKEN_ARCH_X86_64
-    *( uint64_t* )&( new_thread->stack[ KRAKEN_STACK_SIZE -  8 ] ) = ( uint64_t )kraken_guard;
-    *( uint64_t* )&( new_thread->stack[ KRAKEN_STACK_SIZE - 16 ] ) = ( uint64_t )thread_func;
+    free( workers );
+} // kraken_pool_wait
 
-    new_thread->context.rsp = ( uint64_t )&( new_thread->stack[ KRAKEN_STACK_SIZE - 16 ] );
 
-#elif KRAKEN_ARCH == KRAKEN_ARCH_X86
-    *( uint32_t* )&( new_thread->stack[ KRAKEN_STACK_SIZE -  4 ] ) = ( uint32_t )kraken_guard;
-    *( uint32_t* )&( new_thread->stack[ KRAKEN_STACK_SIZE -  8 ] ) = ( uint32_t )thread_func;
+/// ### kraken_pool_run
+/// Runs a pool until all of its threads have stopped and exits the process.
+/// ```C
+/// void kraken_pool_run ( struct kraken_pool* pool,
+///                        int                 return_code )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// pool        | A pointer to `struct kraken_pool`
+/// return_code | Program exit code you want to return with
+/// Does not return.
+void __attribute__( ( noreturn ) ) kraken_pool_run
+(
+    struct kraken_pool*     pool,
+    int                     return_code
+)
+{
+    kraken_pool_wait( pool );
 
-    new_thread->context.esp = ( uint32_t )&( new_thread->stack[ KRAKEN_STACK_SIZE - 8 ] );
+    exit( return_code );
+} // kraken_pool_run
 
-#endif
 
-    new_thread->status = READY;
+/// ### kraken_pool_trace_dump
+/// Writes the trace rings of all runtimes of a pool as one Chrome trace JSON, one track
+/// per runtime (see kraken_trace_dump).
+/// ```C
+/// int kraken_pool_trace_dump ( struct kraken_pool* pool,
+///                              FILE*               file )
+/// ```
+/// Parameter   | Description
+/// ------------|----------------------------------------------------------------------------
+/// pool        | A pointer to `struct kraken_pool`
+/// file        | Where the JSON goes
+/// > Returns 0 on success and -1 if writing failed
+int kraken_pool_trace_dump
+(
+    struct kraken_pool*     pool,
+    FILE*                   file
+)
+{
+    uint16_t runtime_idx;
+    bool     first = true;
+
+    fprintf( file, "{\"traceEvents\":[" );
 
-    return 0;
-} // kraken_start_thread
+    for ( runtime_idx = 0; runtime_idx < pool->runtime_count; runtime_idx++ )
+    {
+        kraken_trace_write( pool->runtimes[ runtime_idx ], file, &first );
+    }
+
+    fprintf( file, "\n]}\n" );
+
+    return 0 == fflush( file ) && 0 == ferror( file ) ? 0 : -1;
+} // kraken_pool_trace_dump
+#endif // KRAKEN_ENABLE_POOL
 
 
 /// ## Credits
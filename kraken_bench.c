@@ -0,0 +1,650 @@
+#define KRAKEN_SCHEDULER   0x01
+#define KRAKEN_ENABLE_POOL 0x0
+#include "kraken.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <x86intrin.h>
+
+
+// Results are printed one JSON object per line:
+// { "bench": ..., "impl": ..., "threads": ..., "ops": ..., "ns_per_op": ..., ... }
+#define BENCH_PINGPONG_ROUNDS   1000000
+#define BENCH_YIELD_SWITCHES    4000000
+#define BENCH_SPAWN_THREADS     20000
+#define BENCH_MEMORY_THREADS    10000
+#define BENCH_PTHREAD_THREADS   1000
+#define BENCH_STACK_SIZE        ( 16 * 1024 )
+
+// private stacks need two mappings each, above this thread count shared stacks are used
+#define BENCH_PRIVATE_LIMIT     16384
+
+// ucontext baselines keep one malloc'd stack per context
+#define BENCH_UCONTEXT_LIMIT    16384
+
+
+struct bench_clock
+{
+    uint64_t ns;
+    uint64_t cycles;
+};
+
+
+static struct bench_clock bench_start
+(
+    void
+)
+{
+    struct bench_clock clock = { kraken_now(), __rdtsc() };
+
+    return clock;
+}
+
+
+static void bench_report
+(
+    const char*         bench,
+    const char*         impl,
+    uint32_t            threads,
+    uint64_t            ops,
+    struct bench_clock  start
+)
+{
+    uint64_t ns     = kraken_now() - start.ns;
+    uint64_t cycles = __rdtsc() - start.cycles;
+
+    printf( "{ \"bench\": \"%s\", \"impl\": \"%s\", \"threads\": %u, \"ops\": %llu, "
+            "\"ns_per_op\": %.2f, \"cycles_per_op\": %.2f, \"ops_per_sec\": %.0f }\n",
+            bench, impl, threads, ( unsigned long long )ops,
+            ( double )ns / ops, ( double )cycles / ops, ops * 1e9 / ( double )ns );
+    fflush( stdout );
+}
+
+
+static void bench_report_memory
+(
+    const char*         impl,
+    uint32_t            threads,
+    uint64_t            bytes
+)
+{
+    printf( "{ \"bench\": \"memory\", \"impl\": \"%s\", \"threads\": %u, "
+            "\"bytes_per_thread\": %.0f }\n",
+            impl, threads, ( double )bytes / threads );
+    fflush( stdout );
+}
+
+
+static uint64_t bench_rss
+(
+    void
+)
+{
+    unsigned long long pages    = 0;
+    unsigned long long resident = 0;
+    FILE*              statm    = fopen( "/proc/self/statm", "r" );
+
+    if ( NULL != statm )
+    {
+        if ( 2 != fscanf( statm, "%llu %llu", &pages, &resident ) )
+        {
+            resident = 0;
+        }
+
+        fclose( statm );
+    }
+
+    return resident * ( uint64_t )sysconf( _SC_PAGESIZE );
+}
+
+
+//===========================================================================================
+//
+//                                  KRAKEN
+//
+//===========================================================================================
+static uint64_t kraken_yields   = 0;
+static uint64_t kraken_rounds   = 0;
+
+
+KRAKEN_THREAD_FUNCTION( kraken_yield_thread,
+{
+    uint64_t round;
+
+    for ( round = 0; round < kraken_rounds; round++ )
+    {
+        kraken_yield( runtime );
+    }
+
+    kraken_yields += kraken_rounds;
+})
+
+
+KRAKEN_THREAD_FUNCTION( kraken_empty_thread,
+{
+})
+
+
+// only the yields of the threads count, like the ucontext baseline. The turns of the main
+// thread in between are timed but not counted.
+static uint64_t kraken_bench_run
+(
+    struct kraken_runtime*  runtime
+)
+{
+    while ( kraken_yield( runtime ) )
+    {
+    }
+
+    return kraken_yields;
+}
+
+
+static void kraken_bench_pingpong
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+    struct bench_clock     start;
+    uint64_t               switches;
+
+    kraken_yields = 0;
+    kraken_rounds = BENCH_PINGPONG_ROUNDS;
+
+    KRAKEN_SCHEDULE_THREAD( runtime, kraken_yield_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, kraken_yield_thread );
+
+    start    = bench_start();
+    switches = kraken_bench_run( runtime );
+
+    bench_report( "pingpong", "kraken", 2, switches, start );
+}
+
+
+static void kraken_bench_yield
+(
+    uint32_t                thread_count
+)
+{
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, false, BENCH_STACK_SIZE };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+    struct bench_clock           start;
+    uint64_t                     switches;
+
+    options.shared_stack = BENCH_PRIVATE_LIMIT < thread_count;
+
+    kraken_yields = 0;
+    kraken_rounds = BENCH_YIELD_SWITCHES / thread_count;
+    kraken_rounds = 0 == kraken_rounds ? 1 : kraken_rounds;
+
+    if ( 0 != kraken_start_threads( runtime, kraken_yield_thread, thread_count, &options ) )
+    {
+        fprintf( stderr, "kraken_bench: can't start %u threads\n", thread_count );
+
+        return;
+    }
+
+    start    = bench_start();
+    switches = kraken_bench_run( runtime );
+
+    bench_report( "yield", options.shared_stack ? "kraken_shared" : "kraken",
+                  thread_count, switches, start );
+}
+
+
+static void kraken_bench_spawn
+(
+    const char*             impl,
+    bool                    bulk,
+    uint32_t                stack_size
+)
+{
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, false, stack_size };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+    struct bench_clock           start;
+    uint32_t                     thread_idx;
+
+    start = bench_start();
+
+    if ( bulk )
+    {
+        kraken_start_threads( runtime, kraken_empty_thread, BENCH_SPAWN_THREADS, &options );
+    }
+    else
+    {
+        for ( thread_idx = 0; thread_idx < BENCH_SPAWN_THREADS; thread_idx++ )
+        {
+            kraken_start_thread_ex( runtime, kraken_empty_thread, &options );
+        }
+    }
+
+    bench_report( "spawn", impl, BENCH_SPAWN_THREADS, BENCH_SPAWN_THREADS, start );
+
+    start = bench_start();
+    kraken_wait( runtime );
+
+    bench_report( "teardown", impl, BENCH_SPAWN_THREADS, BENCH_SPAWN_THREADS, start );
+}
+
+
+// threads come and go in batches the stack cache can hold, so after the first batch every
+// spawn takes a cached stack and every teardown hands it back
+static void kraken_bench_churn
+(
+    const char*             impl,
+    uint32_t                stack_size
+)
+{
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, false, stack_size };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+    struct bench_clock           start;
+    uint32_t                     thread_idx;
+
+    kraken_start_threads( runtime, kraken_empty_thread, KRAKEN_STACK_CACHE, &options );
+    kraken_wait( runtime );
+
+    start = bench_start();
+
+    for ( thread_idx = 0; thread_idx < BENCH_SPAWN_THREADS; thread_idx++ )
+    {
+        kraken_start_thread_ex( runtime, kraken_empty_thread, &options );
+
+        if ( 0 == ( thread_idx + 1 ) % KRAKEN_STACK_CACHE )
+        {
+            kraken_wait( runtime );
+        }
+    }
+
+    kraken_wait( runtime );
+
+    bench_report( "churn", impl, KRAKEN_STACK_CACHE, BENCH_SPAWN_THREADS, start );
+}
+
+
+static void kraken_bench_memory
+(
+    bool                    shared_stack
+)
+{
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, shared_stack,
+                                             BENCH_STACK_SIZE };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+    uint64_t                     rss     = bench_rss();
+
+    kraken_yields = 0;
+    kraken_rounds = 2;
+
+    kraken_start_threads( runtime, kraken_yield_thread, BENCH_MEMORY_THREADS, &options );
+
+    // one turn of the main thread lets every thread run once and park in kraken_yield
+    kraken_yield( runtime );
+
+    bench_report_memory( shared_stack ? "kraken_shared" : "kraken", BENCH_MEMORY_THREADS,
+                         bench_rss() - rss );
+
+    kraken_wait( runtime );
+}
+
+
+//===========================================================================================
+//
+//                                  UCONTEXT
+//
+//===========================================================================================
+static ucontext_t  ucontext_main;
+static ucontext_t* ucontext_threads;
+static uint32_t    ucontext_count;
+static uint32_t    ucontext_current;
+static uint64_t    ucontext_rounds;
+static uint64_t    ucontext_switches;
+
+
+// round robin over all contexts, like kraken_yield without a run queue
+static void ucontext_yield
+(
+    void
+)
+{
+    uint32_t previous = ucontext_current;
+
+    ucontext_current = ( ucontext_current + 1 ) % ucontext_count;
+    ucontext_switches++;
+
+    swapcontext( &ucontext_threads[ previous ], &ucontext_threads[ ucontext_current ] );
+}
+
+
+static void ucontext_yield_thread
+(
+    void
+)
+{
+    uint64_t round;
+
+    for ( round = 0; round < ucontext_rounds; round++ )
+    {
+        ucontext_yield();
+    }
+
+    // the first context to finish ends the run, the others are still mid loop
+    setcontext( &ucontext_main );
+}
+
+
+static void ucontext_return_thread
+(
+    void
+)
+{
+    swapcontext( &ucontext_threads[ ucontext_current ], &ucontext_main );
+}
+
+
+static void ucontext_create
+(
+    uint32_t            count,
+    void                ( *function )( void )
+)
+{
+    uint32_t context_idx;
+
+    ucontext_threads = ( ucontext_t* )calloc( count, sizeof( ucontext_t ) );
+    ucontext_count   = count;
+    ucontext_current = 0;
+
+    for ( context_idx = 0; context_idx < count; context_idx++ )
+    {
+        getcontext( &ucontext_threads[ context_idx ] );
+        ucontext_threads[ context_idx ].uc_stack.ss_sp   = malloc( BENCH_STACK_SIZE );
+        ucontext_threads[ context_idx ].uc_stack.ss_size = BENCH_STACK_SIZE;
+        ucontext_threads[ context_idx ].uc_link          = &ucontext_main;
+        makecontext( &ucontext_threads[ context_idx ], function, 0 );
+    }
+}
+
+
+static void ucontext_destroy
+(
+    void
+)
+{
+    uint32_t context_idx;
+
+    for ( context_idx = 0; context_idx < ucontext_count; context_idx++ )
+    {
+        free( ucontext_threads[ context_idx ].uc_stack.ss_sp );
+    }
+
+    free( ucontext_threads );
+}
+
+
+static void ucontext_bench_yield
+(
+    const char*         bench,
+    uint32_t            thread_count
+)
+{
+    struct bench_clock start;
+
+    ucontext_rounds   = BENCH_YIELD_SWITCHES / thread_count;
+    ucontext_rounds   = 0 == ucontext_rounds ? 1 : ucontext_rounds;
+    ucontext_switches = 0;
+
+    if ( 2 == thread_count && 0 == strcmp( bench, "pingpong" ) )
+    {
+        ucontext_rounds = BENCH_PINGPONG_ROUNDS;
+    }
+
+    ucontext_create( thread_count, ucontext_yield_thread );
+
+    start = bench_start();
+    swapcontext( &ucontext_main, &ucontext_threads[ 0 ] );
+
+    bench_report( bench, "ucontext", thread_count, ucontext_switches, start );
+
+    ucontext_destroy();
+}
+
+
+static void ucontext_bench_spawn
+(
+    void
+)
+{
+    struct bench_clock start = bench_start();
+    uint32_t           context_idx;
+
+    ucontext_create( BENCH_SPAWN_THREADS, ucontext_return_thread );
+
+    bench_report( "spawn", "ucontext", BENCH_SPAWN_THREADS, BENCH_SPAWN_THREADS, start );
+
+    // run each context once, then free everything
+    start = bench_start();
+
+    for ( context_idx = 0; context_idx < BENCH_SPAWN_THREADS; context_idx++ )
+    {
+        ucontext_current = context_idx;
+        swapcontext( &ucontext_main, &ucontext_threads[ context_idx ] );
+    }
+
+    ucontext_destroy();
+
+    bench_report( "teardown", "ucontext", BENCH_SPAWN_THREADS, BENCH_SPAWN_THREADS, start );
+}
+
+
+static void ucontext_bench_memory
+(
+    void
+)
+{
+    uint64_t rss = bench_rss();
+    uint32_t context_idx;
+
+    ucontext_create( BENCH_MEMORY_THREADS, ucontext_return_thread );
+
+    for ( context_idx = 0; context_idx < BENCH_MEMORY_THREADS; context_idx++ )
+    {
+        ucontext_current = context_idx;
+        swapcontext( &ucontext_main, &ucontext_threads[ context_idx ] );
+    }
+
+    bench_report_memory( "ucontext", BENCH_MEMORY_THREADS, bench_rss() - rss );
+
+    ucontext_destroy();
+}
+
+
+//===========================================================================================
+//
+//                                  PTHREAD
+//
+//===========================================================================================
+static pthread_mutex_t pthread_bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pthread_bench_cond  = PTHREAD_COND_INITIALIZER;
+static uint32_t        pthread_bench_turn  = 0;
+static uint32_t        pthread_bench_count = 0;
+static uint64_t        pthread_bench_rounds;
+static uint64_t        pthread_bench_switches;
+static bool            pthread_bench_release;
+
+
+// hands the turn to the next thread and waits for it to come back around
+static void* pthread_yield_thread
+(
+    void*               argument
+)
+{
+    uint32_t id = ( uint32_t )( uintptr_t )argument;
+    uint64_t round;
+
+    pthread_mutex_lock( &pthread_bench_mutex );
+
+    for ( round = 0; round < pthread_bench_rounds; round++ )
+    {
+        while ( pthread_bench_turn != id )
+        {
+            pthread_cond_wait( &pthread_bench_cond, &pthread_bench_mutex );
+        }
+
+        pthread_bench_turn = ( id + 1 ) % pthread_bench_count;
+        pthread_bench_switches++;
+        pthread_cond_broadcast( &pthread_bench_cond );
+    }
+
+    pthread_mutex_unlock( &pthread_bench_mutex );
+
+    return NULL;
+}
+
+
+static void* pthread_wait_thread
+(
+    void*               argument
+)
+{
+    pthread_mutex_lock( &pthread_bench_mutex );
+
+    while ( !pthread_bench_release )
+    {
+        pthread_cond_wait( &pthread_bench_cond, &pthread_bench_mutex );
+    }
+
+    pthread_mutex_unlock( &pthread_bench_mutex );
+
+    return argument;
+}
+
+
+static void pthread_bench_yield
+(
+    const char*         bench,
+    uint32_t            thread_count,
+    uint64_t            rounds
+)
+{
+    pthread_t*         threads = ( pthread_t* )calloc( thread_count, sizeof( pthread_t ) );
+    struct bench_clock start;
+    uint32_t           thread_idx;
+
+    pthread_bench_turn     = 0;
+    pthread_bench_count    = thread_count;
+    pthread_bench_rounds   = rounds;
+    pthread_bench_switches = 0;
+
+    start = bench_start();
+
+    for ( thread_idx = 0; thread_idx < thread_count; thread_idx++ )
+    {
+        pthread_create( &threads[ thread_idx ], NULL, pthread_yield_thread,
+                        ( void* )( uintptr_t )thread_idx );
+    }
+
+    for ( thread_idx = 0; thread_idx < thread_count; thread_idx++ )
+    {
+        pthread_join( threads[ thread_idx ], NULL );
+    }
+
+    bench_report( bench, "pthread_condvar", thread_count, pthread_bench_switches, start );
+
+    free( threads );
+}
+
+
+static void pthread_bench_spawn
+(
+    void
+)
+{
+    pthread_t*         threads = ( pthread_t* )calloc( BENCH_PTHREAD_THREADS, sizeof( pthread_t ) );
+    struct bench_clock start;
+    uint32_t           thread_idx;
+    uint64_t           rss     = bench_rss();
+
+    pthread_bench_release = false;
+
+    start = bench_start();
+
+    for ( thread_idx = 0; thread_idx < BENCH_PTHREAD_THREADS; thread_idx++ )
+    {
+        pthread_create( &threads[ thread_idx ], NULL, pthread_wait_thread, NULL );
+    }
+
+    bench_report( "spawn", "pthread", BENCH_PTHREAD_THREADS, BENCH_PTHREAD_THREADS, start );
+    bench_report_memory( "pthread", BENCH_PTHREAD_THREADS, bench_rss() - rss );
+
+    start = bench_start();
+
+    pthread_mutex_lock( &pthread_bench_mutex );
+    pthread_bench_release = true;
+    pthread_cond_broadcast( &pthread_bench_cond );
+    pthread_mutex_unlock( &pthread_bench_mutex );
+
+    for ( thread_idx = 0; thread_idx < BENCH_PTHREAD_THREADS; thread_idx++ )
+    {
+        pthread_join( threads[ thread_idx ], NULL );
+    }
+
+    bench_report( "teardown", "pthread", BENCH_PTHREAD_THREADS, BENCH_PTHREAD_THREADS, start );
+
+    free( threads );
+}
+
+
+int main
+(
+    int                 argc,
+    char**              argv
+)
+{
+    uint32_t max_threads = 2 > argc ? 1u << 20 : ( uint32_t )strtoul( argv[ 1 ], NULL, 0 );
+    uint32_t thread_count;
+    bool     last;
+
+    kraken_bench_pingpong();
+    ucontext_bench_yield( "pingpong", 2 );
+    pthread_bench_yield( "pingpong", 2, BENCH_PINGPONG_ROUNDS / 10 );
+
+    // 2, 16, 128, ... up to and including max_threads
+    for ( thread_count = 2, last = false; !last; thread_count *= 8 )
+    {
+        if ( thread_count >= max_threads )
+        {
+            thread_count = max_threads;
+            last         = true;
+        }
+
+        kraken_bench_yield( thread_count );
+
+        if ( BENCH_UCONTEXT_LIMIT >= thread_count )
+        {
+            ucontext_bench_yield( "yield", thread_count );
+        }
+
+        // every handoff wakes all waiters, keep the os threads to a handful
+        if ( 64 >= thread_count )
+        {
+            pthread_bench_yield( "yield", thread_count, 10000 / thread_count );
+        }
+    }
+
+    // the default stack size and a custom one, fresh stacks first, then cached ones
+    kraken_bench_spawn( "kraken", false, 0 );
+    kraken_bench_spawn( "kraken_bulk", true, 0 );
+    kraken_bench_spawn( "kraken_16k", false, BENCH_STACK_SIZE );
+    kraken_bench_spawn( "kraken_bulk_16k", true, BENCH_STACK_SIZE );
+    kraken_bench_churn( "kraken", 0 );
+    kraken_bench_churn( "kraken_16k", BENCH_STACK_SIZE );
+    ucontext_bench_spawn();
+    pthread_bench_spawn();
+
+    kraken_bench_memory( false );
+    kraken_bench_memory( true );
+    ucontext_bench_memory();
+
+    return 0;
+}
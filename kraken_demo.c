@@ -7,26 +7,29 @@
 #include <stdio.h>
 
 
-KRAKEN_AVR_THREAD_FUNCTION( t1,
+struct counter
 {
-    static int i = 0;
-    for ( ; i < 10; i++ ) 
-    {
-        printf( "In thread 1.\n" );
-        kraken_yield( runtime ); 
-    }
-})
+    const char* name;
+    int         count;
+};
 
 
-KRAKEN_AVR_THREAD_FUNCTION( t2,
+static void* count_to_ten
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
 {
-    static int i = 0; 
-    for (; i < 10; i++ ) 
+    struct counter* counter = ( struct counter* )argument;
+
+    for ( ; counter->count < 10; counter->count++ )
     {
-        printf( "In thread 2.\n" );
-        kraken_yield( runtime ); 
+        printf( "In %s.\n", counter->name );
+        kraken_yield( runtime );
     }
-})
+
+    return counter;
+}
 
 
 int main
@@ -37,8 +40,20 @@ int main
     struct kraken_runtime* runtime =
         kraken_initialize_runtime();
 
-    KRAKEN_SCHEDULE_THREAD( runtime, t1 );
-    KRAKEN_SCHEDULE_THREAD( runtime, t2 );
+    struct counter first  = { "thread 1", 0 };
+    struct counter second = { "thread 2", 0 };
+
+    struct kraken_thread* t1 = kraken_spawn( runtime, count_to_ten, &first, NULL );
+    struct kraken_thread* t2 = kraken_spawn( runtime, count_to_ten, &second, NULL );
+
+    struct counter* done;
+
+    // the same function runs twice, each instance counts in its own argument
+    done = ( struct counter* )kraken_join( runtime, t1 );
+    printf( "%s counted to %d.\n", done->name, done->count );
+
+    done = ( struct counter* )kraken_join( runtime, t2 );
+    printf( "%s counted to %d.\n", done->name, done->count );
 
     kraken_run( runtime, 0 );
 }
@@ -1,14 +1,2145 @@
 #define KRAKEN_DEBUG
-#define KRAKEN_SCHEDULER   0x01
-#define KRAKEN_MAX_THREADS 0x04
+#ifndef KRAKEN_SCHEDULER
+    #define KRAKEN_SCHEDULER   0x01
+#endif // KRAKEN_SCHEDULER
+#define KRAKEN_STACK_SIZE  ( 1024 * 64 )
+#define KRAKEN_ENABLE_STACK_WATERMARK 0x1
+#ifndef KRAKEN_ENABLE_POOL
+    #define KRAKEN_ENABLE_POOL 0x1
+#endif // KRAKEN_ENABLE_POOL
+#define KRAKEN_ENABLE_STATS 0x1
+#define KRAKEN_ENABLE_TRACE 0x1
+#define KRAKEN_TRACE_SIZE  0x1000
+#define KRAKEN_ENABLE_PROFILER 0x1
+#define KRAKEN_ENABLE_WATCHDOG 0x1
+#define KRAKEN_ENABLE_PREEMPTION 0x1
+#define KRAKEN_ENABLE_REACTOR 0x1
+#define KRAKEN_ENABLE_OFFLOAD 0x1
 #include "kraken.h"
 
+#include <stdio.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
-int main
+
+#define KRAKEN_TEST( name ) \
+    printf( "kraken_test: %s\n", #name ); \
+    name();
+
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_ROUND_ROBIN
+static int round_robin_trace[ 16 ];
+static int round_robin_count = 0;
+
+
+KRAKEN_THREAD_FUNCTION( round_robin_first,
+{
+    int i;
+    for ( i = 0; i < 3; i++ )
+    {
+        round_robin_trace[ round_robin_count++ ] = 1;
+        kraken_yield( runtime );
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( round_robin_second,
+{
+    int i;
+    for ( i = 0; i < 3; i++ )
+    {
+        round_robin_trace[ round_robin_count++ ] = 2;
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_round_robin
+(
+    void
+)
+{
+    int expected[] = { 1, 2, 1, 2, 1, 2 };
+    int trace_idx;
+
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, round_robin_first );
+    KRAKEN_SCHEDULE_THREAD( runtime, round_robin_second );
+
+    kraken_wait( runtime );
+
+    assert( 6 == round_robin_count );
+
+    for ( trace_idx = 0; trace_idx < 6; trace_idx++ )
+    {
+        assert( expected[ trace_idx ] == round_robin_trace[ trace_idx ] );
+    }
+
+    // stopped slots are reused
+    round_robin_count = 0;
+    KRAKEN_SCHEDULE_THREAD( runtime, round_robin_first );
+    kraken_wait( runtime );
+    assert( 3 == round_robin_count );
+}
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_ROUND_ROBIN
+
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+static bool     fair_heavy_done  = false;
+static uint32_t fair_heavy_count = 0;
+static uint32_t fair_light_count = 0;
+
+
+KRAKEN_THREAD_FUNCTION( fair_heavy,
+{
+    uint64_t start;
+
+    for ( fair_heavy_count = 0; fair_heavy_count < 5; fair_heavy_count++ )
+    {
+        // hog the processor for a millisecond between yields
+        for ( start = kraken_now(); kraken_now() - start < 1000000; ) ;
+        kraken_yield( runtime );
+    }
+
+    fair_heavy_done = true;
+})
+
+
+KRAKEN_THREAD_FUNCTION( fair_light,
+{
+    while ( !fair_heavy_done )
+    {
+        fair_light_count++;
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_fair_scheduler
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, fair_heavy );
+    KRAKEN_SCHEDULE_THREAD( runtime, fair_light );
+
+    kraken_wait( runtime );
+
+    // round robin would give the light thread one turn per heavy turn
+    assert( 5 == fair_heavy_count );
+    assert( 50 < fair_light_count );
+}
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+
+
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+static int priority_trace[ 16 ];
+static int priority_count = 0;
+
+
+KRAKEN_THREAD_FUNCTION( priority_low,
+{
+    int i;
+    for ( i = 0; i < 3; i++ )
+    {
+        priority_trace[ priority_count++ ] = 1;
+        kraken_yield( runtime );
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( priority_high,
+{
+    int i;
+    for ( i = 0; i < 3; i++ )
+    {
+        priority_trace[ priority_count++ ] = 2;
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_priority_scheduler
+(
+    void
+)
+{
+    int expected[] = { 2, 2, 2, 1, 1, 1 };
+    int trace_idx;
+
+    struct kraken_thread_options low  = { 1 };
+    struct kraken_thread_options high = { KRAKEN_PRIORITY_LEVELS - 1 };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+
+    // started first, but the high priority thread runs to completion before it
+    kraken_start_thread_ex( runtime, priority_low, &low );
+    kraken_start_thread_ex( runtime, priority_high, &high );
+
+    kraken_wait( runtime );
+
+    assert( 6 == priority_count );
+
+    for ( trace_idx = 0; trace_idx < 6; trace_idx++ )
+    {
+        assert( expected[ trace_idx ] == priority_trace[ trace_idx ] );
+    }
+}
+#endif // KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+
+
+#define TABLE_THREADS 1000
+
+static uint32_t table_finished = 0;
+
+
+KRAKEN_THREAD_FUNCTION( table_thread,
+{
+    kraken_yield( runtime );
+    table_finished++;
+})
+
+
+static void test_thread_table_growth
+(
+    void
+)
+{
+    int                    thread_idx;
+    struct kraken_thread*  first_chunk;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    for ( thread_idx = 0; thread_idx < TABLE_THREADS; thread_idx++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, table_thread );
+    }
+
+    assert( TABLE_THREADS + 1 == runtime->used_threads );
+    assert( ( TABLE_THREADS + KRAKEN_THREAD_CHUNK ) / KRAKEN_THREAD_CHUNK == runtime->chunk_count );
+
+    // growing must not move the slots handed out earlier
+    first_chunk = runtime->thread_chunks[ 0 ];
+
+    kraken_wait( runtime );
+
+    assert( TABLE_THREADS == table_finished );
+    assert( 1 == runtime->used_threads );
+    assert( first_chunk == runtime->thread_chunks[ 0 ] );
+    assert( runtime->main_thread == &first_chunk[ 0 ] );
+
+    // released slots are reused before the table grows again
+    KRAKEN_SCHEDULE_THREAD( runtime, table_thread );
+    assert( ( TABLE_THREADS + KRAKEN_THREAD_CHUNK ) / KRAKEN_THREAD_CHUNK == runtime->chunk_count );
+    kraken_wait( runtime );
+}
+
+
+KRAKEN_THREAD_FUNCTION( stack_thread,
+{
+    kraken_yield( runtime );
+})
+
+
+static void test_stack_reuse
+(
+    void
+)
+{
+    char*                  stack;
+    pid_t                  child;
+    int                    child_status;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, stack_thread );
+    stack = kraken_queue_last( runtime )->stack;
+
+    kraken_wait( runtime );
+
+    // the stopped thread hands its stack to the cache ...
+    assert( 1 == runtime->free_stack_count );
+    assert( stack == runtime->free_stacks[ 0 ] );
+
+    // ... and the next thread takes it from there
+    KRAKEN_SCHEDULE_THREAD( runtime, stack_thread );
+    assert( 0 == runtime->free_stack_count );
+    assert( stack == kraken_queue_last( runtime )->stack );
+    kraken_wait( runtime );
+
+    // running off the bottom of a stack hits the guard page
+    child = fork();
+
+    if ( 0 == child )
+    {
+        *( volatile char* )( stack - 1 ) = 0;
+        _exit( 0 );
+    }
+
+    assert( child == waitpid( child, &child_status, 0 ) );
+    assert( WIFSIGNALED( child_status ) && SIGSEGV == WTERMSIG( child_status ) );
+}
+
+
+static uint32_t watermark_peak   = 0;
+static uint32_t watermark_report = 0;
+
+
+KRAKEN_THREAD_FUNCTION( watermark_thread,
+{
+    volatile char buffer[ 4096 ];
+    int           i;
+
+    for ( i = 0; i < 4096; i++ )
+    {
+        buffer[ i ] = ( char )i;
+    }
+
+    watermark_peak = kraken_stack_usage( runtime->current_thread );
+    kraken_yield( runtime );
+})
+
+
+static void watermark_stack_report
+(
+    struct kraken_thread*   thread,
+    uint32_t                peak
+)
+{
+    assert( watermark_thread == thread->function );
+    watermark_report = peak;
+}
+
+
+static void test_stack_watermark
+(
+    void
+)
+{
+    char*                        stack;
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, false, 16 * 1024 };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+
+    runtime->stack_report = watermark_stack_report;
+
+    assert( 0 == kraken_start_thread_ex( runtime, watermark_thread, &options ) );
+    assert( 16 * 1024 == kraken_queue_last( runtime )->stack_size );
+
+    kraken_wait( runtime );
+
+    // measured on demand while running and reported once more when the thread stopped
+    assert( 4096 < watermark_peak && 16 * 1024 > watermark_peak );
+    assert( watermark_peak <= watermark_report && 16 * 1024 > watermark_report );
+
+    // custom sized stacks are cached by size ...
+    assert( 1 == runtime->free_stack_count );
+    stack = runtime->free_stacks[ 0 ];
+    assert( 16 * 1024 == runtime->free_stack_sizes[ 0 ] );
+
+    // ... only threads of the same size take them
+    runtime->stack_report = NULL;
+    KRAKEN_SCHEDULE_THREAD( runtime, stack_thread );
+    assert( 1 == runtime->free_stack_count && stack == runtime->free_stacks[ 0 ] );
+
+    assert( 0 == kraken_start_thread_ex( runtime, watermark_thread, &options ) );
+    assert( 0 == runtime->free_stack_count && NULL == runtime->free_stacks[ 0 ] );
+
+    // both sizes go back to the cache side by side
+    kraken_wait( runtime );
+    assert( 2 == runtime->free_stack_count );
+    assert( stack == runtime->free_stacks[ 0 ] || stack == runtime->free_stacks[ 1 ] );
+}
+
+
+static uint32_t park_resumed = 0;
+
+
+static void __attribute__( ( noinline ) ) park_touch_stack
+(
+    void
+)
+{
+    volatile char buffer[ 32 * 1024 ];
+    int           i;
+
+    for ( i = 0; i < 32 * 1024; i += 64 )
+    {
+        buffer[ i ] = ( char )i;
+    }
+}
+
+
+KRAKEN_THREAD_FUNCTION( park_thread,
+{
+    park_touch_stack();
+    kraken_park( runtime );
+    park_resumed++;
+
+    // a permit handed out before parking makes the park return right away
+    kraken_unpark( runtime->current_thread );
+    kraken_park( runtime );
+    park_resumed++;
+})
+
+
+static void test_park_reclaim
+(
+    void
+)
+{
+    struct kraken_thread*  thread;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    runtime->reclaim_after = 0;
+
+    KRAKEN_SCHEDULE_THREAD( runtime, park_thread );
+    thread = kraken_queue_last( runtime );
+
+    // the thread runs until it parks
+    assert( kraken_yield( runtime ) );
+    assert( BLOCKED == thread->status );
+    assert( thread == runtime->parked_head );
+
+    // nothing else to run, but the pages below the parked thread's frames go back
+    assert( !kraken_yield( runtime ) );
+    assert( 16 * 1024 < runtime->reclaimed_bytes );
+    assert( NULL == runtime->parked_head );
+    assert( 32 * 1024 < kraken_stack_usage( thread ) );
+
+    kraken_unpark( thread );
+    assert( READY == thread->status );
+    kraken_wait( runtime );
+
+    assert( 2 == park_resumed );
+    assert( 32 * 1024 < kraken_stack_usage( thread ) );
+}
+
+
+#define SLEEP_THREADS 1000
+
+
+static uint32_t sleep_early    = 0;
+static uint32_t sleep_finished = 0;
+static bool     sleep_timed_out = false;
+static bool     sleep_unparked  = false;
+static struct kraken_thread* sleep_sleeper = NULL;
+
+
+KRAKEN_THREAD_FUNCTION( sleep_thread,
+{
+    uint64_t duration = ( 1 + sleep_finished % 20 ) * 1000000ULL;
+    uint64_t start    = kraken_now();
+
+    sleep_finished++;
+    kraken_sleep( runtime, duration );
+
+    if ( kraken_now() - start < duration )
+    {
+        sleep_early++;
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( sleep_park_thread,
+{
+    sleep_timed_out = !kraken_park_until( runtime, kraken_now() + 2000000ULL );
+    sleep_unparked  = kraken_park_until( runtime, kraken_now() + 1000000000ULL );
+})
+
+
+KRAKEN_THREAD_FUNCTION( sleep_waker_thread,
+{
+    kraken_sleep( runtime, 5000000ULL );
+    kraken_unpark( sleep_sleeper );
+})
+
+
+KRAKEN_THREAD_FUNCTION( sleep_long_thread,
+{
+    kraken_sleep( runtime, 50000000ULL );
+})
+
+
+static void test_sleep
+(
+    void
+)
+{
+    struct timespec        cpu_start;
+    struct timespec        cpu_end;
+    uint64_t               start;
+    uint32_t               i;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    for ( i = 0; i < SLEEP_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, sleep_thread );
+    }
+
+    KRAKEN_SCHEDULE_THREAD( runtime, sleep_park_thread );
+    sleep_sleeper = kraken_queue_last( runtime );
+    KRAKEN_SCHEDULE_THREAD( runtime, sleep_waker_thread );
+
+    start = kraken_now();
+    kraken_wait( runtime );
+
+    assert( SLEEP_THREADS == sleep_finished );
+    assert( 0 == sleep_early );
+    assert( 20000000ULL <= kraken_now() - start );
+    assert( sleep_timed_out );
+    assert( sleep_unparked );
+    assert( 0 == runtime->timer_count );
+
+    // a runtime whose only thread sleeps leaves the processor alone
+    KRAKEN_SCHEDULE_THREAD( runtime, sleep_long_thread );
+
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &cpu_start );
+    kraken_wait( runtime );
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &cpu_end );
+
+    assert( 10000000LL > ( cpu_end.tv_sec - cpu_start.tv_sec ) * 1000000000LL +
+                         ( cpu_end.tv_nsec - cpu_start.tv_nsec ) );
+}
+
+
+
+// ticks of an hour, or as many as the monotonic clock has
+#define TIMER_REWIND( tick ) \
+    ( ( tick ) < 3600000000000ULL / KRAKEN_TIMER_TICK ? \
+      ( tick ) : 3600000000000ULL / KRAKEN_TIMER_TICK )
+
+static struct kraken_thread* timer_far     = NULL;
+static uint64_t              timer_took[ 2 ];
+
+
+KRAKEN_THREAD_FUNCTION( timer_far_thread,
+{
+    kraken_park_until( runtime, kraken_now() + 3600000000000ULL );
+})
+
+
+static void timer_catch_up
+(
+    struct kraken_runtime*  runtime,
+    uint64_t*               took
+)
+{
+    uint64_t start;
+
+    // the wheel looks as if nobody had turned it for an hour
+    runtime->timer_tick -= TIMER_REWIND( runtime->timer_tick );
+
+    start = kraken_now();
+    kraken_sleep( runtime, 1000000ULL );
+    *took = kraken_now() - start;
+}
+
+
+KRAKEN_THREAD_FUNCTION( timer_near_thread,
+{
+    while ( 0 == runtime->timer_count )
+    {
+        kraken_yield( runtime );
+    }
+
+    timer_catch_up( runtime, &timer_took[ 0 ] );
+    kraken_unpark( timer_far );
+})
+
+
+KRAKEN_THREAD_FUNCTION( timer_alone_thread,
+{
+    timer_catch_up( runtime, &timer_took[ 1 ] );
+})
+
+
+static void test_timer_catch_up
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    // with a timer pending the turn has to jump the empty ticks
+    KRAKEN_SCHEDULE_THREAD( runtime, timer_far_thread );
+    timer_far = kraken_queue_last( runtime );
+    KRAKEN_SCHEDULE_THREAD( runtime, timer_near_thread );
+    kraken_wait( runtime );
+
+    // an empty wheel is brought up to date before it takes a timer
+    KRAKEN_SCHEDULE_THREAD( runtime, timer_alone_thread );
+    kraken_wait( runtime );
+
+    assert( 1000000ULL <= timer_took[ 0 ] && 25000000ULL > timer_took[ 0 ] );
+    assert( 1000000ULL <= timer_took[ 1 ] && 25000000ULL > timer_took[ 1 ] );
+    assert( 0 == runtime->timer_count );
+}
+
+static int      reactor_pair[ 2 ];
+static int      reactor_listener  = -1;
+static uint32_t reactor_spins     = 0;
+static bool     reactor_echoed    = false;
+static char     reactor_reply[ 8 ];
+
+
+KRAKEN_THREAD_FUNCTION( reactor_reader_thread,
+{
+    char    buffer[ 8 ];
+    ssize_t length = kraken_read( runtime, reactor_pair[ 0 ], buffer, sizeof( buffer ) );
+
+    assert( 5 == length && 0 == memcmp( buffer, "hello", 5 ) );
+    assert( 0 < reactor_spins );
+})
+
+
+KRAKEN_THREAD_FUNCTION( reactor_writer_thread,
+{
+    kraken_sleep( runtime, 2000000ULL );
+    assert( 5 == kraken_write( runtime, reactor_pair[ 1 ], "hello", 5 ) );
+})
+
+
+KRAKEN_THREAD_FUNCTION( reactor_spin_thread,
+{
+    // keeps running while the reader is blocked in kraken_read
+    while ( reactor_spins < 10 )
+    {
+        reactor_spins++;
+        kraken_yield( runtime );
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( reactor_server_thread,
+{
+    char    buffer[ 8 ];
+    int     client = kraken_accept( runtime, reactor_listener, NULL, NULL );
+    ssize_t length;
+
+    assert( -1 != client );
+    length = kraken_read( runtime, client, buffer, sizeof( buffer ) );
+    assert( 4 == kraken_write( runtime, client, buffer, ( size_t )length ) );
+    close( client );
+})
+
+
+KRAKEN_THREAD_FUNCTION( reactor_client_thread,
+{
+    struct sockaddr_in address;
+    socklen_t          length = sizeof( address );
+    int                fd     = socket( AF_INET, SOCK_STREAM, 0 );
+
+    assert( -1 != fd && -1 != fcntl( fd, F_SETFL, O_NONBLOCK ) );
+    getsockname( reactor_listener, ( struct sockaddr* )&address, &length );
+
+    assert( 0 == kraken_connect( runtime, fd, ( struct sockaddr* )&address, length ) );
+    assert( 4 == kraken_write( runtime, fd, "ping", 4 ) );
+    reactor_echoed = 4 == kraken_read( runtime, fd, reactor_reply, sizeof( reactor_reply ) );
+    close( fd );
+})
+
+
+static void test_reactor
+(
+    void
+)
+{
+    struct sockaddr_in     address;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    assert( 0 == socketpair( AF_UNIX, SOCK_STREAM, 0, reactor_pair ) );
+    assert( -1 != fcntl( reactor_pair[ 0 ], F_SETFL, O_NONBLOCK ) );
+    assert( -1 != fcntl( reactor_pair[ 1 ], F_SETFL, O_NONBLOCK ) );
+
+    KRAKEN_SCHEDULE_THREAD( runtime, reactor_reader_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, reactor_writer_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, reactor_spin_thread );
+    kraken_wait( runtime );
+
+    assert( 0 == runtime->io_waiters );
+
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    reactor_listener        = socket( AF_INET, SOCK_STREAM, 0 );
+
+    assert( -1 != reactor_listener && -1 != fcntl( reactor_listener, F_SETFL, O_NONBLOCK ) );
+    assert( 0 == bind( reactor_listener, ( struct sockaddr* )&address, sizeof( address ) ) );
+    assert( 0 == listen( reactor_listener, 4 ) );
+
+    KRAKEN_SCHEDULE_THREAD( runtime, reactor_server_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, reactor_client_thread );
+    kraken_wait( runtime );
+
+    assert( reactor_echoed && 0 == memcmp( reactor_reply, "ping", 4 ) );
+
+    close( reactor_listener );
+    close( reactor_pair[ 0 ] );
+    close( reactor_pair[ 1 ] );
+}
+
+
+static uint32_t offload_spins = 0;
+static uint32_t offload_done  = 0;
+
+
+static void* offload_nap
+(
+    void*   argument
+)
+{
+    usleep( 20000 );
+
+    return ( char* )argument + 1;
+}
+
+
+KRAKEN_THREAD_FUNCTION( offload_thread,
+{
+    char* result = ( char* )kraken_blocking( runtime, offload_nap, &offload_done );
+
+    assert( ( char* )&offload_done + 1 == result );
+    offload_done++;
+})
+
+
+KRAKEN_THREAD_FUNCTION( offload_spin_thread,
+{
+    // runs while the other threads wait for their calls
+    while ( offload_done < KRAKEN_OFFLOAD_THREADS )
+    {
+        offload_spins++;
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_offload
+(
+    void
+)
+{
+    struct kraken_offload_stats stats;
+    uint64_t                    start;
+    uint32_t                    i;
+    struct kraken_runtime*      runtime = kraken_initialize_runtime();
+
+    for ( i = 0; i < KRAKEN_OFFLOAD_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, offload_thread );
+    }
+
+    KRAKEN_SCHEDULE_THREAD( runtime, offload_spin_thread );
+
+    start = kraken_now();
+    kraken_wait( runtime );
+
+    // the calls overlap on the helpers
+    assert( KRAKEN_OFFLOAD_THREADS == offload_done );
+    assert( 0 < offload_spins );
+    assert( KRAKEN_OFFLOAD_THREADS * 20000000ULL > kraken_now() - start );
+
+    // the main thread can make calls too
+    assert( ( char* )&offload_spins + 1 == kraken_blocking( runtime, offload_nap,
+                                                            &offload_spins ) );
+
+    kraken_read_offload_stats( &stats );
+
+    assert( KRAKEN_OFFLOAD_THREADS + 1 == stats.calls );
+    assert( 0 == stats.queue_depth && 0 == stats.busy );
+    assert( 0 < stats.queue_max );
+    assert( ( KRAKEN_OFFLOAD_THREADS + 1 ) * 20000000ULL <= stats.run_time );
+}
+
+
+#define OFFLOAD_STRESS_THREADS 16
+#define OFFLOAD_STRESS_CALLS   200
+
+
+static uint32_t offload_stress_done = 0;
+
+
+static void* offload_echo
+(
+    void*   argument
+)
+{
+    return argument;
+}
+
+
+static void offload_stress_calls
+(
+    struct kraken_runtime*  runtime
+)
+{
+    uintptr_t i;
+
+    for ( i = 0; i < OFFLOAD_STRESS_CALLS; i++ )
+    {
+        assert( ( void* )i == kraken_blocking( runtime, offload_echo, ( void* )i ) );
+    }
+
+    offload_stress_done++;
+}
+
+
+KRAKEN_THREAD_FUNCTION( offload_stress_thread,
+{
+    offload_stress_calls( runtime );
+})
+
+
+static void test_offload_stress
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+    uint32_t               i;
+
+    // the helpers unpark threads while the runtime queues and parks others
+    for ( i = 0; i < OFFLOAD_STRESS_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, offload_stress_thread );
+    }
+
+    kraken_wait( runtime );
+    assert( OFFLOAD_STRESS_THREADS == offload_stress_done );
+}
+
+
+#define CHANNEL_MESSAGES 1000
+
+
+static struct kraken_channel* channel_numbers = NULL;
+static struct kraken_channel* channel_words   = NULL;
+static uint32_t               channel_sum     = 0;
+static uint32_t               channel_picked[ 2 ];
+
+
+KRAKEN_THREAD_FUNCTION( channel_producer_thread,
+{
+    uint32_t i;
+
+    for ( i = 0; i < CHANNEL_MESSAGES; i++ )
+    {
+        assert( KRAKEN_CHANNEL_OK == kraken_channel_send( runtime, channel_numbers, &i ) );
+    }
+
+    kraken_channel_close( channel_numbers );
+})
+
+
+KRAKEN_THREAD_FUNCTION( channel_consumer_thread,
+{
+    uint32_t expected = 0;
+    uint32_t number;
+
+    // messages arrive in order until the channel is closed and drained
+    while ( KRAKEN_CHANNEL_OK == kraken_channel_recv( runtime, channel_numbers, &number ) )
+    {
+        assert( expected++ == number );
+        channel_sum += number;
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( channel_select_thread,
+{
+    struct kraken_select_case cases[ 2 ];
+    uint32_t                  number;
+    char                      word[ 8 ];
+    int                       picked;
+
+    cases[ 0 ].channel = channel_numbers;
+    cases[ 0 ].message = &number;
+    cases[ 0 ].send    = false;
+    cases[ 1 ].channel = channel_words;
+    cases[ 1 ].message = word;
+    cases[ 1 ].send    = false;
+
+    while ( -1 != ( picked = kraken_select( runtime, cases, 2, kraken_now() + 5000000ULL ) ) )
+    {
+        assert( KRAKEN_CHANNEL_OK == cases[ picked ].result );
+        channel_picked[ picked ]++;
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( channel_sender_thread,
+{
+    uint32_t number = 7;
+
+    kraken_sleep( runtime, 1000000ULL );
+    assert( KRAKEN_CHANNEL_OK == kraken_channel_send( runtime, channel_numbers, &number ) );
+    assert( KRAKEN_CHANNEL_OK == kraken_channel_send( runtime, channel_words, "word" ) );
+    assert( KRAKEN_CHANNEL_OK == kraken_channel_send( runtime, channel_numbers, &number ) );
+})
+
+
+static void test_channels
+(
+    void
+)
+{
+    uint32_t               number = 1;
+    uint64_t               start;
+    uint32_t               capacities[ 3 ] = { 0, 4, KRAKEN_CHANNEL_UNBOUNDED };
+    uint32_t               i;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    // direct handoff, a bounded ring and a growing ring
+    for ( i = 0; i < 3; i++ )
+    {
+        channel_numbers = kraken_channel_create( sizeof( uint32_t ), capacities[ i ] );
+        channel_sum     = 0;
+
+        KRAKEN_SCHEDULE_THREAD( runtime, channel_consumer_thread );
+        KRAKEN_SCHEDULE_THREAD( runtime, channel_producer_thread );
+        kraken_wait( runtime );
+
+        assert( CHANNEL_MESSAGES * ( CHANNEL_MESSAGES - 1 ) / 2 == channel_sum );
+        assert( KRAKEN_CHANNEL_CLOSED == kraken_channel_try_send( channel_numbers, &number ) );
+        kraken_channel_destroy( channel_numbers );
+    }
+
+    channel_numbers = kraken_channel_create( sizeof( uint32_t ), 1 );
+    channel_words   = kraken_channel_create( 8, 0 );
+
+    // the main thread waits too, a full channel makes it time out
+    assert( KRAKEN_CHANNEL_TIMEOUT == kraken_channel_try_recv( channel_numbers, &number ) );
+    assert( KRAKEN_CHANNEL_OK == kraken_channel_try_send( channel_numbers, &number ) );
+    assert( KRAKEN_CHANNEL_TIMEOUT == kraken_channel_try_send( channel_numbers, &number ) );
+
+    start = kraken_now();
+    assert( KRAKEN_CHANNEL_TIMEOUT == kraken_channel_send_until( runtime, channel_numbers,
+                                                                 &number, start + 2000000ULL ) );
+    assert( 2000000ULL <= kraken_now() - start );
+    assert( KRAKEN_CHANNEL_OK == kraken_channel_recv( runtime, channel_numbers, &number ) );
+
+    KRAKEN_SCHEDULE_THREAD( runtime, channel_select_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, channel_sender_thread );
+    kraken_wait( runtime );
+
+    assert( 2 == channel_picked[ 0 ] && 1 == channel_picked[ 1 ] );
+    assert( NULL == channel_numbers->receivers && NULL == channel_words->receivers );
+
+    kraken_channel_destroy( channel_numbers );
+    kraken_channel_destroy( channel_words );
+}
+
+
+#define SYNC_THREADS 8
+
+
+static struct kraken_mutex      sync_mutex;
+static struct kraken_cond       sync_cond;
+static struct kraken_semaphore  sync_semaphore;
+static struct kraken_wait_group sync_group;
+static uint32_t                 sync_counter = 0;
+static uint32_t                 sync_inside  = 0;
+static uint32_t                 sync_most    = 0;
+static uint32_t                 sync_items   = 0;
+static uint32_t                 sync_taken   = 0;
+
+
+KRAKEN_THREAD_FUNCTION( sync_mutex_thread,
+{
+    uint32_t i;
+    uint32_t value;
+
+    for ( i = 0; i < 100; i++ )
+    {
+        kraken_mutex_lock( runtime, &sync_mutex );
+
+        // the others queue up behind the yield instead of racing for the counter
+        value = sync_counter;
+        kraken_yield( runtime );
+        sync_counter = value + 1;
+
+        kraken_mutex_unlock( runtime, &sync_mutex );
+    }
+
+    kraken_wait_group_done( &sync_group );
+})
+
+
+KRAKEN_THREAD_FUNCTION( sync_semaphore_thread,
+{
+    kraken_semaphore_acquire( runtime, &sync_semaphore );
+
+    sync_inside++;
+    sync_most = sync_inside > sync_most ? sync_inside : sync_most;
+    kraken_sleep( runtime, 1000000ULL );
+    sync_inside--;
+
+    kraken_semaphore_release( &sync_semaphore );
+    kraken_wait_group_done( &sync_group );
+})
+
+
+KRAKEN_THREAD_FUNCTION( sync_consumer_thread,
+{
+    kraken_mutex_lock( runtime, &sync_mutex );
+
+    while ( 0 == sync_items )
+    {
+        kraken_cond_wait( runtime, &sync_cond, &sync_mutex );
+    }
+
+    sync_items--;
+    sync_taken++;
+
+    kraken_mutex_unlock( runtime, &sync_mutex );
+    kraken_wait_group_done( &sync_group );
+})
+
+
+static void test_sync
+(
+    void
+)
+{
+    uint32_t               i;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    kraken_semaphore_init( &sync_semaphore, 2 );
+
+    // the main thread waits on the group while the others contend for the mutex
+    kraken_wait_group_add( &sync_group, SYNC_THREADS );
+
+    for ( i = 0; i < SYNC_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, sync_mutex_thread );
+    }
+
+    kraken_wait_group_wait( runtime, &sync_group );
+
+    assert( SYNC_THREADS * 100 == sync_counter );
+    assert( NULL == sync_mutex.owner && NULL == sync_mutex.waiters.head );
+
+    kraken_wait_group_add( &sync_group, SYNC_THREADS );
+
+    for ( i = 0; i < SYNC_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, sync_semaphore_thread );
+    }
+
+    kraken_wait_group_wait( runtime, &sync_group );
+
+    assert( 2 == sync_most && 2 == sync_semaphore.count );
+
+    kraken_wait_group_add( &sync_group, SYNC_THREADS );
+
+    for ( i = 0; i < SYNC_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, sync_consumer_thread );
+    }
+
+    // let every consumer block on the condition variable first
+    kraken_yield( runtime );
+
+    for ( i = 0; i < SYNC_THREADS; i++ )
+    {
+        kraken_mutex_lock( runtime, &sync_mutex );
+        sync_items++;
+        kraken_cond_signal( &sync_cond );
+        kraken_mutex_unlock( runtime, &sync_mutex );
+    }
+
+    kraken_wait_group_wait( runtime, &sync_group );
+    kraken_wait( runtime );
+
+    assert( SYNC_THREADS == sync_taken && 0 == sync_items );
+
+    // a held mutex and an empty semaphore time out
+    kraken_semaphore_init( &sync_semaphore, 0 );
+    assert( kraken_mutex_try_lock( runtime, &sync_mutex ) );
+    assert( !kraken_semaphore_acquire_until( runtime, &sync_semaphore,
+                                             kraken_now() + 1000000ULL ) );
+    assert( !kraken_cond_wait_until( runtime, &sync_cond, &sync_mutex,
+                                     kraken_now() + 1000000ULL ) );
+    assert( sync_mutex.owner == runtime->main_thread && NULL == sync_cond.waiters.head );
+    kraken_mutex_unlock( runtime, &sync_mutex );
+}
+
+
+#define INBOX_THREADS 100
+
+
+static struct kraken_thread* inbox_keeper   = NULL;
+static uint32_t              inbox_started  = 0;
+static bool                  inbox_released = false;
+
+
+KRAKEN_THREAD_FUNCTION( inbox_thread,
+{
+    inbox_started++;
+})
+
+
+KRAKEN_THREAD_FUNCTION( inbox_keeper_thread,
+{
+    // keeps the runtime waiting until the submitting os thread is through
+    while ( INBOX_THREADS > inbox_started )
+    {
+        kraken_park( runtime );
+    }
+
+    inbox_released = true;
+})
+
+
+static void* inbox_submitter
+(
+    void*   runtime
+)
+{
+    uint32_t i;
+
+    for ( i = 0; i < INBOX_THREADS; i++ )
+    {
+        assert( 0 == kraken_submit_thread( ( struct kraken_runtime* )runtime, inbox_thread ) );
+    }
+
+    // the keeper may be parked or still queued, either way it looks again
+    while ( !__atomic_load_n( &inbox_released, __ATOMIC_ACQUIRE ) )
+    {
+        kraken_submit_unpark( inbox_keeper );
+        usleep( 1000 );
+    }
+
+    return NULL;
+}
+
+
+static void test_inbox
+(
+    void
+)
+{
+    pthread_t              submitter;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, inbox_keeper_thread );
+    inbox_keeper = kraken_queue_last( runtime );
+
+    assert( 0 == pthread_create( &submitter, NULL, inbox_submitter, runtime ) );
+    kraken_wait( runtime );
+    assert( 0 == pthread_join( submitter, NULL ) );
+
+    assert( INBOX_THREADS == inbox_started && inbox_released );
+    assert( NULL == runtime->inbox );
+}
+
+
+static bool     inbox_turn_submitted = false;
+static bool     inbox_turn_started   = false;
+static uint32_t inbox_turn_yields    = 0;
+
+
+KRAKEN_THREAD_FUNCTION( inbox_turn_thread,
+{
+    inbox_turn_started = true;
+})
+
+
+static void inbox_turn_spin
+(
+    struct kraken_runtime*  runtime
+)
+{
+    // stays READY all along, the submitted thread still has to get started
+    while ( !inbox_turn_started && 1000000 > inbox_turn_yields )
+    {
+        if ( __atomic_load_n( &inbox_turn_submitted, __ATOMIC_ACQUIRE ) )
+        {
+            inbox_turn_yields++;
+        }
+
+        kraken_yield( runtime );
+    }
+}
+
+
+KRAKEN_THREAD_FUNCTION( inbox_turn_spinner,
+{
+    inbox_turn_spin( runtime );
+})
+
+
+static void* inbox_turn_submitter
+(
+    void*   runtime
+)
+{
+    assert( 0 == kraken_submit_thread( ( struct kraken_runtime* )runtime, inbox_turn_thread ) );
+    __atomic_store_n( &inbox_turn_submitted, true, __ATOMIC_RELEASE );
+
+    return NULL;
+}
+
+
+static void test_inbox_turn
+(
+    void
+)
+{
+    pthread_t              submitter;
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, inbox_turn_spinner );
+
+    assert( 0 == pthread_create( &submitter, NULL, inbox_turn_submitter, runtime ) );
+    kraken_wait( runtime );
+    assert( 0 == pthread_join( submitter, NULL ) );
+
+    // the inbox is drained within a few switches, with every scheduler
+    assert( inbox_turn_started && 10 > inbox_turn_yields );
+}
+
+
+#define JOIN_THREADS 8
+
+
+static uint64_t join_parent_sum = 0;
+
+
+static void* join_square
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    uintptr_t n = ( uintptr_t )argument;
+
+    kraken_yield( runtime );
+
+    return ( void* )( n * n );
+}
+
+
+static void join_children
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_thread* children[ JOIN_THREADS ];
+    uintptr_t             i;
+
+    for ( i = 0; i < JOIN_THREADS; i++ )
+    {
+        children[ i ] = kraken_spawn( runtime, join_square, ( void* )i, NULL );
+        assert( NULL != children[ i ] );
+    }
+
+    for ( i = 0; i < JOIN_THREADS; i++ )
+    {
+        join_parent_sum += ( uintptr_t )kraken_join( runtime, children[ i ] );
+    }
+}
+
+
+KRAKEN_THREAD_FUNCTION( join_parent,
+{
+    join_children( runtime );
+})
+
+
+static void test_join
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+    struct kraken_thread*  threads[ JOIN_THREADS ];
+    struct kraken_thread*  thread;
+    uintptr_t              i;
+
+    // the main thread joins threads that are still running
+    for ( i = 0; i < JOIN_THREADS; i++ )
+    {
+        threads[ i ] = kraken_spawn( runtime, join_square, ( void* )( i + 1 ), NULL );
+        assert( NULL != threads[ i ] && threads[ i ]->joinable );
+    }
+
+    for ( i = 0; i < JOIN_THREADS; i++ )
+    {
+        assert( ( i + 1 ) * ( i + 1 ) == ( uintptr_t )kraken_join( runtime, threads[ i ] ) );
+    }
+
+    // the slots are back and the stacks are in the cache
+    assert( 1 == runtime->used_threads && 0 == runtime->zombie_threads );
+    assert( 0 < runtime->free_stack_count );
+
+    // a stopped thread keeps its result until it is joined
+    thread = kraken_spawn( runtime, join_square, ( void* )7, NULL );
+    kraken_wait( runtime );
+    assert( thread->finished && NULL == thread->stack && 1 == runtime->zombie_threads );
+    assert( 49 == ( uintptr_t )kraken_join( runtime, thread ) );
+    assert( 1 == runtime->used_threads && 0 == runtime->zombie_threads );
+
+    // detached threads give their slot back when they stop
+    kraken_detach( kraken_spawn( runtime, join_square, ( void* )3, NULL ) );
+    thread = kraken_spawn( runtime, join_square, ( void* )4, NULL );
+    kraken_wait( runtime );
+    kraken_detach( thread );
+    assert( 1 == runtime->used_threads && 0 == runtime->zombie_threads );
+
+    // green threads join the threads they spawn
+    KRAKEN_SCHEDULE_THREAD( runtime, join_parent );
+    kraken_wait( runtime );
+    assert( 140 == join_parent_sum );
+    assert( 1 == runtime->used_threads && 0 == runtime->zombie_threads );
+}
+
+static uint64_t generator_thread_sum = 0;
+
+
+static void* generator_range
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    uintptr_t i;
+
+    for ( i = 0; i < ( uintptr_t )argument; i++ )
+    {
+        kraken_generator_yield( runtime, ( void* )i );
+    }
+
+    return argument;
+}
+
+
+static void* generator_squares
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    struct kraken_generator* inner = kraken_generator_create( runtime, generator_range,
+                                                              argument, 0 );
+    void*                    value;
+
+    // a generator that consumes another one
+    while ( kraken_generator_next( runtime, inner, &value ) )
+    {
+        kraken_generator_yield( runtime, ( void* )( ( uintptr_t )value * ( uintptr_t )value ) );
+
+        // other threads run while the generator is suspended in the scheduler
+        kraken_yield( runtime );
+    }
+
+    kraken_generator_destroy( runtime, inner );
+
+    return NULL;
+}
+
+
+static void generator_consume
+(
+    struct kraken_runtime*  runtime
+)
+{
+    struct kraken_generator* generator = kraken_generator_create( runtime, generator_squares,
+                                                                  ( void* )10, 0 );
+    void*                    value;
+
+    while ( kraken_generator_next( runtime, generator, &value ) )
+    {
+        generator_thread_sum += ( uintptr_t )value;
+    }
+
+    assert( NULL == runtime->current_thread->generator );
+    kraken_generator_destroy( runtime, generator );
+}
+
+
+KRAKEN_THREAD_FUNCTION( generator_thread,
+{
+    generator_consume( runtime );
+})
+
+
+static void test_generator
+(
+    void
+)
+{
+    struct kraken_runtime*   runtime = kraken_initialize_runtime();
+    struct kraken_generator* generator;
+    uint32_t                 stack_count;
+    void*                    value;
+    uintptr_t                i;
+
+    // the main thread pulls every value, then the routine's result is kept
+    generator = kraken_generator_create( runtime, generator_range, ( void* )5, 0 );
+    assert( NULL != generator && !generator->finished );
+
+    for ( i = 0; i < 5; i++ )
+    {
+        assert( kraken_generator_next( runtime, generator, &value ) && i == ( uintptr_t )value );
+    }
+
+    stack_count = runtime->free_stack_count;
+    assert( !kraken_generator_next( runtime, generator, &value ) );
+    assert( generator->finished && ( void* )5 == generator->result );
+    assert( NULL == generator->stack && stack_count + 1 == runtime->free_stack_count );
+    assert( !kraken_generator_next( runtime, generator, NULL ) );
+    kraken_generator_destroy( runtime, generator );
+
+    // a generator dropped half way gives its stack back
+    generator = kraken_generator_create( runtime, generator_range, ( void* )5, 0 );
+    assert( kraken_generator_next( runtime, generator, NULL ) );
+    stack_count = runtime->free_stack_count;
+    kraken_generator_destroy( runtime, generator );
+    assert( stack_count + 1 == runtime->free_stack_count );
+
+    // green threads run nested generators that yield to the scheduler
+    for ( i = 0; i < 3; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, generator_thread );
+    }
+
+    kraken_wait( runtime );
+    assert( 3 * 285 == generator_thread_sum );
+    assert( NULL == runtime->main_thread->generator );
+}
+
+#define TASK_ROUNDS 5
+
+
+static uint32_t task_ran      = 0;
+static uint32_t task_chained  = 0;
+static bool     task_slept    = false;
+static bool     task_in_order = true;
+
+
+static void task_count
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    task_in_order = task_in_order && task_ran == ( uintptr_t )argument;
+    task_ran++;
+}
+
+
+static void task_chain
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    // a task posted by a task waits for the next turn
+    if ( 0 != ( uintptr_t )argument )
+    {
+        assert( 0 == kraken_post_task( runtime, task_chain,
+                                       ( void* )( ( uintptr_t )argument - 1 ) ) );
+    }
+
+    task_chained++;
+}
+
+
+KRAKEN_THREAD_FUNCTION( task_sleeper,
+{
+    kraken_sleep( runtime, 1000000ULL );
+    task_slept = true;
+})
+
+
+static void task_block
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    // tasks can't block, they start a thread for that
+    assert( 0 == kraken_start_thread( runtime, task_sleeper ) );
+}
+
+
+static void task_post_rounds
+(
+    struct kraken_runtime*  runtime
+)
+{
+    uintptr_t i;
+
+    for ( i = 0; i < TASK_ROUNDS; i++ )
+    {
+        assert( 0 == kraken_post_task( runtime, task_count, ( void* )i ) );
+
+        // the main thread's turn comes before this thread's next one, with every scheduler
+        assert( i == task_ran );
+        kraken_yield( runtime );
+        assert( i + 1 == task_ran );
+    }
+}
+
+
+KRAKEN_THREAD_FUNCTION( task_poster,
+{
+    task_post_rounds( runtime );
+})
+
+
+static void test_tasks
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+    struct kraken_task*    task;
+    uint32_t               free_count = 0;
+
+    // tasks take turns with the threads
+    KRAKEN_SCHEDULE_THREAD( runtime, task_poster );
+    kraken_wait( runtime );
+    assert( TASK_ROUNDS == task_ran && task_in_order );
+
+    assert( 0 == kraken_post_task( runtime, task_chain, ( void* )3 ) );
+    assert( 0 == kraken_post_task( runtime, task_block, NULL ) );
+    assert( 2 == runtime->task_count );
+    kraken_wait( runtime );
+    assert( 4 == task_chained && task_slept );
+    assert( 0 == runtime->task_count && NULL == runtime->task_head );
+
+    // the records are kept for the next tasks
+    for ( task = runtime->free_tasks; NULL != task; task = task->next )
+    {
+        free_count++;
+    }
+
+    assert( 2 <= free_count );
+}
+
+static void stats_spin
+(
+    uint64_t    nanoseconds
+)
+{
+    uint64_t start = kraken_now();
+
+    while ( kraken_now() - start < nanoseconds ) ;
+}
+
+
+KRAKEN_THREAD_FUNCTION( stats_busy_thread,
+{
+    int i;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        stats_spin( 2000000 );
+        kraken_yield( runtime );
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( stats_idle_thread,
+{
+    int i;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_runtime_stats
+(
+    void
+)
+{
+    struct kraken_thread_stats  busy_stats;
+    struct kraken_thread_stats  idle_stats;
+    struct kraken_runtime_stats runtime_stats;
+    struct kraken_thread*       busy;
+    struct kraken_thread*       idle;
+    struct kraken_runtime*      runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, stats_busy_thread );
+    busy = kraken_queue_last( runtime );
+    KRAKEN_SCHEDULE_THREAD( runtime, stats_idle_thread );
+    idle = kraken_queue_last( runtime );
+
+    kraken_wait( runtime );
+
+    // stopped slots keep their counters until they are reused
+    kraken_read_thread_stats( busy, &busy_stats );
+    kraken_read_thread_stats( idle, &idle_stats );
+    kraken_read_runtime_stats( runtime, &runtime_stats );
+
+    assert( 1 <= busy_stats.switches && 4 >= busy_stats.switches );
+    assert( 6000000 <= busy_stats.run_time );
+    assert( 2000000 <= busy_stats.longest_run && busy_stats.run_time >= busy_stats.longest_run );
+
+    // the idle thread waited on the queue while the busy one was spinning
+    assert( 1 <= idle_stats.switches );
+    assert( 2000000 <= idle_stats.ready_time );
+    assert( 2000000 > idle_stats.longest_run );
+
+    assert( busy_stats.switches + idle_stats.switches <= runtime_stats.switches );
+    assert( runtime_stats.switches == runtime_stats.queue_samples );
+    assert( 1 <= runtime_stats.queue_max && 2 >= runtime_stats.queue_max );
+    assert( runtime_stats.queue_total <= runtime_stats.queue_samples * runtime_stats.queue_max );
+
+    kraken_print_state( runtime, false );
+}
+
+
+static struct kraken_thread* trace_sleeper = NULL;
+
+
+KRAKEN_THREAD_FUNCTION( trace_sleeper_thread,
+{
+    kraken_park( runtime );
+})
+
+
+KRAKEN_THREAD_FUNCTION( trace_waker_thread,
+{
+    kraken_yield( runtime );
+    kraken_unpark( trace_sleeper );
+})
+
+
+static void test_trace
+(
+    void
+)
+{
+    char                   json[ 8192 ];
+    size_t                 length;
+    FILE*                  file    = tmpfile();
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    assert( NULL != file );
+
+    KRAKEN_SCHEDULE_THREAD( runtime, trace_sleeper_thread );
+    trace_sleeper = kraken_queue_last( runtime );
+    KRAKEN_SCHEDULE_THREAD( runtime, trace_waker_thread );
+
+    kraken_wait( runtime );
+
+    // 2 spawns, 2 exits, a block, a wake, a yield from the waker and the main thread's
+    // yields plus one record per switch
+    assert( 8 < runtime->trace_head && KRAKEN_TRACE_SIZE > runtime->trace_head );
+
+    assert( 0 == kraken_trace_dump( runtime, file ) );
+
+    rewind( file );
+    length         = fread( json, 1, sizeof( json ) - 1, file );
+    json[ length ] = '\0';
+    fclose( file );
+
+    assert( 0 == strncmp( json, "{\"traceEvents\":[", 16 ) );
+    assert( NULL != strstr( json, "\"name\":\"spawn\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"yield\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"block\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"wake\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"exit\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"thread 0.1\",\"cat\":\"kraken\",\"ph\":\"X\"" ) );
+    assert( NULL != strstr( json, "\"name\":\"thread 0.2\",\"cat\":\"kraken\",\"ph\":\"X\"" ) );
+    assert( 0 == strcmp( json + length - 4, "\n]}\n" ) );
+}
+
+
+KRAKEN_THREAD_FUNCTION( profile_hot_thread,
+{
+    int i;
+
+    for ( i = 0; i < 10; i++ )
+    {
+        stats_spin( 10000000 );
+        kraken_yield( runtime );
+    }
+})
+
+
+KRAKEN_THREAD_FUNCTION( profile_cold_thread,
+{
+    int i;
+
+    for ( i = 0; i < 10; i++ )
+    {
+        stats_spin( 1000000 );
+        kraken_yield( runtime );
+    }
+})
+
+
+static void* profile_spawned_routine
+(
+    struct kraken_runtime*  runtime,
+    void*                   argument
+)
+{
+    int i;
+
+    for ( i = 0; i < 5; i++ )
+    {
+        stats_spin( 10000000 );
+        kraken_yield( runtime );
+    }
+
+    return argument;
+}
+
+
+static void test_profiler
+(
+    void
+)
+{
+    struct kraken_profile_entry entries[ 8 ];
+    uint32_t                    entry_count;
+    uint32_t                    hot_samples     = 0;
+    uint32_t                    cold_samples    = 0;
+    uint32_t                    spawned_samples = 0;
+    uint32_t                    entry_idx;
+    struct kraken_thread*       spawned;
+    struct kraken_runtime*      runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, profile_hot_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, profile_cold_thread );
+    spawned = kraken_spawn( runtime, profile_spawned_routine, NULL, NULL );
+    assert( NULL != spawned );
+
+    assert( 0 == kraken_profile_start( runtime, 1000 ) );
+    kraken_wait( runtime );
+    kraken_profile_stop( runtime );
+    kraken_join( runtime, spawned );
+
+    entry_count = kraken_profile_report( runtime, entries, 8 );
+
+    for ( entry_idx = 0; entry_idx < entry_count; entry_idx++ )
+    {
+        if ( profile_hot_thread == entries[ entry_idx ].function )
+        {
+            hot_samples = entries[ entry_idx ].samples;
+        }
+        else if ( profile_cold_thread == entries[ entry_idx ].function )
+        {
+            cold_samples = entries[ entry_idx ].samples;
+        }
+        // spawned threads are told apart by their routine
+        else if ( profile_spawned_routine == entries[ entry_idx ].routine )
+        {
+            assert( NULL == entries[ entry_idx ].function );
+            spawned_samples = entries[ entry_idx ].samples;
+        }
+    }
+
+    // the hot thread burns ten times the processor time of the cold one
+    assert( 0 < entry_count && hot_samples == entries[ 0 ].samples );
+    assert( cold_samples < hot_samples );
+    assert( 0 < spawned_samples );
+    assert( 0 == runtime->profile_dropped );
+}
+
+
+static uint32_t              watchdog_reports = 0;
+static struct kraken_thread* watchdog_thread  = NULL;
+static uintptr_t             watchdog_ip      = 0;
+static uint64_t              watchdog_overrun = 0;
+
+
+static void watchdog_report
+(
+    struct kraken_runtime*  runtime,
+    struct kraken_thread*   thread,
+    uintptr_t               ip,
+    uint64_t                overrun
+)
+{
+    ( void )runtime;
+
+    __atomic_add_fetch( &watchdog_reports, 1, __ATOMIC_RELAXED );
+    watchdog_thread  = thread;
+    watchdog_ip      = ip;
+    watchdog_overrun = overrun;
+}
+
+
+KRAKEN_THREAD_FUNCTION( watchdog_hog_thread,
+{
+    // forgets to yield
+    stats_spin( 60000000 );
+})
+
+
+KRAKEN_THREAD_FUNCTION( watchdog_polite_thread,
+{
+    int i;
+
+    for ( i = 0; i < 40; i++ )
+    {
+        stats_spin( 1000000 );
+        kraken_yield( runtime );
+    }
+})
+
+
+static void test_watchdog
+(
+    void
+)
+{
+    struct kraken_watchdog* watchdog;
+    struct kraken_thread*   hog;
+    struct kraken_runtime*  runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, watchdog_polite_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, watchdog_hog_thread );
+    hog = kraken_queue_last( runtime );
+
+    watchdog = kraken_watchdog_start( &runtime, 1, 10000000, watchdog_report );
+    assert( NULL != watchdog );
+
+    kraken_wait( runtime );
+    kraken_watchdog_stop( watchdog );
+
+    // reported once, while spinning, and the thread that yields regularly never
+    assert( 1 == watchdog_reports );
+    assert( hog == watchdog_thread );
+    assert( 0 != watchdog_ip );
+    assert( 10000000 <= watchdog_overrun && 60000000 > watchdog_overrun );
+}
+
+
+static volatile bool preempt_first_running  = false;
+static volatile bool preempt_second_running = false;
+
+
+// each spins until the other one ran, which only works if the spinning one is preempted
+KRAKEN_THREAD_FUNCTION( preempt_first_thread,
+{
+    preempt_first_running = true;
+
+    while ( !preempt_second_running ) ;
+})
+
+
+KRAKEN_THREAD_FUNCTION( preempt_second_thread,
+{
+    preempt_second_running = true;
+
+    while ( !preempt_first_running ) ;
+})
+
+
+static void test_preemption
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+
+    KRAKEN_SCHEDULE_THREAD( runtime, preempt_first_thread );
+    KRAKEN_SCHEDULE_THREAD( runtime, preempt_second_thread );
+
+    assert( 0 == kraken_preempt_start( runtime, 1000000 ) );
+    kraken_wait( runtime );
+    kraken_preempt_stop( runtime );
+
+    assert( preempt_first_running && preempt_second_running );
+    assert( 1 <= runtime->preemptions );
+    assert( 0 == runtime->used_threads - 1 );
+}
+
+
+#define PREEMPT_ALLOC_THREADS 4
+
+
+static uint32_t preempt_alloc_running = 0;
+static uint32_t preempt_alloc_done    = 0;
+
+
+static void preempt_alloc_churn
+(
+    void
+)
+{
+    void*    blocks[ 64 ] = { NULL };
+    uint32_t round        = 0;
+    uint32_t block_idx;
+
+    __atomic_add_fetch( &preempt_alloc_running, 1, __ATOMIC_RELAXED );
+
+    // allocates until every thread ran, which only works if the threads are preempted
+    while ( PREEMPT_ALLOC_THREADS > __atomic_load_n( &preempt_alloc_running, __ATOMIC_RELAXED ) ||
+            100000 > round )
+    {
+        block_idx = ( round * 2654435761u ) % 64;
+
+        free( blocks[ block_idx ] );
+        blocks[ block_idx ] = malloc( 16 + round % 512 );
+        memset( blocks[ block_idx ], 0x5a, 16 );
+        round++;
+    }
+
+    for ( block_idx = 0; block_idx < 64; block_idx++ )
+    {
+        free( blocks[ block_idx ] );
+    }
+
+    preempt_alloc_done++;
+}
+
+
+KRAKEN_THREAD_FUNCTION( preempt_alloc_thread,
+{
+    preempt_alloc_churn();
+})
+
+
+static void test_preempt_alloc
+(
+    void
+)
+{
+    struct kraken_runtime* runtime = kraken_initialize_runtime();
+    uint32_t               i;
+
+    for ( i = 0; i < PREEMPT_ALLOC_THREADS; i++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( runtime, preempt_alloc_thread );
+    }
+
+    // a short slice lands inside malloc and free all the time
+    assert( 0 == kraken_preempt_start( runtime, 50000 ) );
+    kraken_wait( runtime );
+    kraken_preempt_stop( runtime );
+
+    assert( PREEMPT_ALLOC_THREADS == preempt_alloc_done );
+    assert( PREEMPT_ALLOC_THREADS - 1 <= runtime->preemptions );
+}
+
+
+#define SHARED_THREADS 1000
+
+static uint32_t shared_finished = 0;
+static uint32_t shared_intact   = 0;
+
+
+KRAKEN_THREAD_FUNCTION( shared_thread,
+{
+    // locals live on the shared stack and have to survive other threads running on it
+    volatile uint32_t values[ 16 ];
+    uint32_t          value_idx;
+    uint32_t          id = runtime->current_thread->id;
+
+    for ( value_idx = 0; value_idx < 16; value_idx++ )
+    {
+        values[ value_idx ] = id * 16 + value_idx;
+        kraken_yield( runtime );
+    }
+
+    for ( value_idx = 0; value_idx < 16 && values[ value_idx ] == id * 16 + value_idx; )
+    {
+        value_idx++;
+    }
+
+    shared_intact += 16 == value_idx;
+    shared_finished++;
+})
+
+
+static void test_shared_stack
 (
     void
 )
 {
+    int                          thread_idx;
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, true };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+
+    for ( thread_idx = 0; thread_idx < SHARED_THREADS; thread_idx++ )
+    {
+        assert( 0 == kraken_start_thread_ex( runtime, shared_thread, &options ) );
+    }
+
+    // private stack and shared stack threads mix
+    KRAKEN_SCHEDULE_THREAD( runtime, stack_thread );
+
+    // no thread got a private stack, each only keeps the bytes it needs
+    assert( NULL != runtime->shared_stack );
+    assert( NULL == kraken_queue_first( runtime )->stack );
+    assert( 16 == kraken_queue_first( runtime )->saved_size );
+
+    kraken_wait( runtime );
+
+    assert( SHARED_THREADS == shared_finished );
+    assert( SHARED_THREADS == shared_intact );
+    assert( NULL == runtime->stack_occupant );
+}
+
+
+#define BULK_THREADS 10000
+
+static uint32_t bulk_finished = 0;
+
+
+KRAKEN_THREAD_FUNCTION( bulk_thread,
+{
+    kraken_yield( runtime );
+    bulk_finished++;
+})
+
+
+static void test_bulk_spawn
+(
+    void
+)
+{
+    struct kraken_thread_options options = { KRAKEN_PRIORITY_DEFAULT, false, 8 * 1024 };
+    struct kraken_runtime*       runtime = kraken_initialize_runtime();
+
+    assert( 0 == kraken_start_threads( runtime, bulk_thread, BULK_THREADS, &options ) );
+    assert( BULK_THREADS + 1 == runtime->used_threads );
+
+    // stacks are carved out of one mapping, in slot order
+    assert( runtime->thread_chunks[ 0 ][ 2 ].stack - runtime->thread_chunks[ 0 ][ 1 ].stack ==
+            ( long )kraken_stack_stride( 8 * 1024 ) );
+
+    kraken_wait( runtime );
+
+    assert( BULK_THREADS == bulk_finished );
+    assert( 1 == runtime->used_threads );
+}
+
+
+#define POOL_THREADS 48
+
+#if KRAKEN_ENABLE_POOL
+static pthread_t pool_main_os_thread;
+static uint32_t  pool_finished = 0;
+static uint32_t  pool_migrated = 0;
+
+
+KRAKEN_THREAD_FUNCTION( pool_thread,
+{
+    int i;
+
+    for ( i = 0; i < 100; i++ )
+    {
+        if ( !pthread_equal( pool_main_os_thread, pthread_self() ) )
+        {
+            __atomic_store_n( &pool_migrated, 1, __ATOMIC_RELAXED );
+        }
+
+        // hand the core to the other workers so they get a chance to steal
+        sched_yield();
+        kraken_yield( runtime );
+    }
+
+    __atomic_add_fetch( &pool_finished, 1, __ATOMIC_RELAXED );
+})
+
+
+static void test_pool_work_stealing
+(
+    void
+)
+{
+    int                 thread_idx;
+    struct kraken_pool* pool = kraken_initialize_pool( 4 );
+
+    pool_main_os_thread = pthread_self();
+
+    // everything starts on the first runtime, the other workers have to steal
+    for ( thread_idx = 0; thread_idx < POOL_THREADS; thread_idx++ )
+    {
+        KRAKEN_SCHEDULE_THREAD( pool->runtimes[ 0 ], pool_thread );
+    }
+
+    kraken_pool_wait( pool );
+
+    assert( POOL_THREADS == pool_finished );
+    assert( 1 == pool_migrated );
+}
+
+
+static bool pool_submit_started = false;
+
+
+KRAKEN_THREAD_FUNCTION( pool_submit_thread,
+{
+    __atomic_store_n( &pool_submit_started, true, __ATOMIC_RELEASE );
+})
+
+
+static void test_pool_submit
+(
+    void
+)
+{
+    int                 status;
+    struct kraken_pool* pool = kraken_initialize_pool( 2 );
+
+    // nothing else runs in the pool, the submission alone has to keep the workers going
+    assert( 0 == kraken_submit_thread_ex( pool->runtimes[ 1 ], pool_submit_thread, &status ) );
+    assert( 1 == status );
+
+    kraken_pool_wait( pool );
+
+    assert( pool_submit_started );
+    assert( 0 == status );
+    assert( 0 == pool->live_threads );
 }
+#endif // KRAKEN_ENABLE_POOL
+
 
+int main
+(
+    void
+)
+{
+#if KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_ROUND_ROBIN
+    KRAKEN_TEST( test_round_robin );
+#elif KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_FAIR
+    KRAKEN_TEST( test_fair_scheduler );
+#elif KRAKEN_SCHEDULER == KRAKEN_SCHEDULER_PRIORITY
+    KRAKEN_TEST( test_priority_scheduler );
+#endif
+    KRAKEN_TEST( test_thread_table_growth );
+    KRAKEN_TEST( test_stack_reuse );
+    KRAKEN_TEST( test_stack_watermark );
+    KRAKEN_TEST( test_shared_stack );
+    KRAKEN_TEST( test_park_reclaim );
+    KRAKEN_TEST( test_sleep );
+    KRAKEN_TEST( test_timer_catch_up );
+    KRAKEN_TEST( test_reactor );
+    KRAKEN_TEST( test_offload );
+    KRAKEN_TEST( test_offload_stress );
+    KRAKEN_TEST( test_channels );
+    KRAKEN_TEST( test_sync );
+    KRAKEN_TEST( test_inbox );
+    KRAKEN_TEST( test_inbox_turn );
+    KRAKEN_TEST( test_join );
+    KRAKEN_TEST( test_generator );
+    KRAKEN_TEST( test_tasks );
+    KRAKEN_TEST( test_runtime_stats );
+    KRAKEN_TEST( test_trace );
+    KRAKEN_TEST( test_profiler );
+    KRAKEN_TEST( test_watchdog );
+    KRAKEN_TEST( test_preemption );
+    KRAKEN_TEST( test_preempt_alloc );
+    KRAKEN_TEST( test_bulk_spawn );
+#if KRAKEN_ENABLE_POOL
+    KRAKEN_TEST( test_pool_work_stealing );
+    KRAKEN_TEST( test_pool_submit );
+#endif // KRAKEN_ENABLE_POOL
 
+    return 0;
+}